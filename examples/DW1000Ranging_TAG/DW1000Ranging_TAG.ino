@@ -24,6 +24,19 @@ void setup() {
   DW1000Ranging.attachInactiveDevice(inactiveDevice);
   //Enable the filter to smooth the distance
   //DW1000Ranging.useRangeFilter(true);
+  //Limit the ranging rate per anchor and the share of time the tag transmits
+  //DW1000Ranging.setTargetRate(10);
+  //DW1000Ranging.setDutyCycle(10);
+  //Range with all anchors at once: one POLL and one RANGE, the anchors answer in slots
+  //DW1000Ranging.useBroadcastRanging(true);
+  //Shorter RANGE frames, with 32 bit intervals instead of the timestamps
+  //DW1000Ranging.usePackedTimestamps(true);
+  //Solve the position of the tag from the anchors with known coordinates (short address, x, y, z in m)
+  //DW1000Ranging.setAnchorPosition(0x1201, 0, 0, 2.5);
+  //DW1000Ranging.setAnchorPosition(0x1202, 10, 0, 2.5);
+  //DW1000Ranging.setAnchorPosition(0x1203, 10, 10, 2.5);
+  //DW1000Ranging.setPositionDimensions(2, 1.0);
+  //DW1000Ranging.attachNewPosition(newPosition);
   
   //we start the module as a tag
   DW1000Ranging.startAsTag("7D:00:22:EA:82:60:3B:9C", DW1000.MODE_LONGDATA_RANGE_ACCURACY);
@@ -39,6 +52,13 @@ void newRange() {
   Serial.print("\t RX power: "); Serial.print(DW1000Ranging.getDistantDevice()->getRXPower()); Serial.println(" dBm");
 }
 
+void newPosition(DW1000Position* position) {
+  Serial.print("position: "); Serial.print(position->x); Serial.print(", "); Serial.print(position->y);
+  Serial.print(", "); Serial.print(position->z); Serial.print(" m");
+  Serial.print("\t residual: "); Serial.print(position->residual); Serial.print(" m");
+  Serial.print("\t GDOP: "); Serial.println(position->gdop);
+}
+
 void newDevice(DW1000Device* device) {
   Serial.print("ranging init; 1 device added ! -> ");
   Serial.print(" short:");
@@ -0,0 +1,138 @@
+/*
+ * Decawave DW1000 library for arduino.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @file DeviceManagerBenchmark.ino
+ * Measures the cost of looking up a device by its short address as the number
+ * of devices grows, with the index of the DeviceManager and with a linear scan
+ * for comparison, the cost of removing a device and of the housekeeping that
+ * runs with every timer tick while no device is due. Does not need a DW1000.
+ * Starts with the RAM a DeviceManager and a DeviceTable take for 16, 64 and
+ * 256 devices, on the board it runs on. Build with -DDEVICE_TABLE=1 for the
+ * DeviceManager that keeps the timestamps in the layout of a DeviceTable.
+ * Build with e.g. -DMAX_DEVICES=256 for more devices than the default 4.
+ */
+
+#include <DeviceManager.h>
+#include <DeviceTable.h>
+
+// lookups per measurement
+const uint16_t RUNS = 1000;
+
+DeviceManager<> manager;
+
+void shortAddressOf(uint16_t i, byte shortAddress[]) {
+  // spread like the addresses taken from random EUIs
+  uint16_t address = (uint16_t)(i * 40503u) ^ 0x9800;
+  shortAddress[0] = address & 0xFF;
+  shortAddress[1] = address >> 8;
+}
+
+DW1000Device* linearSearch(byte shortAddress[]) {
+  uint16_t address = (shortAddress[1] << 8) | shortAddress[0];
+  for(uint16_t i = 0; i < manager.getDeviceCount(); i++) {
+    DW1000Device* device = manager.getDevice(i);
+    if(device->getShortAddress() == address) {
+      return device;
+    }
+  }
+  return nullptr;
+}
+
+DW1000Device* indexSearch(byte shortAddress[]) {
+  return manager.getDeviceByShortAddress(shortAddress);
+}
+
+float measure(DW1000Device* (*lookup)(byte shortAddress[]), uint16_t devices, bool miss) {
+  byte shortAddress[2];
+  uint16_t found = 0;
+  uint32_t start = micros();
+  for(uint16_t i = 0; i < RUNS; i++) {
+    shortAddressOf(miss ? devices + i % devices : i % devices, shortAddress);
+    if(lookup(shortAddress) != nullptr) {
+      found++;
+    }
+  }
+  uint32_t duration = micros() - start;
+  if(found != (miss ? 0 : RUNS)) {
+    Serial.println(F("lookup failed"));
+  }
+  return (float)duration * 1000 / RUNS;
+}
+
+float measureRemoval(uint16_t devices) {
+  // all devices, found by short address and removed through their handle, then added again
+  byte shortAddress[2];
+  uint32_t start = micros();
+  for(uint16_t i = 0; i < devices; i++) {
+    shortAddressOf(i, shortAddress);
+    manager.removeDevice(manager.getHandle(manager.getDeviceByShortAddress(shortAddress)));
+  }
+  uint32_t duration = micros() - start;
+  if(manager.getDeviceCount() != 0) {
+    Serial.println(F("removal failed"));
+  }
+  for(uint16_t i = 0; i < devices; i++) {
+    shortAddressOf(i, shortAddress);
+    manager.emplace(shortAddress);
+  }
+  return (float)duration * 1000 / devices;
+}
+
+float measureHousekeeping() {
+  uint32_t start = micros();
+  for(uint16_t i = 0; i < RUNS; i++) {
+    manager.checkForInactiveDevices(nullptr);
+  }
+  return (float)(micros() - start) * 1000 / RUNS;
+}
+
+void printMemory(uint16_t devices, size_t managerSize, size_t tableSize) {
+  Serial.print(devices);
+  Serial.print(F("\t")); Serial.print(managerSize);
+  Serial.print(F("\t")); Serial.print(managerSize / devices);
+  Serial.print(F("\t")); Serial.print(tableSize);
+  Serial.print(F("\t")); Serial.println(tableSize / devices);
+}
+
+void setup() {
+  Serial.begin(115200);
+  Serial.println(F("### DW1000-arduino-device-manager-benchmark ###"));
+  Serial.println(F("devices\tDeviceManager (bytes)\tper device\tDeviceTable (bytes)\tper device"));
+  printMemory(16, sizeof(DeviceManager<16>), sizeof(DeviceTable<16>));
+  printMemory(64, sizeof(DeviceManager<64>), sizeof(DeviceTable<64>));
+  printMemory(256, sizeof(DeviceManager<256>), sizeof(DeviceTable<256>));
+  Serial.println(F("devices\tindex hit\tindex miss\tlinear hit\tlinear miss (ns/lookup)\tremoval (ns)\thousekeeping (ns)"));
+  uint16_t devices = 0;
+  for(uint16_t step = 1; step <= MAX_DEVICES; step *= 2) {
+    // add devices up to the next power of two
+    while(devices < step) {
+      byte shortAddress[2];
+      shortAddressOf(devices, shortAddress);
+      manager.emplace(shortAddress);
+      devices++;
+    }
+    float removal = measureRemoval(devices);
+    Serial.print(devices);
+    Serial.print(F("\t")); Serial.print(measure(indexSearch, devices, false), 0);
+    Serial.print(F("\t")); Serial.print(measure(indexSearch, devices, true), 0);
+    Serial.print(F("\t")); Serial.print(measure(linearSearch, devices, false), 0);
+    Serial.print(F("\t")); Serial.print(measure(linearSearch, devices, true), 0);
+    Serial.print(F("\t")); Serial.print(removal, 0);
+    Serial.print(F("\t")); Serial.println(measureHousekeeping(), 0);
+  }
+}
+
+void loop() {
+}
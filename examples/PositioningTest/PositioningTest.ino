@@ -0,0 +1,109 @@
+/*
+ * Decawave DW1000 library for arduino.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @file PositioningTest.ino
+ * Accuracy test and benchmark of DW1000Positioning on synthetic anchor
+ * layouts. Tags at random places get ranges with 10 cm noise (and none, to
+ * check the solver is exact). Prints the mean position error, residual and
+ * GDOP per layout and the time per solve. Does not need a DW1000.
+ */
+
+#include <DW1000Positioning.h>
+
+// tag positions per layout
+const uint16_t RUNS = 200;
+
+// small deterministic pseudo random generator (xorshift)
+uint32_t randomState = 2463534242UL;
+uint32_t random32() {
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return randomState;
+}
+
+float uniform(float from, float to) {
+  return from + (to - from) * (random32() & 0xFFFF) / 65535.0f;
+}
+
+// about normal, mean 0
+float noise(float deviation) {
+  float sum = 0;
+  for(uint8_t i = 0; i < 12; i++) {
+    sum += (random32() & 0xFFFF) / 65536.0f;
+  }
+  return (sum - 6) * deviation;
+}
+
+// room of 10 x 10 m, anchors at 2.5 m, tags at 1 m
+const float SQUARE[][3] = {{0, 0, 2.5}, {10, 0, 2.5}, {10, 10, 2.5}, {0, 10, 2.5}};
+// corridor of 30 x 2 m, close to a line
+const float CORRIDOR[][3] = {{0, 0, 2.5}, {10, 2, 2.5}, {20, 0, 2.5}, {30, 2, 2.5}};
+// anchors at two heights, for 3D
+const float ROOM[][3] = {{0, 0, 0.5}, {10, 0, 3}, {10, 10, 0.5}, {0, 10, 3}, {5, 0, 3}, {5, 10, 0.5}};
+
+void run(const __FlashStringHelper* name, const float anchors[][3], uint8_t count, uint8_t dimensions, float width, float depth, float deviation) {
+  DW1000Positioning positioning;
+  positioning.setDimensions(dimensions, 1.0f);
+  float ranges[POSITIONING_MAX_ANCHORS];
+  float error = 0, residual = 0, gdop = 0;
+  uint16_t solved = 0;
+  uint32_t duration = 0;
+  for(uint16_t run = 0; run < RUNS; run++) {
+    float tag[3] = {uniform(0, width), uniform(0, depth), dimensions == 3 ? uniform(0.5, 2.5) : 1.0f};
+    for(uint8_t i = 0; i < count; i++) {
+      float distance = 0;
+      for(uint8_t j = 0; j < 3; j++) {
+        distance += sq(tag[j] - anchors[i][j]);
+      }
+      ranges[i] = sqrt(distance) + noise(deviation);
+    }
+    DW1000Position position;
+    uint32_t start = micros();
+    bool ok = positioning.solve(anchors, ranges, count, position);
+    duration += micros() - start;
+    if(!ok) {
+      continue;
+    }
+    error += sqrt(sq(position.x - tag[0]) + sq(position.y - tag[1]) + sq(position.z - tag[2]));
+    residual += position.residual;
+    gdop += position.gdop;
+    solved++;
+  }
+  Serial.print(name);
+  Serial.print(F("\t")); Serial.print(dimensions);
+  Serial.print(F("\t")); Serial.print(count);
+  Serial.print(F("\t")); Serial.print(deviation, 2);
+  Serial.print(F("\t")); Serial.print(solved);
+  Serial.print(F("\t")); Serial.print(error / solved, 3);
+  Serial.print(F("\t")); Serial.print(residual / solved, 3);
+  Serial.print(F("\t")); Serial.print(gdop / solved, 2);
+  Serial.print(F("\t")); Serial.println((float)duration / RUNS, 1);
+}
+
+void setup() {
+  Serial.begin(115200);
+  Serial.println(F("### DW1000Positioning-arduino-test ###"));
+  Serial.println(F("layout\tdim\tanchors\tnoise (m)\tsolved\terror (m)\tresidual (m)\tGDOP\tsolve (us)"));
+  run(F("square"), SQUARE, 4, 2, 10, 10, 0);
+  run(F("square"), SQUARE, 4, 2, 10, 10, 0.1);
+  run(F("square"), SQUARE, 3, 2, 10, 10, 0.1);
+  run(F("corridor"), CORRIDOR, 4, 2, 30, 2, 0.1);
+  run(F("room"), ROOM, 6, 3, 10, 10, 0);
+  run(F("room"), ROOM, 6, 3, 10, 10, 0.1);
+}
+
+void loop() {
+}
@@ -0,0 +1,102 @@
+/*
+ * Decawave DW1000 library for arduino.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @file SPIBenchmark.ino
+ * Measures the SPI cost of typical driver calls: time per call, SPI transactions
+ * per call and bytes (8 bus clock cycles each) per call. Every call is measured
+ * with the default chip select hold time and without any hold time.
+ */
+
+#include <SPI.h>
+#include <DW1000.h>
+
+// connection pins
+const uint8_t PIN_RST = 9; // reset pin
+const uint8_t PIN_IRQ = 2; // irq pin
+const uint8_t PIN_SS = SS; // spi select pin
+
+// calls per measurement
+const uint16_t RUNS = 100;
+
+byte frame[35];
+
+void configure() {
+  DW1000.newConfiguration();
+  DW1000.setDefaults();
+  DW1000.setDeviceAddress(5);
+  DW1000.setNetworkId(10);
+  DW1000.enableMode(DW1000.MODE_LONGDATA_RANGE_LOWPOWER);
+  DW1000.commitConfiguration();
+}
+
+void readFrame() {
+  DW1000.getData(frame, sizeof(frame));
+}
+
+void writeFrame() {
+  DW1000.setData(frame, sizeof(frame));
+}
+
+void readTimestamp() {
+  DW1000Time stamp;
+  DW1000.getSystemTimestamp(stamp);
+}
+
+void readPower() {
+  DW1000.getReceivePower();
+}
+
+void measure(const __FlashStringHelper* name, void (*call)(void), uint16_t runs) {
+  DW1000.resetSPIStatistics();
+  uint32_t start = micros();
+  for(uint16_t i = 0; i < runs; i++) {
+    call();
+  }
+  uint32_t duration = micros() - start;
+  uint32_t transactions = DW1000.getSPITransactionCount();
+  uint32_t bytes = DW1000.getSPIByteCount();
+  uint32_t saved = DW1000.getSPIBytesSaved();
+  Serial.print(name);
+  Serial.print(F("\t")); Serial.print((float)duration / runs, 1); Serial.print(F(" us/call"));
+  Serial.print(F("\t")); Serial.print((float)transactions / runs, 1); Serial.print(F(" transactions/call"));
+  Serial.print(F("\t")); Serial.print((float)bytes / runs, 1); Serial.print(F(" bytes/call"));
+  Serial.print(F("\t")); Serial.print(8.0f * bytes / runs, 0); Serial.print(F(" bus cycles/call"));
+  Serial.print(F("\t")); Serial.print((float)saved / runs, 1); Serial.println(F(" bytes saved/call"));
+}
+
+void setup() {
+  Serial.begin(115200);
+  Serial.println(F("### DW1000-arduino-spi-benchmark ###"));
+  DW1000.begin(PIN_IRQ, PIN_RST);
+  DW1000.select(PIN_SS);
+  configure();
+  memset(frame, 0xA5, sizeof(frame));
+}
+
+void loop() {
+  uint8_t holdTimes[] = {DW1000_SPI_HOLD_TIME_US, 0};
+  for(uint8_t i = 0; i < sizeof(holdTimes); i++) {
+    DW1000.setSPIHoldTime(holdTimes[i]);
+    Serial.print(F("CS hold time: ")); Serial.print(holdTimes[i]); Serial.println(F(" us"));
+    measure(F("getData(35)       "), readFrame, RUNS);
+    measure(F("setData(35)       "), writeFrame, RUNS);
+    measure(F("getSystemTimestamp"), readTimestamp, RUNS);
+    measure(F("getReceivePower   "), readPower, RUNS);
+    measure(F("configuration     "), configure, 10);
+  }
+  DW1000.setSPIHoldTime(DW1000_SPI_HOLD_TIME_US);
+  Serial.println();
+  delay(5000);
+}
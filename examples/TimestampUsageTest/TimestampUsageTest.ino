@@ -23,6 +23,18 @@
 #include <SPI.h>
 #include "DW1000Time.h"
 
+// runs of the time of flight property test
+const uint16_t TOF_RUNS = 1000;
+
+// small deterministic pseudo random generator (xorshift), 40 bit results
+uint64_t randomState = 0x2545F4914F6CDD1DULL;
+uint64_t random40() {
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 7;
+  randomState ^= randomState << 17;
+  return randomState & DW1000Time::TIME_MAX;
+}
+
 void setup() {
   Serial.begin(9600);
   Serial.println(F("### DW1000Time-arduino-test ###"));
@@ -93,6 +105,37 @@ void loop() {
   time4 /= time3;
   Serial.print(F("Time4 is valid?   (YES) ... ")); Serial.println(time4.isValidTimestamp() ? "YES" : "NO");
   Serial.print(F("Time4 is TIME_MAX (YES) ... ")); Serial.println(time4 == DW1000Time::TIME_MAX ? "YES" : "NO");
+  Serial.println();
+  
+  Serial.println(F("test time of flight"));
+  // 1s reply times, products exceed int64
+  uint64_t tof = 1000;
+  uint64_t reply1 = DW1000Time(1, DW1000Time::SECONDS).getTimestamp();
+  uint64_t reply2 = reply1 + 12345;
+  Serial.print(F("TOF long reply   (1000) ... ")); Serial.println(DW1000Time(DW1000Time::computeTimeOfFlight(2*tof + reply1, reply1, 2*tof + reply2, reply2)));
+  Serial.print(F("TOF maximum      (1000) ... "));
+  Serial.println(DW1000Time(DW1000Time::computeTimeOfFlight(DW1000Time::TIME_MAX, DW1000Time::TIME_MAX - 2*tof, DW1000Time::TIME_MAX, DW1000Time::TIME_MAX - 2*tof)));
+  Serial.print(F("TOF invalid     (-1000) ... ")); Serial.println(DW1000Time(DW1000Time::computeTimeOfFlight(reply1, 2*tof + reply1, reply2, 2*tof + reply2)));
+  // with equal clocks the result has to be the exact time of flight for any reply time
+  uint16_t failed = 0;
+  uint32_t duration = 0;
+  for(uint16_t i = 0; i < TOF_RUNS; i++) {
+    tof = random40() % 100000;
+    reply1 = random40() % (DW1000Time::TIME_OVERFLOW - 2*tof);
+    reply2 = random40() % (DW1000Time::TIME_OVERFLOW - 2*tof);
+    uint32_t start = micros();
+    int64_t result = DW1000Time::computeTimeOfFlight(2*tof + reply1, reply1, 2*tof + reply2, reply2);
+    duration += micros() - start;
+    if(result != (int64_t)tof) {
+      failed++;
+    }
+  }
+  Serial.print(F("TOF random failed   (0) ... ")); Serial.println(failed);
+  Serial.print(F("TOF duration [us/call] ... ")); Serial.println((float)duration / TOF_RUNS, 1);
+  time2.setTimestamp(213);
+  Serial.print(F("Time2 range  (999)[mm] ... ")); Serial.println((int32_t)time2.getAsMillimeters());
+  time2.setTimestamp(-DW1000Time::TIME_MAX);
+  Serial.print(F("Time2 range (-5158649049264)[mm] ... ")); Serial.println(DW1000Time(time2.getAsMillimeters()));
   
   Serial.println();
   
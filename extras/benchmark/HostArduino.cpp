@@ -0,0 +1,146 @@
+/*
+ * Decawave DW1000 library for arduino - host benchmarks.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @file HostArduino.cpp
+ * The Arduino core of the simulator shim on the host clock, without a chip:
+ * SPI reads zeros and counts the transfer() calls and bytes, pins do nothing.
+ * Besides the pure functions of the library only the SPI cost of the driver
+ * calls is benchmarked, the rest just has to link.
+ */
+
+#include <chrono>
+#include "Arduino.h"
+#include "SPI.h"
+
+namespace {
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	uint32_t randomState = 1;
+}
+
+/* time */
+
+unsigned long micros() {
+	return (unsigned long)(uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now()-start).count();
+}
+
+unsigned long millis() {
+	return (unsigned long)(uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now()-start).count();
+}
+
+void delay(unsigned long ms) {
+	(void)ms;
+}
+
+void delayMicroseconds(unsigned int us) {
+	(void)us;
+}
+
+/* pins and interrupts */
+
+void pinMode(uint8_t pin, uint8_t mode) {
+	(void)pin;
+	(void)mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+	(void)pin;
+	(void)val;
+}
+
+int digitalRead(uint8_t pin) {
+	(void)pin;
+	return LOW;
+}
+
+int analogRead(uint8_t pin) {
+	(void)pin;
+	return 0;
+}
+
+void attachInterrupt(uint8_t interrupt, void (*handler)(void), int mode) {
+	(void)interrupt;
+	(void)handler;
+	(void)mode;
+}
+
+void detachInterrupt(uint8_t interrupt) {
+	(void)interrupt;
+}
+
+void noInterrupts() {
+}
+
+void interrupts() {
+}
+
+/* random */
+
+void randomSeed(unsigned long seed) {
+	if(seed != 0) {
+		randomState = (uint32_t)seed;
+	}
+}
+
+long random(long howbig) {
+	if(howbig <= 0) {
+		return 0;
+	}
+	randomState = (uint32_t)(((uint64_t)randomState*16807UL) % 2147483647UL);
+	return (long)(randomState % (uint32_t)howbig);
+}
+
+long random(long howsmall, long howbig) {
+	if(howsmall >= howbig) {
+		return howsmall;
+	}
+	return howsmall+random(howbig-howsmall);
+}
+
+/* serial, goes to stderr to keep stdout for the results */
+
+HardwareSerial Serial;
+
+size_t HardwareSerial::write(uint8_t c) {
+	fputc(c, stderr);
+	return 1;
+}
+
+/* SPI */
+
+SPIClass SPI;
+
+// read by the SPI benchmarks
+uint32_t hostSPITransfers = 0;
+uint32_t hostSPIBytes     = 0;
+
+void SPIClass::beginTransaction(SPISettings settings) {
+	(void)settings;
+}
+
+void SPIClass::endTransaction() {
+}
+
+uint8_t SPIClass::transfer(uint8_t data) {
+	(void)data;
+	hostSPITransfers++;
+	hostSPIBytes++;
+	return 0;
+}
+
+void SPIClass::transfer(void* buf, size_t count) {
+	memset(buf, 0, count);
+	hostSPITransfers++;
+	hostSPIBytes += count;
+}
@@ -0,0 +1,565 @@
+/*
+ * Decawave DW1000 library for arduino - host benchmarks.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @file LibraryBenchmarks.cpp
+ * Google Benchmark cases for the pure functions on the ranging path: the
+ * DW1000Time arithmetic, the time of flight, the range bias correction, the
+ * range tracker and the MAC frame headers and views. Every case cycles through a few different inputs so
+ * the compiler cannot fold the work away. The SPI cases count the transfer()
+ * calls and bytes of register reads, writes and driver calls, which do not
+ * depend on the host.
+ */
+
+#include <benchmark/benchmark.h>
+#include "DW1000.h"
+#include "DW1000Mac.h"
+#include "DW1000RangeTracker.h"
+#include "DW1000Ranging.h"
+#include "DW1000Time.h"
+
+namespace {
+	const uint8_t INPUTS = 16;
+
+	// timestamps of one exchange, close to the 40 bit overflow so the intervals wrap
+	struct Exchange {
+		int64_t pollSent, pollReceived, pollAckSent, pollAckReceived, rangeSent, rangeReceived;
+	};
+
+	Exchange exchanges[INPUTS];
+	int64_t timestamps[INPUTS];
+	float microseconds[INPUTS];
+	float receivePowers[INPUTS];
+	byte longAddresses[INPUTS][8];
+	byte shortAddresses[INPUTS][2];
+
+	// about 3 ms reply times, 10 ppm clock offset and a few m between the devices
+	void setUpInputs() {
+		static bool done = false;
+		if(done) {
+			return;
+		}
+		done = true;
+		const int64_t reply = 3000*63898LL;
+		for(uint8_t i = 0; i < INPUTS; i++) {
+			int64_t flight = 200+i*37;
+			Exchange& e = exchanges[i];
+			e.pollSent        = DW1000Time::TIME_OVERFLOW-reply+i*1000003LL;
+			e.pollReceived    = 0x123456789LL+i*7919LL;
+			e.pollAckSent     = e.pollReceived+reply+i*11;
+			e.pollAckReceived = e.pollSent+2*flight+reply+(reply/100000);
+			e.rangeSent       = e.pollAckReceived+reply-i*13;
+			e.rangeReceived   = e.pollAckSent+2*flight+(e.rangeSent-e.pollAckReceived)-(reply/100000);
+			e.pollAckReceived &= DW1000Time::TIME_MAX;
+			e.rangeSent       &= DW1000Time::TIME_MAX;
+			timestamps[i]     = (int64_t)i*0x0F0F0F0F0FLL & DW1000Time::TIME_MAX;
+			microseconds[i]   = 250.0f+i*123.25f;
+			receivePowers[i]  = -60.0f-i*2.4f;
+			for(uint8_t j = 0; j < 8; j++) {
+				longAddresses[i][j] = (byte)(i*8+j);
+			}
+			shortAddresses[i][0] = (byte)(0x12+i);
+			shortAddresses[i][1] = (byte)(0x34+i);
+		}
+	}
+}
+
+/* DW1000Time */
+
+static void BM_DW1000Time_setTimeFloat(benchmark::State& state) {
+	setUpInputs();
+	DW1000Time time;
+	uint8_t i = 0;
+	while(state.KeepRunning()) {
+		time.setTime(microseconds[i++ & (INPUTS-1)]);
+		benchmark::DoNotOptimize(time);
+	}
+}
+BENCHMARK(BM_DW1000Time_setTimeFloat);
+
+static void BM_DW1000Time_fromBytes(benchmark::State& state) {
+	setUpInputs();
+	byte data[INPUTS][DW1000Time::LENGTH_TIMESTAMP];
+	for(uint8_t i = 0; i < INPUTS; i++) {
+		DW1000Time(timestamps[i]).getTimestamp(data[i]);
+	}
+	uint8_t i = 0;
+	while(state.KeepRunning()) {
+		DW1000Time time(data[i++ & (INPUTS-1)]);
+		benchmark::DoNotOptimize(time);
+	}
+}
+BENCHMARK(BM_DW1000Time_fromBytes);
+
+static void BM_DW1000Time_toBytes(benchmark::State& state) {
+	setUpInputs();
+	byte data[DW1000Time::LENGTH_TIMESTAMP];
+	uint8_t i = 0;
+	while(state.KeepRunning()) {
+		DW1000Time(timestamps[i++ & (INPUTS-1)]).getTimestamp(data);
+		benchmark::DoNotOptimize(data);
+	}
+}
+BENCHMARK(BM_DW1000Time_toBytes);
+
+static void BM_DW1000Time_subtract(benchmark::State& state) {
+	setUpInputs();
+	uint8_t i = 0;
+	while(state.KeepRunning()) {
+		const Exchange& e = exchanges[i++ & (INPUTS-1)];
+		DW1000Time round = DW1000Time(e.pollAckReceived)-DW1000Time(e.pollSent);
+		benchmark::DoNotOptimize(round);
+	}
+}
+BENCHMARK(BM_DW1000Time_subtract);
+
+static void BM_DW1000Time_multiplyFloat(benchmark::State& state) {
+	setUpInputs();
+	uint8_t i = 0;
+	while(state.KeepRunning()) {
+		DW1000Time time = DW1000Time(timestamps[i & (INPUTS-1)])*(1.0f+i*1e-6f);
+		benchmark::DoNotOptimize(time);
+		i++;
+	}
+}
+BENCHMARK(BM_DW1000Time_multiplyFloat);
+
+static void BM_DW1000Time_multiplyTime(benchmark::State& state) {
+	setUpInputs();
+	uint8_t i = 0;
+	while(state.KeepRunning()) {
+		DW1000Time time = DW1000Time(timestamps[i & (INPUTS-1)] >> 20)*DW1000Time((int64_t)(i & (INPUTS-1))+1);
+		benchmark::DoNotOptimize(time);
+		i++;
+	}
+}
+BENCHMARK(BM_DW1000Time_multiplyTime);
+
+static void BM_DW1000Time_wrap(benchmark::State& state) {
+	setUpInputs();
+	uint8_t i = 0;
+	while(state.KeepRunning()) {
+		const Exchange& e = exchanges[i++ & (INPUTS-1)];
+		DW1000Time round(e.pollAckReceived-e.pollSent);
+		benchmark::DoNotOptimize(round.wrap());
+	}
+}
+BENCHMARK(BM_DW1000Time_wrap);
+
+static void BM_DW1000Time_getAsMeters(benchmark::State& state) {
+	setUpInputs();
+	uint8_t i = 0;
+	while(state.KeepRunning()) {
+		DW1000Time time((int64_t)exchanges[i++ & (INPUTS-1)].rangeSent & 0xFFFF);
+		benchmark::DoNotOptimize(time.getAsMeters());
+	}
+}
+BENCHMARK(BM_DW1000Time_getAsMeters);
+
+static void BM_DW1000Time_getAsMillimeters(benchmark::State& state) {
+	setUpInputs();
+	uint8_t i = 0;
+	while(state.KeepRunning()) {
+		DW1000Time time((int64_t)exchanges[i++ & (INPUTS-1)].rangeSent & 0xFFFF);
+		benchmark::DoNotOptimize(time.getAsMillimeters());
+	}
+}
+BENCHMARK(BM_DW1000Time_getAsMillimeters);
+
+/* ranging */
+
+// the time of flight DW1000RangingClass::computeRangeAsymmetric computes
+static void BM_computeRangeAsymmetric(benchmark::State& state) {
+	setUpInputs();
+	uint8_t i = 0;
+	while(state.KeepRunning()) {
+		const Exchange& e = exchanges[i++ & (INPUTS-1)];
+		DW1000Time tof(DW1000Time::computeTimeOfFlight(DW1000Time(e.pollSent), DW1000Time(e.pollReceived),
+		                                               DW1000Time(e.pollAckSent), DW1000Time(e.pollAckReceived),
+		                                               DW1000Time(e.rangeSent), DW1000Time(e.rangeReceived)));
+		benchmark::DoNotOptimize(tof.getAsMeters());
+	}
+}
+BENCHMARK(BM_computeRangeAsymmetric);
+
+// channel and pulse repetition frequency select the bias table
+static void BM_correctTimestamp(benchmark::State& state) {
+	setUpInputs();
+	DW1000Class::_channel = (byte)state.range(0);
+	DW1000Class::_pulseFrequency = (byte)state.range(1);
+	uint8_t i = 0;
+	while(state.KeepRunning()) {
+		DW1000Time time(timestamps[i & (INPUTS-1)]);
+		DW1000.correctTimestamp(time, receivePowers[i & (INPUTS-1)]);
+		benchmark::DoNotOptimize(time);
+		i++;
+	}
+}
+BENCHMARK(BM_correctTimestamp)
+	->Args({DW1000Class::CHANNEL_5, DW1000Class::TX_PULSE_FREQ_16MHZ})
+	->Args({DW1000Class::CHANNEL_7, DW1000Class::TX_PULSE_FREQ_64MHZ});
+
+// a tag walking away at 10 ranges per second, with one outlier in every 16 ranges
+static void BM_DW1000RangeTracker_update(benchmark::State& state) {
+	int32_t ranges[INPUTS];
+	for(uint8_t i = 0; i < INPUTS; i++) {
+		ranges[i] = 5000+i*140+(int32_t)(i*37 % 200)-100+(i == 7 ? 1500 : 0);
+	}
+	DW1000RangeTracker tracker;
+	uint32_t time = 0;
+	uint8_t i = 0;
+	while(state.KeepRunning()) {
+		// the same stretch again, the track starts over after the gap
+		time += (i & (INPUTS-1)) == 0 ? RANGE_TRACKER_MAX_GAP+1 : 100;
+		benchmark::DoNotOptimize(tracker.update(ranges[i++ & (INPUTS-1)], time));
+		benchmark::DoNotOptimize(tracker.getRange());
+	}
+}
+BENCHMARK(BM_DW1000RangeTracker_update);
+
+/* MAC, reverseArray runs inside all of them */
+
+static void BM_DW1000Mac_generateBlinkFrame(benchmark::State& state) {
+	setUpInputs();
+	DW1000Mac mac;
+	byte frame[LEN_DATA];
+	uint8_t i = 0;
+	while(state.KeepRunning()) {
+		mac.generateBlinkFrame(frame, longAddresses[i & (INPUTS-1)], shortAddresses[i & (INPUTS-1)]);
+		benchmark::DoNotOptimize(frame);
+		i++;
+	}
+}
+BENCHMARK(BM_DW1000Mac_generateBlinkFrame);
+
+static void BM_DW1000Mac_generateShortMACFrame(benchmark::State& state) {
+	setUpInputs();
+	DW1000Mac mac;
+	byte frame[LEN_DATA];
+	uint8_t i = 0;
+	while(state.KeepRunning()) {
+		mac.generateShortMACFrame(frame, shortAddresses[i & (INPUTS-1)], shortAddresses[(i+1) & (INPUTS-1)]);
+		benchmark::DoNotOptimize(frame);
+		i++;
+	}
+}
+BENCHMARK(BM_DW1000Mac_generateShortMACFrame);
+
+static void BM_DW1000Mac_generateLongMACFrame(benchmark::State& state) {
+	setUpInputs();
+	DW1000Mac mac;
+	byte frame[LEN_DATA];
+	uint8_t i = 0;
+	while(state.KeepRunning()) {
+		mac.generateLongMACFrame(frame, shortAddresses[i & (INPUTS-1)], longAddresses[i & (INPUTS-1)]);
+		benchmark::DoNotOptimize(frame);
+		i++;
+	}
+}
+BENCHMARK(BM_DW1000Mac_generateLongMACFrame);
+
+static void BM_DW1000Mac_decodeBlinkFrame(benchmark::State& state) {
+	setUpInputs();
+	DW1000Mac mac;
+	byte frames[INPUTS][LEN_DATA];
+	for(uint8_t i = 0; i < INPUTS; i++) {
+		mac.generateBlinkFrame(frames[i], longAddresses[i], shortAddresses[i]);
+	}
+	byte address[8];
+	byte shortAddress[2];
+	uint8_t i = 0;
+	while(state.KeepRunning()) {
+		mac.decodeBlinkFrame(frames[i++ & (INPUTS-1)], address, shortAddress);
+		benchmark::DoNotOptimize(address);
+		benchmark::DoNotOptimize(shortAddress);
+	}
+}
+BENCHMARK(BM_DW1000Mac_decodeBlinkFrame);
+
+static void BM_DW1000Mac_decodeShortMACFrame(benchmark::State& state) {
+	setUpInputs();
+	DW1000Mac mac;
+	byte frames[INPUTS][LEN_DATA];
+	for(uint8_t i = 0; i < INPUTS; i++) {
+		mac.generateShortMACFrame(frames[i], shortAddresses[i], shortAddresses[(i+1) & (INPUTS-1)]);
+	}
+	byte address[2];
+	uint8_t i = 0;
+	while(state.KeepRunning()) {
+		mac.decodeShortMACFrame(frames[i++ & (INPUTS-1)], address);
+		benchmark::DoNotOptimize(address);
+	}
+}
+BENCHMARK(BM_DW1000Mac_decodeShortMACFrame);
+
+static void BM_DW1000Mac_decodeLongMACFrame(benchmark::State& state) {
+	setUpInputs();
+	DW1000Mac mac;
+	byte frames[INPUTS][LEN_DATA];
+	for(uint8_t i = 0; i < INPUTS; i++) {
+		mac.generateLongMACFrame(frames[i], shortAddresses[i], longAddresses[i]);
+	}
+	byte address[2];
+	uint8_t i = 0;
+	while(state.KeepRunning()) {
+		mac.decodeLongMACFrame(frames[i++ & (INPUTS-1)], address);
+		benchmark::DoNotOptimize(address);
+	}
+}
+BENCHMARK(BM_DW1000Mac_decodeLongMACFrame);
+
+// what the anchor reads of every frame it hears: destination, source and function code
+static void BM_DW1000Mac_getAddresses(benchmark::State& state) {
+	setUpInputs();
+	DW1000Mac mac;
+	byte frames[INPUTS][LEN_DATA];
+	for(uint8_t i = 0; i < INPUTS; i++) {
+		mac.generateShortMACFrame(frames[i], shortAddresses[i], shortAddresses[(i+1) & (INPUTS-1)]);
+		frames[i][SHORT_MAC_LEN] = POLL_ACK;
+	}
+	uint8_t i = 0;
+	while(state.KeepRunning()) {
+		byte* frame = frames[i++ & (INPUTS-1)];
+		byte receiver[2], sender[2];
+		mac.getReceiverAddress(frame, receiver);
+		mac.getSenderAddress(frame, sender);
+		benchmark::DoNotOptimize((uint16_t)((receiver[1] << 8) | receiver[0]));
+		benchmark::DoNotOptimize((uint16_t)((sender[1] << 8) | sender[0]));
+		benchmark::DoNotOptimize(DW1000RangingClass::detectMessageType(frame, LEN_POLL_ACK));
+	}
+}
+BENCHMARK(BM_DW1000Mac_getAddresses);
+
+static void BM_ShortMacFrameView(benchmark::State& state) {
+	setUpInputs();
+	DW1000Mac mac;
+	byte frames[INPUTS][LEN_DATA];
+	for(uint8_t i = 0; i < INPUTS; i++) {
+		mac.generateShortMACFrame(frames[i], shortAddresses[i], shortAddresses[(i+1) & (INPUTS-1)]);
+		frames[i][SHORT_MAC_LEN] = POLL_ACK;
+	}
+	uint8_t i = 0;
+	while(state.KeepRunning()) {
+		const byte* frame = frames[i++ & (INPUTS-1)];
+		ShortMacFrameView view(frame);
+		benchmark::DoNotOptimize(ShortMacFrameView::matches(frame, LEN_POLL_ACK));
+		benchmark::DoNotOptimize(view.getDestination());
+		benchmark::DoNotOptimize(view.getSource());
+		benchmark::DoNotOptimize(view.getPayload()[0]);
+	}
+}
+BENCHMARK(BM_ShortMacFrameView);
+
+static void BM_LongMacFrameView(benchmark::State& state) {
+	setUpInputs();
+	DW1000Mac mac;
+	byte frames[INPUTS][LEN_DATA];
+	for(uint8_t i = 0; i < INPUTS; i++) {
+		mac.generateLongMACFrame(frames[i], shortAddresses[i], longAddresses[i]);
+		frames[i][LONG_MAC_LEN] = RANGING_INIT;
+	}
+	uint8_t i = 0;
+	while(state.KeepRunning()) {
+		LongMacFrameView view(frames[i++ & (INPUTS-1)]);
+		benchmark::DoNotOptimize(view.getDestination());
+		benchmark::DoNotOptimize(view.getSource());
+	}
+}
+BENCHMARK(BM_LongMacFrameView);
+
+static void BM_BlinkFrameView(benchmark::State& state) {
+	setUpInputs();
+	DW1000Mac mac;
+	byte frames[INPUTS][LEN_DATA];
+	for(uint8_t i = 0; i < INPUTS; i++) {
+		mac.generateBlinkFrame(frames[i], longAddresses[i], shortAddresses[i]);
+	}
+	uint8_t i = 0;
+	while(state.KeepRunning()) {
+		BlinkFrameView view(frames[i++ & (INPUTS-1)]);
+		benchmark::DoNotOptimize(view.getSource());
+		benchmark::DoNotOptimize(view.getSourceShort());
+	}
+}
+BENCHMARK(BM_BlinkFrameView);
+
+// the header of a POLL_ACK, as the anchor and the tag decode every frame
+static void BM_DW1000Mac_encodeHeader(benchmark::State& state) {
+	setUpInputs();
+	MacHeader header;
+	header.panIdCompression = true;
+	header.destinationMode = MAC_ADDRESS_SHORT;
+	header.sourceMode = MAC_ADDRESS_SHORT;
+	byte frame[MAC_HEADER_MAX_LEN];
+	uint8_t i = 0;
+	while(state.KeepRunning()) {
+		header.destination = shortAddresses[i & (INPUTS-1)][0];
+		header.source = shortAddresses[(i+1) & (INPUTS-1)][0];
+		i++;
+		benchmark::DoNotOptimize(DW1000Mac::encodeHeader(header, frame));
+		benchmark::ClobberMemory();
+	}
+}
+BENCHMARK(BM_DW1000Mac_encodeHeader);
+
+static void BM_DW1000Mac_decodeHeader(benchmark::State& state) {
+	setUpInputs();
+	DW1000Mac mac;
+	byte frames[INPUTS][LEN_DATA];
+	for(uint8_t i = 0; i < INPUTS; i++) {
+		mac.generateShortMACFrame(frames[i], shortAddresses[i], shortAddresses[(i+1) & (INPUTS-1)]);
+		frames[i][SHORT_MAC_LEN] = POLL_ACK;
+	}
+	uint8_t i = 0;
+	while(state.KeepRunning()) {
+		MacHeader header;
+		benchmark::DoNotOptimize(DW1000Mac::decodeHeader(frames[i++ & (INPUTS-1)], LEN_POLL_ACK, header));
+		benchmark::DoNotOptimize(header.destination);
+		benchmark::DoNotOptimize(header.source);
+	}
+}
+BENCHMARK(BM_DW1000Mac_decodeHeader);
+
+/* SPI, transfer() calls and bytes (8 bus clock cycles each) per call in the counters */
+
+// counted by the SPI of HostArduino.cpp
+extern uint32_t hostSPITransfers;
+extern uint32_t hostSPIBytes;
+
+namespace {
+	void setUpChip() {
+		static bool done = false;
+		if(done) {
+			return;
+		}
+		done = true;
+		DW1000.begin(2, 9);
+		DW1000.select(10);
+	}
+
+	void configure() {
+		DW1000.newConfiguration();
+		DW1000.setDefaults();
+		DW1000.setDeviceAddress(5);
+		DW1000.setNetworkId(10);
+		DW1000.enableMode(DW1000.MODE_LONGDATA_RANGE_LOWPOWER);
+		DW1000.commitConfiguration();
+	}
+
+	void startCounting() {
+		hostSPITransfers = 0;
+		hostSPIBytes = 0;
+		DW1000.resetSPIStatistics();
+	}
+
+	void setSPICounters(benchmark::State& state) {
+		state.counters["transfers"] = benchmark::Counter(hostSPITransfers, benchmark::Counter::kAvgIterations);
+		state.counters["bytes"] = benchmark::Counter(hostSPIBytes, benchmark::Counter::kAvgIterations);
+		state.counters["saved"] = benchmark::Counter(DW1000.getSPIBytesSaved(), benchmark::Counter::kAvgIterations);
+	}
+}
+
+// register, sub address (none, short or extended) and length
+static void BM_DW1000_readBytes(benchmark::State& state) {
+	setUpChip();
+	byte data[LEN_DATA];
+	startCounting();
+	while(state.KeepRunning()) {
+		DW1000.readBytes((byte)state.range(0), (uint16_t)state.range(1), data, (uint16_t)state.range(2));
+		benchmark::DoNotOptimize(data);
+	}
+	setSPICounters(state);
+}
+BENCHMARK(BM_DW1000_readBytes)
+	->Args({SYS_STATUS, NO_SUB, LEN_SYS_STATUS})
+	->Args({RX_TIME, RX_STAMP_SUB, LEN_RX_STAMP})
+	->Args({LDE_IF, LDE_CFG2_SUB, LEN_LDE_CFG2})
+	->Args({RX_BUFFER, NO_SUB, LEN_DATA});
+
+static void BM_DW1000_writeBytes(benchmark::State& state) {
+	setUpChip();
+	byte data[LEN_DATA] = {0};
+	startCounting();
+	while(state.KeepRunning()) {
+		DW1000.writeBytes((byte)state.range(0), (uint16_t)state.range(1), data, (uint16_t)state.range(2));
+		benchmark::ClobberMemory();
+	}
+	setSPICounters(state);
+}
+BENCHMARK(BM_DW1000_writeBytes)
+	->Args({SYS_CTRL, NO_SUB, LEN_SYS_CTRL})
+	->Args({DX_TIME, NO_SUB, LEN_DX_TIME})
+	->Args({LDE_IF, LDE_CFG2_SUB, LEN_LDE_CFG2})
+	->Args({TX_BUFFER, NO_SUB, LEN_DATA});
+
+// the same configuration again, the shadowed registers are not written
+static void BM_DW1000_commitConfiguration(benchmark::State& state) {
+	setUpChip();
+	configure();
+	startCounting();
+	while(state.KeepRunning()) {
+		configure();
+	}
+	setSPICounters(state);
+}
+BENCHMARK(BM_DW1000_commitConfiguration);
+
+// the calls of examples/SPIBenchmark, with a frame of a POLL_ACK and then some
+static void BM_DW1000_getData(benchmark::State& state) {
+	setUpChip();
+	byte frame[35];
+	startCounting();
+	while(state.KeepRunning()) {
+		DW1000.getData(frame, sizeof(frame));
+		benchmark::DoNotOptimize(frame);
+	}
+	setSPICounters(state);
+}
+BENCHMARK(BM_DW1000_getData);
+
+static void BM_DW1000_setData(benchmark::State& state) {
+	setUpChip();
+	byte frame[35] = {0};
+	startCounting();
+	while(state.KeepRunning()) {
+		DW1000.setData(frame, sizeof(frame));
+		benchmark::ClobberMemory();
+	}
+	setSPICounters(state);
+}
+BENCHMARK(BM_DW1000_setData);
+
+static void BM_DW1000_getSystemTimestamp(benchmark::State& state) {
+	setUpChip();
+	startCounting();
+	while(state.KeepRunning()) {
+		DW1000Time stamp;
+		DW1000.getSystemTimestamp(stamp);
+		benchmark::DoNotOptimize(stamp);
+	}
+	setSPICounters(state);
+}
+BENCHMARK(BM_DW1000_getSystemTimestamp);
+
+static void BM_DW1000_getReceivePower(benchmark::State& state) {
+	setUpChip();
+	startCounting();
+	while(state.KeepRunning()) {
+		benchmark::DoNotOptimize(DW1000.getReceivePower());
+	}
+	setSPICounters(state);
+}
+BENCHMARK(BM_DW1000_getReceivePower);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+"""Compares two Google Benchmark JSON files by the median CPU time of each
+benchmark, and the SPI cases by their transfer() calls and bytes per call.
+Exits with 1 if one got slower by more than the threshold, needs more SPI
+transfers or bytes, or is missing from the current run.
+
+    python3 compare.py baseline.json current.json [threshold percent, default 25]
+"""
+
+import json
+import sys
+
+
+SPI_COUNTERS = ("transfers", "bytes")
+
+
+def medians(path):
+    with open(path) as f:
+        results = json.load(f)
+    times = {}
+    counters = {}
+    for benchmark in results["benchmarks"]:
+        # runs without repetitions have no aggregates
+        if benchmark.get("aggregate_name", "median") != "median":
+            continue
+        name = benchmark["run_name"] if "run_name" in benchmark else benchmark["name"]
+        times[name] = benchmark["cpu_time"]
+        if all(counter in benchmark for counter in SPI_COUNTERS):
+            counters[name] = [benchmark[counter] for counter in SPI_COUNTERS]
+    return times, counters
+
+
+def main():
+    if len(sys.argv) < 3:
+        print(__doc__)
+        return 2
+    baseline, baselineCounters = medians(sys.argv[1])
+    current, currentCounters = medians(sys.argv[2])
+    threshold = float(sys.argv[3]) if len(sys.argv) > 3 else 25.0
+    slower = 0
+    missing = 0
+    print("%-40s %12s %12s %8s" % ("benchmark", "baseline ns", "current ns", "change"))
+    for name, time in current.items():
+        if name not in baseline:
+            print("%-40s %12s %12.2f %8s" % (name, "-", time, "new"))
+            continue
+        change = (time - baseline[name]) / baseline[name] * 100
+        mark = ""
+        if change > threshold:
+            mark = " slower"
+            slower += 1
+        print("%-40s %12.2f %12.2f %+7.1f%%%s" % (name, baseline[name], time, change, mark))
+    # a renamed or removed case would hide its regression otherwise
+    for name, time in baseline.items():
+        if name not in current:
+            print("%-40s %12.2f %12s %8s" % (name, time, "-", "missing"))
+            missing += 1
+    # exact, unlike the times, so any increase counts
+    more = 0
+    if currentCounters:
+        print()
+        print("%-40s %21s %21s" % ("SPI per call", "transfers", "bytes"))
+    for name, counters in currentCounters.items():
+        if name not in baselineCounters:
+            print("%-40s %10s %10.1f %10s %10.1f" % (name, "-", counters[0], "-", counters[1]))
+            continue
+        old = baselineCounters[name]
+        mark = ""
+        if counters[0] > old[0] or counters[1] > old[1]:
+            mark = " more"
+            more += 1
+        print("%-40s %10.1f %10.1f %10.1f %10.1f%s" % (name, old[0], counters[0], old[1], counters[1], mark))
+    return 1 if slower or missing or more else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,90 @@
+/*
+ * Decawave DW1000 library for arduino - host simulator.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @file SimApi.h
+ * Interface between the simulator host and one simulated node. Every node is
+ * a private copy of the node library (the DW1000 driver, the Arduino shim and
+ * the register model), so the static driver state is separate per node.
+ */
+
+#ifndef SIM_API_H
+#define SIM_API_H
+
+#include <stdint.h>
+
+// all simulator times are true (reference) time in picoseconds
+typedef int64_t sim_time_t;
+
+#define SIM_ROLE_TAG    0
+#define SIM_ROLE_ANCHOR 1
+
+struct SimFrame {
+	const uint8_t* data;
+	uint16_t       length;      // PHY payload length incl. CRC
+	uint8_t        dataRate;    // TRX_RATE_* of the driver
+	uint8_t        prf;         // TX_PULSE_FREQ_*
+	uint8_t        preamble;    // TX_PREAMBLE_LEN_*
+	uint8_t        channel;
+	sim_time_t     start;       // first preamble symbol leaves the antenna
+	sim_time_t     rmarker;     // ranging marker leaves the antenna
+	sim_time_t     end;         // last symbol leaves the antenna
+};
+
+// callbacks from a node into the simulator host
+struct SimHostApi {
+	void* host;
+	void (*transmit)(void* host, int node, const SimFrame* frame);
+	void (*newRange)(void* host, int node, uint16_t peer, float range, float rxPower);
+	void (*log)(void* host, int node, const char* line);
+};
+
+struct SimNodeConfig {
+	int      node;
+	int      role;
+	char     eui[32];
+	uint8_t  mode[3];
+	double   clockDriftPpm;   // crystal offset of the DW1000 clock
+	uint64_t clockOffset;     // initial 40 bit counter value
+	double   mcuDriftPpm;     // crystal offset of the MCU clock (millis(), micros(), delay())
+	uint32_t mcuOffset;       // micros() at power-up
+	sim_time_t powerUp;       // simulated time the node starts at
+	uint32_t seed;
+	int      verbose;
+	bool     filter;          // useFrameFilter()
+	// DW1000Ranging options of the tags
+	bool     broadcast;       // useBroadcastRanging()
+	bool     packed;          // usePackedTimestamps()
+	uint16_t rate;            // setTargetRate(), 0 for as fast as possible
+};
+
+// functions exported by each node instance
+typedef int        (*sim_node_create_fn)(const SimNodeConfig* config, const SimHostApi* api);
+typedef void       (*sim_node_setup_fn)(void);
+typedef sim_time_t (*sim_node_step_fn)(void);
+typedef sim_time_t (*sim_node_now_fn)(void);
+typedef void       (*sim_node_receive_fn)(const SimFrame* frame, sim_time_t arrival, float rxPowerDbm);
+typedef void       (*sim_node_stats_fn)(uint32_t stats[8]);
+
+// indices of sim_node_stats_fn values
+#define SIM_STAT_SPI_TRANSACTIONS 0
+#define SIM_STAT_SPI_BYTES        1
+#define SIM_STAT_INTERRUPTS       2
+#define SIM_STAT_RX_GOOD          3
+#define SIM_STAT_RX_MISSED        4
+#define SIM_STAT_RX_FILTERED      5
+#define SIM_STAT_LATE_TX          6
+#define SIM_STAT_RX_OVERRUN       7
+
+#endif // SIM_API_H
@@ -0,0 +1,511 @@
+/*
+ * Decawave DW1000 library for arduino - host simulator.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @file Simulator.cpp
+ * Runs several nodes of the unmodified library against each other over a
+ * simulated UWB channel. Every node is loaded from its own copy of the node
+ * library so each has its own DW1000/DW1000Ranging state. The node that is
+ * furthest behind in time always runs next, one loop() at a time.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include "SimApi.h"
+
+namespace {
+	const double SPEED_OF_LIGHT = 299792458.0;
+	const sim_time_t SECOND = 1000000000000LL;
+	// nodes power up spread over more than one DW1000Ranging timer period (60 ms), so
+	// the timers of the tags do not tick in step
+	const sim_time_t POWER_UP_SPREAD = SECOND/10;
+
+	struct Node {
+		SimNodeConfig config;
+		void*  handle;
+		std::string path;
+		double x, y;
+		uint16_t shortAddress;
+		sim_node_create_fn        create;
+		sim_node_setup_fn         setup;
+		sim_node_step_fn          step;
+		sim_node_now_fn           now;
+		sim_node_receive_fn       receive;
+		sim_node_stats_fn         stats;
+	};
+
+	struct PairStats {
+		uint32_t count;
+		double   sumError;
+		double   sumSquaredError;
+		std::vector<double> absErrors;
+		std::vector<double> gaps;   // ms between two ranges
+		sim_time_t first;
+		sim_time_t last;
+	};
+
+	struct AirFrame {
+		int        node;
+		sim_time_t start;
+		sim_time_t end;
+		bool       collided;
+	};
+
+	struct Options {
+		int         tags;
+		int         anchors;
+		double      duration;
+		double      drift;
+		double      mcuDrift;
+		double      loss;
+		double      area;
+		std::string mode;
+		uint32_t    seed;
+		int         verbose;
+		bool        filter;
+		bool        broadcast;
+		bool        packed;
+		int         rate;
+		bool        json;
+		std::string library;
+	};
+
+	struct Host {
+		Options             options;
+		std::vector<Node>   nodes;
+		std::map<uint16_t, int> byShortAddress;
+		std::map<std::pair<int, int>, PairStats> pairs;
+		std::vector<AirFrame> air;
+		uint32_t            frames;
+		uint32_t            collisions;
+		uint32_t            lost;
+		uint32_t            randomState;
+		SimHostApi          api;
+	};
+
+	double uniform(Host* host) {
+		host->randomState = host->randomState*1664525UL+1013904223UL;
+		return (double)(host->randomState >> 8)/16777216.0;
+	}
+
+	double distance(const Node& a, const Node& b) {
+		return sqrt((a.x-b.x)*(a.x-b.x)+(a.y-b.y)*(a.y-b.y));
+	}
+
+	void onTransmit(void* context, int node, const SimFrame* frame) {
+		Host* host = (Host*)context;
+		host->frames++;
+		AirFrame f = {node, frame->start, frame->end, false};
+		for(size_t i = 0; i < host->air.size(); i++) {
+			AirFrame& other = host->air[i];
+			if(other.start < f.end && f.start < other.end) {
+				if(!other.collided) {
+					host->collisions++;
+				}
+				if(!f.collided) {
+					host->collisions++;
+				}
+				other.collided = true;
+				f.collided = true;
+			}
+		}
+		host->air.push_back(f);
+		if(host->options.verbose > 2) {
+			printf("%10.6f node %d sends %u bytes [%02X %02X ... %02X], on air %.6f..%.6f\n", (double)host->nodes[node].now()/SECOND, node,
+			       frame->length, frame->data[0], frame->data[1], frame->length > 15 ? frame->data[15] : 0,
+			       (double)frame->start/SECOND, (double)frame->end/SECOND);
+		}
+		// keep the last few frames only
+		if(host->air.size() > 64) {
+			host->air.erase(host->air.begin());
+		}
+		const Node& sender = host->nodes[node];
+		for(size_t i = 0; i < host->nodes.size(); i++) {
+			if((int)i == node) {
+				continue;
+			}
+			if(host->options.loss > 0.0 && uniform(host) < host->options.loss) {
+				host->lost++;
+				continue;
+			}
+			Node& receiver = host->nodes[i];
+			double d = distance(sender, receiver);
+			sim_time_t propagation = (sim_time_t)llround(d/SPEED_OF_LIGHT*1e12);
+			float power = (float)(-45.0-20.0*log10(d < 0.5 ? 0.5 : d));
+			receiver.receive(frame, frame->rmarker+propagation, power);
+		}
+	}
+
+	void onNewRange(void* context, int node, uint16_t peer, float range, float rxPower) {
+		(void)rxPower;
+		Host* host = (Host*)context;
+		std::map<uint16_t, int>::iterator it = host->byShortAddress.find(peer);
+		if(it == host->byShortAddress.end()) {
+			return;
+		}
+		const Node& a = host->nodes[node];
+		const Node& b = host->nodes[it->second];
+		double error = (double)range-distance(a, b);
+		PairStats& s = host->pairs[std::make_pair(node, it->second)];
+		sim_time_t now = a.now();
+		if(s.count == 0) {
+			s.first = now;
+		} else {
+			s.gaps.push_back((double)(now-s.last)*1000.0/SECOND);
+		}
+		s.last = now;
+		s.count++;
+		s.sumError += error;
+		s.sumSquaredError += error*error;
+		s.absErrors.push_back(fabs(error));
+		if(host->options.verbose > 1) {
+			printf("%10.6f node %d range to %04X: %.3f m (true %.3f m)\n", (double)now/SECOND, node, peer, range, distance(a, b));
+		}
+	}
+
+	void onLog(void* context, int node, const char* line) {
+		Host* host = (Host*)context;
+		printf("%10.6f [%d] %s\n", (double)host->nodes[node].now()/SECOND, node, line);
+	}
+
+	bool parseMode(const std::string& name, uint8_t mode[3]) {
+		struct { const char* name; uint8_t mode[3]; } modes[] = {
+			{"longdata_range_lowpower", {0x00, 0x01, 0x0A}},
+			{"shortdata_fast_lowpower", {0x02, 0x01, 0x05}},
+			{"longdata_fast_lowpower",  {0x02, 0x01, 0x02}},
+			{"shortdata_fast_accuracy", {0x02, 0x02, 0x05}},
+			{"longdata_fast_accuracy",  {0x02, 0x02, 0x02}},
+			{"longdata_range_accuracy", {0x00, 0x02, 0x0A}},
+		};
+		for(size_t i = 0; i < sizeof(modes)/sizeof(modes[0]); i++) {
+			if(name == modes[i].name) {
+				memcpy(mode, modes[i].mode, 3);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void usage(const char* program) {
+		fprintf(stderr,
+		        "usage: %s [options]\n"
+		        "  --tags N         number of tags (default 1)\n"
+		        "  --anchors N      number of anchors (default 1)\n"
+		        "  --duration S     simulated seconds (default 10)\n"
+		        "  --drift PPM      max. clock offset of the DW1000 of a node (default 10)\n"
+		        "  --mcu-drift PPM  max. clock offset of the MCU of a node (default 100)\n"
+		        "  --loss P         probability to lose a frame on a link (default 0)\n"
+		        "  --area M         side of the square the nodes are placed in (default 10)\n"
+		        "  --mode NAME      longdata_range_accuracy (default), longdata_range_lowpower,\n"
+		        "                   shortdata_fast_lowpower, longdata_fast_lowpower,\n"
+		        "                   shortdata_fast_accuracy, longdata_fast_accuracy\n"
+		        "  --seed N         random seed (default 1)\n"
+		        "  --no-filter      the DW1000s interrupt for frames to other devices (useFrameFilter)\n"
+		        "  --broadcast      tags range with all anchors at once (useBroadcastRanging)\n"
+		        "  --packed         tags send 32 bit intervals (usePackedTimestamps)\n"
+		        "  --rate HZ        ranges per second and anchor a tag aims for (setTargetRate)\n"
+		        "  --verbose N      1: serial output of the nodes, 2: every range, 3: every frame\n"
+		        "  --json           print the summary as JSON\n"
+		        "  --library PATH   node library (default ./dw1000node.so)\n",
+		        program);
+	}
+
+	bool loadNode(Host* host, Node& node, int index) {
+		char path[256];
+		snprintf(path, sizeof(path), "/tmp/dw1000sim-%d-%d.so", (int)getpid(), index);
+		std::string command = "cp '"+host->options.library+"' '"+path+"'";
+		if(system(command.c_str()) != 0) {
+			fprintf(stderr, "cannot copy %s\n", host->options.library.c_str());
+			return false;
+		}
+		node.path = path;
+		node.handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+		if(!node.handle) {
+			fprintf(stderr, "%s\n", dlerror());
+			return false;
+		}
+		node.create         = (sim_node_create_fn)dlsym(node.handle, "sim_node_create");
+		node.setup          = (sim_node_setup_fn)dlsym(node.handle, "sim_node_setup");
+		node.step           = (sim_node_step_fn)dlsym(node.handle, "sim_node_step");
+		node.now            = (sim_node_now_fn)dlsym(node.handle, "sim_node_now");
+		node.receive        = (sim_node_receive_fn)dlsym(node.handle, "sim_node_receive");
+		node.stats          = (sim_node_stats_fn)dlsym(node.handle, "sim_node_stats");
+		if(!node.create || !node.setup || !node.step || !node.now || !node.receive || !node.stats) {
+			fprintf(stderr, "%s: missing sim_node_* functions\n", path);
+			return false;
+		}
+		return true;
+	}
+
+	double percentile(std::vector<double> values, double p) {
+		if(values.empty()) {
+			return 0.0;
+		}
+		std::sort(values.begin(), values.end());
+		size_t index = (size_t)(p*(values.size()-1)+0.5);
+		return values[index];
+	}
+}
+
+int main(int argc, char** argv) {
+	Host* host = new Host();
+	Options& options = host->options;
+	options.tags     = 1;
+	options.anchors  = 1;
+	options.duration = 10.0;
+	options.drift    = 10.0;
+	options.mcuDrift = 100.0;
+	options.loss     = 0.0;
+	options.area     = 10.0;
+	options.mode     = "longdata_range_accuracy";
+	options.seed     = 1;
+	options.verbose  = 0;
+	options.filter   = true;
+	options.broadcast = false;
+	options.packed   = false;
+	options.rate     = 0;
+	options.json     = false;
+	options.library  = "./dw1000node.so";
+	for(int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool hasValue = i+1 < argc;
+		if(arg == "--tags" && hasValue) {
+			options.tags = atoi(argv[++i]);
+		} else if(arg == "--anchors" && hasValue) {
+			options.anchors = atoi(argv[++i]);
+		} else if(arg == "--duration" && hasValue) {
+			options.duration = atof(argv[++i]);
+		} else if(arg == "--drift" && hasValue) {
+			options.drift = atof(argv[++i]);
+		} else if(arg == "--mcu-drift" && hasValue) {
+			options.mcuDrift = atof(argv[++i]);
+		} else if(arg == "--loss" && hasValue) {
+			options.loss = atof(argv[++i]);
+		} else if(arg == "--area" && hasValue) {
+			options.area = atof(argv[++i]);
+		} else if(arg == "--mode" && hasValue) {
+			options.mode = argv[++i];
+		} else if(arg == "--seed" && hasValue) {
+			options.seed = (uint32_t)strtoul(argv[++i], 0, 0);
+		} else if(arg == "--verbose" && hasValue) {
+			options.verbose = atoi(argv[++i]);
+		} else if(arg == "--no-filter") {
+			options.filter = false;
+		} else if(arg == "--broadcast") {
+			options.broadcast = true;
+		} else if(arg == "--packed") {
+			options.packed = true;
+		} else if(arg == "--rate" && hasValue) {
+			options.rate = atoi(argv[++i]);
+		} else if(arg == "--json") {
+			options.json = true;
+		} else if(arg == "--library" && hasValue) {
+			options.library = argv[++i];
+		} else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	uint8_t mode[3];
+	if(!parseMode(options.mode, mode) || options.tags < 0 || options.anchors < 0 || options.tags+options.anchors < 2) {
+		usage(argv[0]);
+		return 1;
+	}
+	host->randomState = options.seed*2654435761UL+1;
+	host->api.host     = host;
+	host->api.transmit = onTransmit;
+	host->api.newRange = onNewRange;
+	host->api.log      = onLog;
+
+	int count = options.tags+options.anchors;
+	host->nodes.resize(count);
+	for(int i = 0; i < count; i++) {
+		Node& node = host->nodes[i];
+		bool anchor = i < options.anchors;
+		memset(&node.config, 0, sizeof(node.config));
+		node.config.node = i;
+		node.config.role = anchor ? SIM_ROLE_ANCHOR : SIM_ROLE_TAG;
+		// short address XX12 for anchors, XX98 for tags (see DW1000Ranging::isLikely*)
+		snprintf(node.config.eui, sizeof(node.config.eui), "%02X:%s:5B:D5:A9:9A:E2:9C", i+1, anchor ? "12" : "98");
+		node.shortAddress = (uint16_t)((anchor ? 0x1200 : 0x9800) | (i+1));
+		memcpy(node.config.mode, mode, 3);
+		node.config.clockDriftPpm = (2.0*uniform(host)-1.0)*options.drift;
+		node.config.clockOffset   = (uint64_t)(uniform(host)*1099511627776.0);
+		node.config.seed          = (uint32_t)(uniform(host)*4294967295.0);
+		// every MCU has its own crystal and was switched on at its own time
+		node.config.mcuDriftPpm   = (2.0*uniform(host)-1.0)*options.mcuDrift;
+		node.config.mcuOffset     = (uint32_t)(uniform(host)*60.0e6);
+		node.config.powerUp       = (sim_time_t)(uniform(host)*POWER_UP_SPREAD);
+		node.config.verbose       = options.verbose;
+		node.config.filter        = options.filter;
+		node.config.broadcast     = options.broadcast;
+		node.config.packed        = options.packed;
+		node.config.rate          = (uint16_t)options.rate;
+		if(anchor) {
+			// anchors around the border, tags anywhere
+			double t = options.anchors > 0 ? (double)i/options.anchors : 0.0;
+			double perimeter = 4.0*t;
+			int side = (int)perimeter;
+			double along = (perimeter-side)*options.area;
+			switch(side) {
+			case 0: node.x = along; node.y = 0.0; break;
+			case 1: node.x = options.area; node.y = along; break;
+			case 2: node.x = options.area-along; node.y = options.area; break;
+			default: node.x = 0.0; node.y = options.area-along; break;
+			}
+		} else {
+			node.x = 0.1*options.area+0.8*options.area*uniform(host);
+			node.y = 0.1*options.area+0.8*options.area*uniform(host);
+		}
+		if(!loadNode(host, node, i)) {
+			return 1;
+		}
+		node.create(&node.config, &host->api);
+	}
+	for(int i = 0; i < count; i++) {
+		host->nodes[i].setup();
+		host->byShortAddress[host->nodes[i].shortAddress] = i;
+		unlink(host->nodes[i].path.c_str());
+	}
+
+	sim_time_t end = (sim_time_t)(options.duration*SECOND);
+	sim_time_t start = 0;
+	for(int i = 0; i < count; i++) {
+		start = std::max(start, host->nodes[i].now());
+	}
+	for(;;) {
+		int next = 0;
+		sim_time_t earliest = host->nodes[0].now();
+		for(int i = 1; i < count; i++) {
+			sim_time_t t = host->nodes[i].now();
+			if(t < earliest) {
+				earliest = t;
+				next = i;
+			}
+		}
+		if(earliest >= end) {
+			break;
+		}
+		host->nodes[next].step();
+	}
+
+	// summary, with the tag/anchor pairs that never ranged
+	for(int i = 0; i < options.anchors; i++) {
+		for(int k = options.anchors; k < count; k++) {
+			host->pairs[std::make_pair(i, k)];
+			host->pairs[std::make_pair(k, i)];
+		}
+	}
+	double seconds = (double)(end-start)/SECOND;
+	uint32_t totals[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+	for(int i = 0; i < count; i++) {
+		uint32_t s[8];
+		host->nodes[i].stats(s);
+		for(int k = 0; k < 8; k++) {
+			totals[k] += s[k];
+		}
+	}
+	uint32_t ranges = 0;
+	double sumSquared = 0.0;
+	double sumError = 0.0;
+	std::vector<double> absErrors;
+	std::vector<double> gaps;
+	int silent = 0;
+	for(std::map<std::pair<int, int>, PairStats>::iterator it = host->pairs.begin(); it != host->pairs.end(); ++it) {
+		if(it->second.count == 0) {
+			silent++;
+		}
+		ranges += it->second.count;
+		sumSquared += it->second.sumSquaredError;
+		sumError += it->second.sumError;
+		absErrors.insert(absErrors.end(), it->second.absErrors.begin(), it->second.absErrors.end());
+		gaps.insert(gaps.end(), it->second.gaps.begin(), it->second.gaps.end());
+	}
+	double rms  = ranges ? sqrt(sumSquared/ranges) : 0.0;
+	double bias = ranges ? sumError/ranges : 0.0;
+	double p95  = percentile(absErrors, 0.95);
+	// how old the last range of a pair gets
+	double gapMedian = percentile(gaps, 0.5);
+	double gapP95    = percentile(gaps, 0.95);
+	double gapMax    = percentile(gaps, 1.0);
+	if(options.json) {
+		printf("{\"tags\": %d, \"anchors\": %d, \"mode\": \"%s\", \"seconds\": %.3f, \"seed\": %u,\n",
+		       options.tags, options.anchors, options.mode.c_str(), seconds, options.seed);
+		printf(" \"filter\": %s, \"broadcast\": %s, \"packed\": %s, \"rate\": %d,\n", options.filter ? "true" : "false",
+		       options.broadcast ? "true" : "false", options.packed ? "true" : "false", options.rate);
+		printf(" \"ranges\": %u, \"ranges_per_second\": %.2f, \"bias_m\": %.4f, \"rms_error_m\": %.4f, \"p95_abs_error_m\": %.4f,\n",
+		       ranges, ranges/seconds, bias, rms, p95);
+		printf(" \"silent_pairs\": %d,\n", silent);
+		printf(" \"gap_median_ms\": %.3f, \"gap_p95_ms\": %.3f, \"gap_max_ms\": %.3f,\n", gapMedian, gapP95, gapMax);
+		printf(" \"frames\": %u, \"collisions\": %u, \"lost\": %u, \"rx_good\": %u, \"rx_missed\": %u, \"rx_filtered\": %u, \"rx_overrun\": %u, \"late_tx\": %u,\n",
+		       host->frames, host->collisions, host->lost, totals[SIM_STAT_RX_GOOD], totals[SIM_STAT_RX_MISSED],
+		       totals[SIM_STAT_RX_FILTERED], totals[SIM_STAT_RX_OVERRUN], totals[SIM_STAT_LATE_TX]);
+		printf(" \"spi_transactions_per_second\": %.1f, \"spi_bytes_per_second\": %.1f, \"interrupts\": %u,\n",
+		       totals[SIM_STAT_SPI_TRANSACTIONS]/seconds/count, totals[SIM_STAT_SPI_BYTES]/seconds/count, totals[SIM_STAT_INTERRUPTS]);
+		printf(" \"pairs\": [");
+		bool first = true;
+		for(std::map<std::pair<int, int>, PairStats>::iterator it = host->pairs.begin(); it != host->pairs.end(); ++it) {
+			const PairStats& s = it->second;
+			if(s.count == 0) {
+				printf("%s\n  {\"node\": %d, \"peer\": %d, \"ranges\": 0, \"rate_hz\": 0.00, \"bias_m\": null, \"rms_error_m\": null}",
+				       first ? "" : ",", it->first.first, it->first.second);
+			} else {
+				printf("%s\n  {\"node\": %d, \"peer\": %d, \"ranges\": %u, \"rate_hz\": %.2f, \"bias_m\": %.4f, \"rms_error_m\": %.4f}",
+				       first ? "" : ",", it->first.first, it->first.second, s.count, s.count/seconds,
+				       s.sumError/s.count, sqrt(s.sumSquaredError/s.count));
+			}
+			first = false;
+		}
+		printf("\n ]}\n");
+	} else {
+		printf("%d tags, %d anchors, %s%s%s%s, %.1f s simulated\n", options.tags, options.anchors, options.mode.c_str(),
+		       options.filter ? "" : ", no filter", options.broadcast ? ", broadcast" : "", options.packed ? ", packed" : "", seconds);
+		for(int i = 0; i < count; i++) {
+			const Node& n = host->nodes[i];
+			printf("  node %d %-6s %04X at (%5.2f, %5.2f), clock %+6.2f ppm, mcu %+7.2f ppm, up at %.3f s\n", i,
+			       n.config.role == SIM_ROLE_ANCHOR ? "anchor" : "tag", n.shortAddress, n.x, n.y, n.config.clockDriftPpm,
+			       n.config.mcuDriftPpm, (double)n.config.powerUp/SECOND);
+		}
+		printf("ranges:       %u (%.2f/s), bias %.4f m, rms error %.4f m, p95 |error| %.4f m\n", ranges, ranges/seconds, bias, rms, p95);
+		for(std::map<std::pair<int, int>, PairStats>::iterator it = host->pairs.begin(); it != host->pairs.end(); ++it) {
+			const PairStats& s = it->second;
+			if(s.count == 0) {
+				printf("  %d -> %d: %6u ranges  NO RANGES\n", it->first.first, it->first.second, s.count);
+			} else {
+				printf("  %d -> %d: %6u ranges, %6.2f/s, bias %+.4f m, rms %.4f m\n", it->first.first, it->first.second,
+				       s.count, s.count/seconds, s.sumError/s.count, sqrt(s.sumSquaredError/s.count));
+			}
+		}
+		if(silent > 0) {
+			printf("silent pairs: %d of %d tag/anchor pairs never ranged\n", silent, (int)host->pairs.size());
+		}
+		printf("range gaps:   median %.3f ms, p95 %.3f ms, max %.3f ms\n", gapMedian, gapP95, gapMax);
+		printf("frames:       %u sent, %u collided, %u lost on links\n", host->frames, host->collisions, host->lost);
+		printf("reception:    %u good, %u missed, %u filtered, %u overrun, %u late tx\n", totals[SIM_STAT_RX_GOOD],
+		       totals[SIM_STAT_RX_MISSED], totals[SIM_STAT_RX_FILTERED], totals[SIM_STAT_RX_OVERRUN], totals[SIM_STAT_LATE_TX]);
+		printf("spi per node: %.0f transactions/s, %.0f bytes/s, %u interrupts total\n",
+		       totals[SIM_STAT_SPI_TRANSACTIONS]/seconds/count, totals[SIM_STAT_SPI_BYTES]/seconds/count, totals[SIM_STAT_INTERRUPTS]);
+	}
+	// skip the static destructors of the nodes, the library calls millis() from some of them
+	fflush(stdout);
+	_exit(0);
+}
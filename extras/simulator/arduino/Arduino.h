@@ -0,0 +1,168 @@
+/*
+ * Decawave DW1000 library for arduino - host simulator.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @file Arduino.h
+ * Minimal Arduino core for building the library on a Linux host. Only what
+ * the library and the simulated sketches use is provided; time only advances
+ * through the calls below (see SimArduino.cpp).
+ */
+
+#ifndef SIM_ARDUINO_H
+#define SIM_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+
+typedef uint8_t byte;
+typedef bool    boolean;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT  0x0
+#define OUTPUT 0x1
+
+#define CHANGE  1
+#define FALLING 2
+#define RISING  3
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define SS 10
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper*>(s))
+
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit) ((value) |= (1UL << (bit)))
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+#define bitWrite(value, bit, bitvalue) ((bitvalue) ? bitSet(value, bit) : bitClear(value, bit))
+#define digitalPinToInterrupt(p) (p)
+#define PI 3.1415926535897932384626433832795
+#define sq(x) ((x) * (x))
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int  digitalRead(uint8_t pin);
+int  analogRead(uint8_t pin);
+void attachInterrupt(uint8_t interrupt, void (*isr)(void), int mode);
+void detachInterrupt(uint8_t interrupt);
+void noInterrupts();
+void interrupts();
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+class String {
+public:
+	String() {}
+	String(const char* s) : _s(s ? s : "") {}
+	String(const std::string& s) : _s(s) {}
+	unsigned int length() const { return (unsigned int)_s.size(); }
+	const char* c_str() const { return _s.c_str(); }
+	void getBytes(unsigned char* buf, unsigned int bufsize, unsigned int index = 0) const {
+		if(bufsize == 0) {
+			return;
+		}
+		unsigned int n = 0;
+		for(; n + 1 < bufsize && index + n < _s.size(); n++) {
+			buf[n] = (unsigned char)_s[index + n];
+		}
+		buf[n] = 0;
+	}
+	void remove(unsigned int index) { if(index < _s.size()) _s.erase(index); }
+	String& operator=(const char* s) { _s = s ? s : ""; return *this; }
+	String& operator+=(char c) { _s += c; return *this; }
+	String& operator+=(const String& s) { _s += s._s; return *this; }
+	bool operator==(const String& s) const { return _s == s._s; }
+private:
+	std::string _s;
+};
+
+class Print;
+
+class Printable {
+public:
+	virtual ~Printable() {}
+	virtual size_t printTo(Print& p) const = 0;
+};
+
+class Print {
+public:
+	virtual ~Print() {}
+	virtual size_t write(uint8_t c) = 0;
+	size_t write(const uint8_t* buf, size_t n) { for(size_t i = 0; i < n; i++) write(buf[i]); return n; }
+	size_t print(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+	size_t print(const String& s) { return print(s.c_str()); }
+	size_t print(const __FlashStringHelper* s) { return print(reinterpret_cast<const char*>(s)); }
+	size_t print(char c) { return write((uint8_t)c); }
+	size_t print(unsigned char v, int base = DEC) { return print((unsigned long)v, base); }
+	size_t print(int v, int base = DEC) { return print((long)v, base); }
+	size_t print(unsigned int v, int base = DEC) { return print((unsigned long)v, base); }
+	size_t print(long v, int base = DEC) {
+		if(base == DEC) { return printFormatted("%ld", v); }
+		return print((unsigned long)v, base);
+	}
+	size_t print(unsigned long v, int base = DEC) {
+		if(base == HEX) { return printFormatted("%lX", v); }
+		if(base == OCT) { return printFormatted("%lo", v); }
+		return printFormatted("%lu", v);
+	}
+	size_t print(long long v, int base = DEC) { return print((long)v, base); }
+	size_t print(unsigned long long v, int base = DEC) { return print((unsigned long)v, base); }
+	size_t print(double v, int digits = 2) {
+		char fmt[8];
+		snprintf(fmt, sizeof(fmt), "%%.%df", digits);
+		return printFormatted(fmt, v);
+	}
+	size_t print(const Printable& p) { return p.printTo(*this); }
+	size_t println() { return print("\n"); }
+	template<typename T> size_t println(const T& v) { size_t n = print(v); return n + println(); }
+	template<typename T> size_t println(const T& v, int arg) { size_t n = print(v, arg); return n + println(); }
+private:
+	template<typename T> size_t printFormatted(const char* fmt, T v) {
+		char buf[48];
+		snprintf(buf, sizeof(buf), fmt, v);
+		return print((const char*)buf);
+	}
+};
+
+class HardwareSerial : public Print {
+public:
+	void begin(unsigned long) {}
+	void end() {}
+	int available() { return 0; }
+	int read() { return -1; }
+	void flush() {}
+	size_t write(uint8_t c);
+	using Print::write;
+	operator bool() { return true; }
+};
+
+extern HardwareSerial Serial;
+
+#endif // SIM_ARDUINO_H
@@ -0,0 +1,50 @@
+/*
+ * Decawave DW1000 library for arduino - host simulator.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @file SPI.h
+ * SPI shim for the host simulator; all transfers go to the DW1000 register
+ * model of the node.
+ */
+
+#ifndef SIM_SPI_H
+#define SIM_SPI_H
+
+#include "Arduino.h"
+
+#define MSBFIRST 1
+#define LSBFIRST 0
+#define SPI_MODE0 0x00
+
+class SPISettings {
+public:
+	SPISettings() : _clock(4000000) {}
+	SPISettings(uint32_t clock, uint8_t bitOrder, uint8_t dataMode) : _clock(clock) { (void)bitOrder; (void)dataMode; }
+	uint32_t _clock;
+};
+
+class SPIClass {
+public:
+	void begin() {}
+	void end() {}
+	void beginTransaction(SPISettings settings);
+	void endTransaction();
+	uint8_t transfer(uint8_t data);
+	void transfer(void* buf, size_t count);
+	void usingInterrupt(uint8_t) {}
+};
+
+extern SPIClass SPI;
+
+#endif // SIM_SPI_H
@@ -0,0 +1,63 @@
+/*
+ * Decawave DW1000 library for arduino - host simulator.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @file Airtime.h
+ * IEEE 802.15.4a frame durations for the DW1000 modes (user manual,
+ * chapter 10.3 / appendix 3).
+ */
+
+#ifndef SIM_AIRTIME_H
+#define SIM_AIRTIME_H
+
+#include "../SimApi.h"
+
+namespace Airtime {
+	// preamble length for the TX_PREAMBLE_LEN_* (TXPSR/PE) code
+	inline uint32_t preambleSymbols(uint8_t code) {
+		switch(code & 0x0F) {
+		case 0x01: return 64;
+		case 0x05: return 128;
+		case 0x09: return 256;
+		case 0x0D: return 512;
+		case 0x02: return 1024;
+		case 0x06: return 1536;
+		case 0x0A: return 2048;
+		case 0x03: return 4096;
+		default:   return 1024;
+		}
+	}
+
+	// preamble symbol duration in ps
+	inline sim_time_t symbolTime(uint8_t prf) {
+		return prf == 0x02 ? 1017630 : 993590;
+	}
+
+	// synchronisation header (preamble + SFD) up to the ranging marker
+	inline sim_time_t preambleAndSfd(uint8_t rate, uint8_t prf, uint8_t preamble) {
+		uint32_t sfd = rate == 0x00 ? 64 : (rate == 0x01 ? 16 : 8);
+		return (sim_time_t)(preambleSymbols(preamble)+sfd)*symbolTime(prf);
+	}
+
+	// PHY header and Reed-Solomon coded payload after the ranging marker
+	inline sim_time_t phrAndPayload(uint8_t rate, uint16_t length) {
+		sim_time_t phrBit  = rate == 0x00 ? 8205128 : 1025641;
+		sim_time_t dataBit = rate == 0x00 ? 8205128 : (rate == 0x01 ? 1025641 : 128205);
+		uint32_t bits = (uint32_t)length*8;
+		bits += 48*((bits+329)/330);
+		return 21*phrBit+(sim_time_t)bits*dataBit;
+	}
+}
+
+#endif // SIM_AIRTIME_H
@@ -0,0 +1,590 @@
+/*
+ * Decawave DW1000 library for arduino - host simulator.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @file DW1000Model.cpp
+ * Register level model of one DW1000 (see DW1000Model.h).
+ */
+
+#include <math.h>
+#include <string.h>
+#include "DW1000Model.h"
+#include "Airtime.h"
+
+namespace {
+	// register ids (DW1000 user manual, chapter 7)
+	const uint8_t R_DEV_ID     = 0x00;
+	const uint8_t R_EUI        = 0x01;
+	const uint8_t R_PANADR     = 0x03;
+	const uint8_t R_SYS_CFG    = 0x04;
+	const uint8_t R_SYS_TIME   = 0x06;
+	const uint8_t R_TX_FCTRL   = 0x08;
+	const uint8_t R_TX_BUFFER  = 0x09;
+	const uint8_t R_DX_TIME    = 0x0A;
+	const uint8_t R_SYS_CTRL   = 0x0D;
+	const uint8_t R_SYS_MASK   = 0x0E;
+	const uint8_t R_SYS_STATUS = 0x0F;
+	const uint8_t R_RX_FINFO   = 0x10;
+	const uint8_t R_RX_BUFFER  = 0x11;
+	const uint8_t R_RX_FQUAL   = 0x12;
+	const uint8_t R_RX_TIME    = 0x15;
+	const uint8_t R_TX_TIME    = 0x17;
+	const uint8_t R_TX_ANTD    = 0x18;
+	const uint8_t R_PMSC       = 0x36;
+
+	// SYS_CFG
+	const uint32_t CFG_FFEN     = 1UL << 0;
+	const uint32_t CFG_FFBC     = 1UL << 1;
+	const uint32_t CFG_FFAB     = 1UL << 2;
+	const uint32_t CFG_FFAD     = 1UL << 3;
+	const uint32_t CFG_FFAA     = 1UL << 4;
+	const uint32_t CFG_FFAM     = 1UL << 5;
+	const uint32_t CFG_FFAR     = 1UL << 6;
+	const uint32_t CFG_FFA4     = 1UL << 7;
+	const uint32_t CFG_FFA5     = 1UL << 8;
+	const uint32_t CFG_DIS_DRXB = 1UL << 12;
+	const uint32_t CFG_RXAUTR   = 1UL << 29;
+
+	// SYS_CTRL
+	const uint32_t CTRL_TXSTRT = 1UL << 1;
+	const uint32_t CTRL_TXDLYS = 1UL << 2;
+	const uint32_t CTRL_TRXOFF = 1UL << 6;
+	const uint32_t CTRL_RXENAB = 1UL << 8;
+	const uint32_t CTRL_HRBPT  = 1UL << 24;
+
+	// SYS_STATUS
+	const uint64_t ST_TX_DONE  = 0xF0ULL;               // TXFRB, TXPRS, TXPHS, TXFRS
+	const uint64_t ST_RX_GOOD  = 0x6F00ULL;             // RXPRD, RXSFDD, LDEDONE, RXPHD, RXDFR, RXFCG
+	const uint64_t ST_RXOVRR   = 1ULL << 20;
+	const uint64_t ST_HPDWARN  = 1ULL << 27;
+	const uint64_t ST_HSRBP    = 1ULL << 30;
+	const uint64_t ST_ICRBP    = 1ULL << 31;
+	const uint64_t ST_CPLOCK   = 1ULL << 1;
+
+	const uint64_t MASK40 = 0xFFFFFFFFFFULL;
+	const double   TICKS_PER_PS = 0.0638976;
+	const sim_time_t TX_TURNAROUND = 5000000LL; // 5 us
+
+	// keep arrivals this long after their end for collision checks
+	const sim_time_t ARRIVAL_HISTORY = 20000000000LL; // 20 ms
+}
+
+DW1000Model::DW1000Model() {
+	_node = 0;
+	_ticksPerPs = TICKS_PER_PS;
+	_clockOffset = 0;
+	_api = 0;
+	_selected = false;
+	_headerLen = 0;
+	_headerNeeded = 1;
+	_write = false;
+	_regId = 0;
+	_offset = 0;
+	_writeStart = 0;
+	_status = ST_CPLOCK;
+	_irqLevel = false;
+	_irqEdge = false;
+	_rxEnabled = false;
+	_rxEnabledSince = 0;
+	_rxPendingAfterTx = false;
+	_txActive = false;
+	_txStart = 0;
+	_txEnd = 0;
+	_txStamp = 0;
+	_icBuffer = 0;
+	_hostBuffer = 0;
+	_lastEnd = 0;
+	memset(stats, 0, sizeof(stats));
+	for(int i = 0; i < 2; i++) {
+		memset(_rxBuffers[i].finfo, 0, sizeof(_rxBuffers[i].finfo));
+		memset(_rxBuffers[i].fqual, 0, sizeof(_rxBuffers[i].fqual));
+		memset(_rxBuffers[i].rxtime, 0, sizeof(_rxBuffers[i].rxtime));
+		_rxBuffers[i].full = false;
+	}
+	// reset values the library relies on
+	std::vector<uint8_t>& devId = reg(R_DEV_ID, 4);
+	devId[0] = 0x30; devId[1] = 0x01; devId[2] = 0xCA; devId[3] = 0xDE;
+	std::vector<uint8_t>& syscfg = reg(R_SYS_CFG, 4);
+	syscfg[1] = 0x12; // DIS_DRXB, HIRQ_POL
+}
+
+void DW1000Model::configure(int node, double clockDriftPpm, uint64_t clockOffset, const SimHostApi* api) {
+	_node = node;
+	_ticksPerPs = TICKS_PER_PS*(1.0+clockDriftPpm*1e-6);
+	_clockOffset = clockOffset & MASK40;
+	_api = api;
+}
+
+uint64_t DW1000Model::localTicks(sim_time_t t) const {
+	return (_clockOffset+(uint64_t)floor((double)t*_ticksPerPs)) & MASK40;
+}
+
+sim_time_t DW1000Model::trueTimeOf(uint64_t ticks, sim_time_t now) const {
+	uint64_t delta = (ticks-localTicks(now)) & MASK40;
+	return now+(sim_time_t)ceil((double)delta/_ticksPerPs);
+}
+
+std::vector<uint8_t>& DW1000Model::reg(uint8_t id, uint32_t minLength) {
+	std::vector<uint8_t>& r = _regs[id & 0x3F];
+	if(r.size() < minLength) {
+		r.resize(minLength, 0);
+	}
+	return r;
+}
+
+uint32_t DW1000Model::readReg32(uint8_t id, uint16_t offset) {
+	std::vector<uint8_t>& r = reg(id, offset+4);
+	return (uint32_t)r[offset] | ((uint32_t)r[offset+1] << 8) | ((uint32_t)r[offset+2] << 16) | ((uint32_t)r[offset+3] << 24);
+}
+
+uint64_t DW1000Model::readReg40(uint8_t id, uint16_t offset) {
+	std::vector<uint8_t>& r = reg(id, offset+5);
+	uint64_t v = 0;
+	for(int i = 4; i >= 0; i--) {
+		v = (v << 8) | r[offset+i];
+	}
+	return v;
+}
+
+bool DW1000Model::doubleBuffered() {
+	return (readReg32(R_SYS_CFG, 0) & CFG_DIS_DRXB) == 0;
+}
+
+/* ###########################################################################
+ * #### SPI ##################################################################
+ * ######################################################################### */
+
+void DW1000Model::select(sim_time_t now) {
+	(void)now;
+	_selected = true;
+	_headerLen = 0;
+	_headerNeeded = 1;
+	_written.clear();
+	stats[SIM_STAT_SPI_TRANSACTIONS]++;
+}
+
+uint8_t DW1000Model::readByte(uint8_t id, uint32_t offset) {
+	const RxBuffer& rx = _rxBuffers[_hostBuffer];
+	switch(id) {
+	case R_SYS_STATUS: {
+		uint64_t st = _status & ~(ST_HSRBP | ST_ICRBP);
+		if(_hostBuffer) {
+			st |= ST_HSRBP;
+		}
+		if(_icBuffer) {
+			st |= ST_ICRBP;
+		}
+		return offset < 5 ? (uint8_t)(st >> (8*offset)) : 0;
+	}
+	case R_SYS_CTRL:
+		return 0;
+	case R_RX_FINFO:
+		return offset < sizeof(rx.finfo) ? rx.finfo[offset] : 0;
+	case R_RX_FQUAL:
+		return offset < sizeof(rx.fqual) ? rx.fqual[offset] : 0;
+	case R_RX_TIME:
+		return offset < sizeof(rx.rxtime) ? rx.rxtime[offset] : 0;
+	case R_RX_BUFFER:
+		return offset < rx.frame.size() ? rx.frame[offset] : 0;
+	default:
+		return reg(id, offset+1)[offset];
+	}
+}
+
+uint8_t DW1000Model::transfer(uint8_t mosi, sim_time_t now) {
+	if(!_selected) {
+		return 0;
+	}
+	stats[SIM_STAT_SPI_BYTES]++;
+	if(_headerLen < _headerNeeded) {
+		_header[_headerLen++] = mosi;
+		if(_headerLen == 1) {
+			_write = (mosi & 0x80) != 0;
+			_regId = mosi & 0x3F;
+			_offset = 0;
+			if(mosi & 0x40) {
+				_headerNeeded = 2;
+			}
+		} else if(_headerLen == 2) {
+			_offset = mosi & 0x7F;
+			if(mosi & 0x80) {
+				_headerNeeded = 3;
+			}
+		} else {
+			_offset |= (uint32_t)mosi << 7;
+		}
+		if(_headerLen == _headerNeeded) {
+			_writeStart = _offset;
+			if(!_write && _regId == R_SYS_TIME) {
+				uint64_t t = localTicks(now) & ~0x1FFULL;
+				std::vector<uint8_t>& r = reg(R_SYS_TIME, 5);
+				for(int i = 0; i < 5; i++) {
+					r[i] = (uint8_t)(t >> (8*i));
+				}
+			}
+		}
+		return 0;
+	}
+	if(_write) {
+		_written.push_back(mosi);
+		_offset++;
+		return 0;
+	}
+	return readByte(_regId, _offset++);
+}
+
+void DW1000Model::deselect(sim_time_t now) {
+	if(!_selected) {
+		return;
+	}
+	_selected = false;
+	if(!_write || _written.empty()) {
+		return;
+	}
+	if(_regId == R_SYS_STATUS) {
+		// write one to clear
+		for(size_t i = 0; i < _written.size() && _writeStart+i < 5; i++) {
+			_status &= ~((uint64_t)_written[i] << (8*(_writeStart+i)));
+		}
+		_status |= ST_CPLOCK;
+		updateIrq();
+		return;
+	}
+	if(_regId == R_SYS_CTRL) {
+		uint32_t sysctrl = 0;
+		for(size_t i = 0; i < _written.size() && _writeStart+i < 4; i++) {
+			sysctrl |= (uint32_t)_written[i] << (8*(_writeStart+i));
+		}
+		command(sysctrl, now);
+		updateIrq();
+		return;
+	}
+	if(_regId == R_PMSC && _writeStart <= 3 && _writeStart+_written.size() > 3 &&
+	   !(_written[3-_writeStart] & 0x10)) {
+		// SOFTRESET bit of the receiver: frames in the buffers are gone, the pointers stay
+		_rxEnabled = false;
+		_rxBuffers[0].full = false;
+		_rxBuffers[1].full = false;
+	}
+	std::vector<uint8_t>& r = reg(_regId, _writeStart+_written.size());
+	memcpy(&r[_writeStart], &_written[0], _written.size());
+	if(_regId == R_SYS_MASK) {
+		updateIrq();
+	}
+}
+
+/* ###########################################################################
+ * #### Transceiver ##########################################################
+ * ######################################################################### */
+
+void DW1000Model::command(uint32_t sysctrl, sim_time_t now) {
+	if(sysctrl & CTRL_TRXOFF) {
+		_rxEnabled = false;
+		_rxPendingAfterTx = false;
+		if(_txActive && _txStart > now) {
+			// delayed transmission not started yet
+			_txActive = false;
+		}
+	}
+	if(sysctrl & CTRL_HRBPT) {
+		_rxBuffers[_hostBuffer].full = false;
+		_hostBuffer ^= 1;
+		if(_rxBuffers[_hostBuffer].full) {
+			_status |= ST_RX_GOOD;
+		} else {
+			_status &= ~ST_RX_GOOD;
+		}
+	}
+	if(sysctrl & CTRL_TXSTRT) {
+		startTransmit((sysctrl & CTRL_TXDLYS) != 0, now);
+	}
+	if(sysctrl & CTRL_RXENAB) {
+		if(_txActive) {
+			_rxPendingAfterTx = true;
+		} else if(!_rxEnabled) {
+			_rxEnabled = true;
+			_rxEnabledSince = now;
+		}
+	}
+}
+
+void DW1000Model::startTransmit(bool delayed, sim_time_t now) {
+	if(_txActive) {
+		return;
+	}
+	uint32_t fctrl    = readReg32(R_TX_FCTRL, 0);
+	uint16_t len      = fctrl & 0x3FF;
+	uint8_t  rate     = (fctrl >> 13) & 0x03;
+	uint8_t  prf      = (fctrl >> 16) & 0x03;
+	uint8_t  preamble = (fctrl >> 18) & 0x0F;
+	uint8_t  channel  = reg(0x1F, 4)[0] & 0x0F;
+	std::vector<uint8_t>& txbuf = reg(R_TX_BUFFER, len);
+	_txData.assign(txbuf.begin(), txbuf.begin()+len);
+
+	std::vector<uint8_t>& antdReg = reg(R_TX_ANTD, 2);
+	uint16_t antd = (uint16_t)antdReg[0] | ((uint16_t)antdReg[1] << 8);
+	sim_time_t antdPs = (sim_time_t)((double)antd/_ticksPerPs);
+	sim_time_t shr = Airtime::preambleAndSfd(rate, prf, preamble);
+	sim_time_t rmarker;
+	if(delayed) {
+		uint64_t dx = readReg40(R_DX_TIME, 0) & ~0x1FFULL;
+		uint64_t delta = (dx-localTicks(now)) & MASK40;
+		if(delta > (MASK40 >> 1) || (sim_time_t)((double)delta/_ticksPerPs) < shr) {
+			// too late, the chip waits for the counter to come around again
+			_status |= ST_HPDWARN;
+			stats[SIM_STAT_LATE_TX]++;
+		}
+		rmarker = trueTimeOf(dx, now)+antdPs;
+		_txStamp = (dx+antd) & MASK40;
+	} else {
+		rmarker = now+TX_TURNAROUND+shr;
+		_txStamp = localTicks(rmarker);
+	}
+	SimFrame frame;
+	frame.data     = _txData.empty() ? 0 : &_txData[0];
+	frame.length   = len;
+	frame.dataRate = rate;
+	frame.prf      = prf;
+	frame.preamble = preamble;
+	frame.channel  = channel;
+	frame.rmarker  = rmarker;
+	frame.start    = rmarker-shr;
+	frame.end      = rmarker+Airtime::phrAndPayload(rate, len);
+	_txActive  = true;
+	_txStart   = frame.start;
+	_txEnd     = frame.end;
+	_rxEnabled = false;
+	if(_api && _api->transmit) {
+		_api->transmit(_api->host, _node, &frame);
+	}
+}
+
+void DW1000Model::receive(const SimFrame& frame, sim_time_t arrival, float rxPowerDbm) {
+	Arrival a;
+	a.data.assign(frame.data, frame.data+frame.length);
+	a.frame = frame;
+	sim_time_t shift = arrival-frame.rmarker;
+	a.frame.start   += shift;
+	a.frame.rmarker += shift;
+	a.frame.end     += shift;
+	a.frame.data     = 0;
+	a.rxPower  = rxPowerDbm;
+	a.collided = false;
+	a.processed = false;
+	// any overlap at this receiver destroys both frames
+	std::deque<Arrival>::iterator pos = _arrivals.end();
+	for(std::deque<Arrival>::iterator it = _arrivals.begin(); it != _arrivals.end(); ++it) {
+		if(it->frame.start < a.frame.end && a.frame.start < it->frame.end) {
+			it->collided = true;
+			a.collided   = true;
+		}
+		if(pos == _arrivals.end() && it->frame.end > a.frame.end) {
+			pos = it;
+		}
+	}
+	_arrivals.insert(pos, a);
+}
+
+bool DW1000Model::accept(const std::vector<uint8_t>& frame) {
+	uint32_t cfg = readReg32(R_SYS_CFG, 0);
+	if(!(cfg & CFG_FFEN)) {
+		return true;
+	}
+	if(frame.size() < 1) {
+		return false;
+	}
+	uint16_t fc = frame[0] | (frame.size() > 1 ? (frame[1] << 8) : 0);
+	uint8_t type = fc & 0x07;
+	bool allowed;
+	switch(type) {
+	case 0: allowed = (cfg & CFG_FFAB) != 0; break;
+	case 1: allowed = (cfg & CFG_FFAD) != 0; break;
+	case 2: allowed = (cfg & CFG_FFAA) != 0; break;
+	case 3: allowed = (cfg & CFG_FFAM) != 0; break;
+	case 4: allowed = (cfg & (CFG_FFA4 | CFG_FFAR)) != 0; break;
+	case 5: allowed = (cfg & (CFG_FFA5 | CFG_FFAR)) != 0; break;
+	default: allowed = (cfg & CFG_FFAR) != 0; break;
+	}
+	if(!allowed) {
+		return false;
+	}
+	if(type == 2 || type >= 4) {
+		return true;
+	}
+	std::vector<uint8_t>& panadr = reg(R_PANADR, 4);
+	std::vector<uint8_t>& eui = reg(R_EUI, 8);
+	uint16_t myShort = panadr[0] | (panadr[1] << 8);
+	uint16_t myPan   = panadr[2] | (panadr[3] << 8);
+	uint8_t  dstMode = (fc >> 10) & 0x03;
+	size_t   idx     = 3;
+	if(dstMode == 0) {
+		return (cfg & CFG_FFBC) != 0;
+	}
+	if(frame.size() < idx+2) {
+		return false;
+	}
+	uint16_t dstPan = frame[idx] | (frame[idx+1] << 8);
+	idx += 2;
+	if(dstPan != 0xFFFF && dstPan != myPan) {
+		return false;
+	}
+	if(dstMode == 2) {
+		if(frame.size() < idx+2) {
+			return false;
+		}
+		uint16_t dst = frame[idx] | (frame[idx+1] << 8);
+		return dst == 0xFFFF || dst == myShort;
+	}
+	if(dstMode == 3) {
+		if(frame.size() < idx+8) {
+			return false;
+		}
+		return memcmp(&frame[idx], &eui[0], 8) == 0;
+	}
+	return false;
+}
+
+void DW1000Model::deliver(Arrival& a) {
+	bool ownTx = _txActive && _txStart < a.frame.end;
+	if(a.collided || ownTx || !_rxEnabled || _rxEnabledSince > a.frame.start) {
+		stats[SIM_STAT_RX_MISSED]++;
+		return;
+	}
+	if(!accept(a.data)) {
+		stats[SIM_STAT_RX_FILTERED]++;
+		return;
+	}
+	bool dbl = doubleBuffered();
+	uint8_t target = dbl ? _icBuffer : 0;
+	RxBuffer& rx = _rxBuffers[target];
+	if(dbl && rx.full) {
+		_status |= ST_RXOVRR;
+		stats[SIM_STAT_RX_OVERRUN]++;
+		return;
+	}
+	rx.frame = a.data;
+	uint16_t len = a.frame.length;
+	uint32_t rxpacc = Airtime::preambleSymbols(a.frame.preamble);
+	rxpacc = rxpacc > 24 ? rxpacc-24 : rxpacc;
+	if(rxpacc > 0xFFF) {
+		rxpacc = 0xFFF;
+	}
+	uint32_t finfo = (len & 0x3FF) | ((uint32_t)(a.frame.dataRate & 0x03) << 13) |
+	                 ((uint32_t)(a.frame.prf & 0x03) << 16) | ((uint32_t)(a.frame.preamble & 0x03) << 18) |
+	                 (rxpacc << 20);
+	for(int i = 0; i < 4; i++) {
+		rx.finfo[i] = (uint8_t)(finfo >> (8*i));
+	}
+	// quality values matching the received power (see getReceivePower())
+	double A = (a.frame.prf == 0x01) ? 113.77 : 121.74;
+	double n2 = (double)rxpacc*(double)rxpacc;
+	double cir = pow(10.0, (a.rxPower+A)/10.0)*n2/131072.0;
+	double fp = sqrt(pow(10.0, (a.rxPower-1.5+A)/10.0)*n2/3.0);
+	uint16_t cirPwr = cir > 65535.0 ? 65535 : (uint16_t)cir;
+	uint16_t fpAmpl = fp > 65535.0 ? 65535 : (uint16_t)fp;
+	uint16_t noise  = 40;
+	uint16_t fqual[4] = {noise, fpAmpl, fpAmpl, cirPwr};
+	for(int i = 0; i < 4; i++) {
+		rx.fqual[2*i]   = (uint8_t)fqual[i];
+		rx.fqual[2*i+1] = (uint8_t)(fqual[i] >> 8);
+	}
+	uint64_t stamp = localTicks(a.frame.rmarker);
+	memset(rx.rxtime, 0, sizeof(rx.rxtime));
+	for(int i = 0; i < 5; i++) {
+		rx.rxtime[i]   = (uint8_t)(stamp >> (8*i));
+		rx.rxtime[9+i] = (uint8_t)(stamp >> (8*i));
+	}
+	rx.rxtime[5] = 0x00;
+	rx.rxtime[6] = 0x2F;
+	rx.rxtime[7] = (uint8_t)fpAmpl;
+	rx.rxtime[8] = (uint8_t)(fpAmpl >> 8);
+	rx.full = true;
+	stats[SIM_STAT_RX_GOOD]++;
+	if(dbl) {
+		_icBuffer ^= 1;
+		if(target == _hostBuffer) {
+			_status |= ST_RX_GOOD;
+		}
+		if(!(readReg32(R_SYS_CFG, 0) & CFG_RXAUTR)) {
+			_rxEnabled = false;
+		}
+	} else {
+		_status |= ST_RX_GOOD;
+		_rxEnabled = false;
+	}
+}
+
+bool DW1000Model::advance(sim_time_t now) {
+	for(;;) {
+		sim_time_t next = -1;
+		bool tx = false;
+		if(_txActive) {
+			next = _txEnd;
+			tx = true;
+		}
+		Arrival* arrival = 0;
+		for(size_t i = 0; i < _arrivals.size(); i++) {
+			if(!_arrivals[i].processed) {
+				arrival = &_arrivals[i];
+				break;
+			}
+		}
+		if(arrival && (next < 0 || arrival->frame.end < next)) {
+			next = arrival->frame.end;
+			tx = false;
+		}
+		if(next < 0 || next > now) {
+			break;
+		}
+		if(tx) {
+			_txActive = false;
+			_status |= ST_TX_DONE;
+			std::vector<uint8_t>& txtime = reg(R_TX_TIME, 10);
+			for(int i = 0; i < 5; i++) {
+				txtime[i]   = (uint8_t)(_txStamp >> (8*i));
+				txtime[5+i] = (uint8_t)(_txStamp >> (8*i));
+			}
+			if(_rxPendingAfterTx) {
+				_rxPendingAfterTx = false;
+				_rxEnabled = true;
+				_rxEnabledSince = _txEnd;
+			}
+		} else {
+			deliver(*arrival);
+			// kept for a while for collision checks
+			arrival->processed = true;
+			_lastEnd = arrival->frame.end;
+		}
+		updateIrq();
+	}
+	while(!_arrivals.empty() && _arrivals.front().processed && _arrivals.front().frame.end+ARRIVAL_HISTORY < now) {
+		_arrivals.pop_front();
+	}
+	return _irqEdge;
+}
+
+void DW1000Model::updateIrq() {
+	uint32_t mask = readReg32(R_SYS_MASK, 0);
+	bool level = ((uint32_t)_status & mask) != 0;
+	if(level && !_irqLevel) {
+		_irqEdge = true;
+	}
+	_irqLevel = level;
+}
+
+bool DW1000Model::takeIrqEdge() {
+	bool edge = _irqEdge;
+	_irqEdge = false;
+	return edge;
+}
@@ -0,0 +1,118 @@
+/*
+ * Decawave DW1000 library for arduino - host simulator.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @file DW1000Model.h
+ * Register level model of one DW1000 as seen over SPI. Covers what the
+ * library touches: SYS_STATUS/SYS_MASK with the IRQ line, SYS_CTRL commands,
+ * immediate and delayed (DX_TIME) transmission, the RX/TX buffers, RX frame
+ * info/quality registers, single and double buffered reception, frame
+ * filtering and a drifting 40 bit system clock. Everything else is plain
+ * memory.
+ */
+
+#ifndef DW1000_MODEL_H
+#define DW1000_MODEL_H
+
+#include <stdint.h>
+#include <vector>
+#include <deque>
+#include "../SimApi.h"
+
+class DW1000Model {
+public:
+	DW1000Model();
+
+	void configure(int node, double clockDriftPpm, uint64_t clockOffset, const SimHostApi* api);
+
+	/* SPI side, one transaction between select() and deselect(). */
+	void    select(sim_time_t now);
+	uint8_t transfer(uint8_t mosi, sim_time_t now);
+	void    deselect(sim_time_t now);
+
+	/* radio side. */
+	void receive(const SimFrame& frame, sim_time_t arrival, float rxPowerDbm);
+	// processes all radio events up to now, returns true on a rising IRQ edge
+	bool advance(sim_time_t now);
+	bool takeIrqEdge();
+
+	uint64_t localTicks(sim_time_t t) const;
+	uint32_t stats[8];
+
+private:
+	struct RxBuffer {
+		std::vector<uint8_t> frame;
+		uint8_t finfo[4];
+		uint8_t fqual[8];
+		uint8_t rxtime[14];
+		bool    full;
+	};
+
+	struct Arrival {
+		std::vector<uint8_t> data;
+		SimFrame   frame;      // times already shifted to this receiver
+		float      rxPower;
+		bool       collided;
+		bool       processed;
+	};
+
+	std::vector<uint8_t>& reg(uint8_t id, uint32_t minLength);
+	uint32_t readReg32(uint8_t id, uint16_t offset);
+	uint64_t readReg40(uint8_t id, uint16_t offset);
+	void     updateIrq();
+	void     command(uint32_t sysctrl, sim_time_t now);
+	void     startTransmit(bool delayed, sim_time_t now);
+	void     deliver(Arrival& arrival);
+	bool     accept(const std::vector<uint8_t>& frame);
+	bool     doubleBuffered();
+	uint8_t  readByte(uint8_t id, uint32_t offset);
+	sim_time_t trueTimeOf(uint64_t ticks, sim_time_t now) const;
+
+	int                  _node;
+	double               _ticksPerPs;
+	uint64_t             _clockOffset;
+	const SimHostApi*    _api;
+	std::vector<uint8_t> _regs[64];
+
+	/* SPI transaction state. */
+	bool     _selected;
+	uint8_t  _header[3];
+	uint8_t  _headerLen;
+	uint8_t  _headerNeeded;
+	bool     _write;
+	uint8_t  _regId;
+	uint32_t _offset;
+	std::vector<uint8_t> _written;
+	uint32_t _writeStart;
+
+	/* chip state. */
+	uint64_t   _status;
+	bool       _irqLevel;
+	bool       _irqEdge;
+	bool       _rxEnabled;
+	sim_time_t _rxEnabledSince;
+	bool       _rxPendingAfterTx;
+	bool       _txActive;
+	sim_time_t _txStart;
+	sim_time_t _txEnd;
+	uint64_t   _txStamp;
+	std::vector<uint8_t> _txData;
+	RxBuffer   _rxBuffers[2];
+	uint8_t    _icBuffer;
+	uint8_t    _hostBuffer;
+	std::deque<Arrival> _arrivals;
+	sim_time_t _lastEnd;
+};
+
+#endif // DW1000_MODEL_H
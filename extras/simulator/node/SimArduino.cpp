@@ -0,0 +1,248 @@
+/*
+ * Decawave DW1000 library for arduino - host simulator.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @file SimArduino.cpp
+ * Arduino core and SPI implementation on top of the node runtime. The costs
+ * below are rough figures of an 8 bit AVR at 16 MHz, they only need to be in
+ * the right order of magnitude for the timing of the protocol to be sensible.
+ */
+
+#include <string>
+#include "Arduino.h"
+#include "SPI.h"
+#include "SimRuntime.h"
+
+namespace {
+	const sim_time_t US = 1000000LL;
+
+	const sim_time_t COST_PIN          = 3*US;
+	const sim_time_t COST_CLOCK        = 1*US;
+	const sim_time_t COST_ISR_ENTRY    = 3*US;
+	const sim_time_t COST_SPI_CALL     = US/2;
+	const sim_time_t COST_SPI_BURST    = US/10;
+	const sim_time_t COST_SERIAL_CHAR  = 2*US;
+	const sim_time_t DELAY_SLICE       = 10*US;
+
+	const uint8_t PIN_SS  = 10;
+	const uint8_t PIN_RST = 9;
+
+	void (*isr)(void) = 0;
+	bool interruptsEnabled = true;
+	bool inIsr = false;
+	bool csLow = false;
+	uint32_t spiClock = 4000000;
+	uint32_t randomState = 1;
+	std::string serialLine;
+
+	sim_time_t spiByteTime() {
+		return (sim_time_t)(8.0e12/(double)spiClock);
+	}
+
+	// simulated time an MCU interval takes with the crystal offset of the node
+	sim_time_t mcuInterval(sim_time_t ps) {
+		return (sim_time_t)((double)ps/(1.0+SimRuntime::config.mcuDriftPpm*1e-6));
+	}
+
+	void spendSliced(sim_time_t ps) {
+		while(ps > 0) {
+			sim_time_t slice = ps < DELAY_SLICE ? ps : DELAY_SLICE;
+			SimRuntime::spend(slice);
+			ps -= slice;
+		}
+	}
+}
+
+namespace SimRuntime {
+	sim_time_t        now = 0;
+	DW1000Model       model;
+	const SimHostApi* api = 0;
+	SimNodeConfig     config;
+
+	void spend(sim_time_t ps) {
+		now += ps;
+		if(!model.advance(now)) {
+			return;
+		}
+		if(!isr || !interruptsEnabled || inIsr || csLow) {
+			return;
+		}
+		model.takeIrqEdge();
+		model.stats[SIM_STAT_INTERRUPTS]++;
+		inIsr = true;
+		now += COST_ISR_ENTRY;
+		isr();
+		inIsr = false;
+	}
+
+	sim_time_t mcuTime() {
+		sim_time_t up = now-config.powerUp;
+		return (sim_time_t)config.mcuOffset*US+up+(sim_time_t)((double)up*config.mcuDriftPpm*1e-6);
+	}
+
+	void resetChip() {
+		uint32_t stats[8];
+		memcpy(stats, model.stats, sizeof(stats));
+		model = DW1000Model();
+		model.configure(config.node, config.clockDriftPpm, config.clockOffset+(uint64_t)(now/15650), api);
+		memcpy(model.stats, stats, sizeof(stats));
+	}
+}
+
+/* time */
+
+unsigned long millis() {
+	SimRuntime::spend(COST_CLOCK);
+	return (unsigned long)(uint32_t)(SimRuntime::mcuTime()/1000000000LL);
+}
+
+unsigned long micros() {
+	SimRuntime::spend(COST_CLOCK);
+	return (unsigned long)(uint32_t)(SimRuntime::mcuTime()/1000000LL);
+}
+
+void delay(unsigned long ms) {
+	spendSliced(mcuInterval((sim_time_t)ms*1000*US));
+}
+
+void delayMicroseconds(unsigned int us) {
+	spendSliced(mcuInterval((sim_time_t)us*US));
+}
+
+/* pins and interrupts */
+
+void pinMode(uint8_t pin, uint8_t mode) {
+	(void)pin;
+	(void)mode;
+	SimRuntime::spend(COST_PIN);
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+	if(pin == PIN_SS) {
+		if(val == LOW && !csLow) {
+			csLow = true;
+			SimRuntime::model.select(SimRuntime::now);
+		} else if(val != LOW && csLow) {
+			SimRuntime::model.deselect(SimRuntime::now);
+			csLow = false;
+		}
+	} else if(pin == PIN_RST && val == LOW) {
+		SimRuntime::resetChip();
+	}
+	SimRuntime::spend(COST_PIN);
+}
+
+int digitalRead(uint8_t pin) {
+	(void)pin;
+	SimRuntime::spend(COST_PIN);
+	return LOW;
+}
+
+int analogRead(uint8_t pin) {
+	(void)pin;
+	SimRuntime::spend(100*US);
+	// floating pin noise, different on every node
+	return (int)((SimRuntime::config.seed*31+SimRuntime::config.node*977) & 0x3FF);
+}
+
+void attachInterrupt(uint8_t interrupt, void (*handler)(void), int mode) {
+	(void)interrupt;
+	(void)mode;
+	isr = handler;
+}
+
+void detachInterrupt(uint8_t interrupt) {
+	(void)interrupt;
+	isr = 0;
+}
+
+void noInterrupts() {
+	interruptsEnabled = false;
+}
+
+void interrupts() {
+	interruptsEnabled = true;
+	SimRuntime::spend(0);
+}
+
+/* random */
+
+void randomSeed(unsigned long seed) {
+	if(seed != 0) {
+		randomState = (uint32_t)seed;
+	}
+}
+
+long random(long howbig) {
+	if(howbig <= 0) {
+		return 0;
+	}
+	// Park-Miller like the avr-libc one, the low bits of a power of two LCG repeat too soon
+	randomState = (uint32_t)(((uint64_t)randomState*16807UL) % 2147483647UL);
+	if(randomState == 0) {
+		randomState = 123459876UL;
+	}
+	return (long)(randomState % (uint32_t)howbig);
+}
+
+long random(long howsmall, long howbig) {
+	if(howsmall >= howbig) {
+		return howsmall;
+	}
+	return howsmall+random(howbig-howsmall);
+}
+
+/* serial */
+
+HardwareSerial Serial;
+
+size_t HardwareSerial::write(uint8_t c) {
+	SimRuntime::spend(COST_SERIAL_CHAR);
+	if(c == '\n') {
+		if(SimRuntime::api && SimRuntime::api->log && SimRuntime::config.verbose) {
+			SimRuntime::api->log(SimRuntime::api->host, SimRuntime::config.node, serialLine.c_str());
+		}
+		serialLine.clear();
+	} else if(c != '\r') {
+		serialLine += (char)c;
+	}
+	return 1;
+}
+
+/* SPI */
+
+SPIClass SPI;
+
+void SPIClass::beginTransaction(SPISettings settings) {
+	spiClock = settings._clock;
+	SimRuntime::spend(COST_SPI_CALL);
+}
+
+void SPIClass::endTransaction() {
+	SimRuntime::spend(COST_SPI_CALL);
+}
+
+uint8_t SPIClass::transfer(uint8_t data) {
+	uint8_t in = SimRuntime::model.transfer(data, SimRuntime::now);
+	SimRuntime::spend(spiByteTime()+COST_SPI_CALL);
+	return in;
+}
+
+void SPIClass::transfer(void* buf, size_t count) {
+	uint8_t* bytes = (uint8_t*)buf;
+	for(size_t i = 0; i < count; i++) {
+		bytes[i] = SimRuntime::model.transfer(bytes[i], SimRuntime::now);
+	}
+	SimRuntime::spend((spiByteTime()+COST_SPI_BURST)*(sim_time_t)count+COST_SPI_CALL);
+}
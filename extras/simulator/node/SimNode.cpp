@@ -0,0 +1,85 @@
+/*
+ * Decawave DW1000 library for arduino - host simulator.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @file SimNode.cpp
+ * The sketch run by every simulated node (the DW1000Ranging TAG and ANCHOR
+ * examples) and the functions exported to the simulator host.
+ */
+
+#include "Arduino.h"
+#include "SPI.h"
+#include "DW1000Ranging.h"
+#include "SimRuntime.h"
+
+#define SIM_EXPORT extern "C" __attribute__((visibility("default")))
+
+namespace {
+	const uint8_t PIN_RST = 9;
+	const uint8_t PIN_IRQ = 2;
+	const uint8_t PIN_SS  = 10;
+
+	const sim_time_t COST_LOOP = 2000000LL; // 2 us around each loop()
+
+	void newRange(DW1000Device* device) {
+		if(SimRuntime::api && SimRuntime::api->newRange) {
+			SimRuntime::api->newRange(SimRuntime::api->host, SimRuntime::config.node,
+			                          device->getShortAddress(), device->getRange(), device->getRXPower());
+		}
+	}
+}
+
+SIM_EXPORT int sim_node_create(const SimNodeConfig* config, const SimHostApi* api) {
+	SimRuntime::config = *config;
+	SimRuntime::api    = api;
+	SimRuntime::now    = config->powerUp;
+	SimRuntime::model.configure(config->node, config->clockDriftPpm, config->clockOffset, api);
+	return 0;
+}
+
+SIM_EXPORT void sim_node_setup(void) {
+	Serial.begin(115200);
+	randomSeed(SimRuntime::config.seed*7919+SimRuntime::config.node);
+	DW1000Ranging.initCommunication(PIN_RST, PIN_SS, PIN_IRQ);
+	DW1000Ranging.attachNewRange(newRange);
+	DW1000Ranging.useFrameFilter(SimRuntime::config.filter);
+	DW1000Ranging.useBroadcastRanging(SimRuntime::config.broadcast);
+	DW1000Ranging.usePackedTimestamps(SimRuntime::config.packed);
+	if(SimRuntime::config.rate > 0) {
+		DW1000Ranging.setTargetRate(SimRuntime::config.rate);
+	}
+	if(SimRuntime::config.role == SIM_ROLE_ANCHOR) {
+		DW1000Ranging.startAsAnchor(SimRuntime::config.eui, SimRuntime::config.mode, false);
+	} else {
+		DW1000Ranging.startAsTag(SimRuntime::config.eui, SimRuntime::config.mode, false);
+	}
+}
+
+SIM_EXPORT sim_time_t sim_node_step(void) {
+	DW1000Ranging.loop();
+	SimRuntime::spend(COST_LOOP);
+	return SimRuntime::now;
+}
+
+SIM_EXPORT sim_time_t sim_node_now(void) {
+	return SimRuntime::now;
+}
+
+SIM_EXPORT void sim_node_receive(const SimFrame* frame, sim_time_t arrival, float rxPowerDbm) {
+	SimRuntime::model.receive(*frame, arrival, rxPowerDbm);
+}
+
+SIM_EXPORT void sim_node_stats(uint32_t stats[8]) {
+	memcpy(stats, SimRuntime::model.stats, sizeof(SimRuntime::model.stats));
+}
@@ -0,0 +1,42 @@
+/*
+ * Decawave DW1000 library for arduino - host simulator.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @file SimRuntime.h
+ * Virtual time and interrupt delivery of one simulated node. The sketch
+ * only spends time inside the Arduino calls; every such call is a point
+ * where a pending DW1000 interrupt may run.
+ */
+
+#ifndef SIM_RUNTIME_H
+#define SIM_RUNTIME_H
+
+#include "../SimApi.h"
+#include "DW1000Model.h"
+
+namespace SimRuntime {
+	extern sim_time_t        now;
+	extern DW1000Model       model;
+	extern const SimHostApi* api;
+	extern SimNodeConfig     config;
+
+	// advances the virtual time of this node and runs a pending interrupt
+	void spend(sim_time_t ps);
+	// the clock of the MCU behind millis() and micros(), in ps
+	sim_time_t mcuTime();
+	// resets the register model (RSTn pulled low)
+	void resetChip();
+}
+
+#endif // SIM_RUNTIME_H
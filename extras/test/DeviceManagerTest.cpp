@@ -0,0 +1,239 @@
+/*
+ * Decawave DW1000 library for arduino - host tests.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @file DeviceManagerTest.cpp
+ * The DeviceManager against a reference map: random admissions, removals by
+ * index and by handle and lookups, with stale handles kept around. A full
+ * manager refuses new devices and leaves the others alone. The timer wheel
+ * against a scan over all devices: every check has to mark inactive and reset
+ * exactly the devices that are due, before and across the wrap of millis().
+ */
+
+#include <algorithm>
+#include <map>
+#include <new>
+#include <vector>
+#include "DeviceManager.h"
+#include "HostTest.h"
+
+namespace {
+	const uint16_t DEVICES = 64;
+	const long OPERATIONS = 200000;
+	const long TIMER_OPERATIONS = 2000000;
+
+	void shortAddressOf(uint16_t address, byte shortAddress[]) {
+		shortAddress[0] = (byte)address;
+		shortAddress[1] = (byte)(address >> 8);
+	}
+
+	// in memory that is not zero, as a manager that is not static would be
+	DeviceManager<DEVICES>* createDirty() {
+		static byte memory[sizeof(DeviceManager<DEVICES>)];
+		memset(memory, 0xA5, sizeof(memory));
+		return new(memory) DeviceManager<DEVICES>();
+	}
+
+	void testReferenceMap() {
+		DeviceManager<DEVICES>& manager = *createDirty();
+		std::map<uint16_t, DeviceHandle> reference;
+		std::vector<DeviceHandle> stale;
+		srand(1);
+		// unknown handles of a new manager
+		for(uint16_t slot = 0; slot < DEVICES; slot++) {
+			DeviceHandle handle;
+			handle.slot = slot;
+			handle.generation = 1;
+			CHECK(manager.getDevice(handle) == nullptr);
+		}
+		for(long operation = 0; operation < OPERATIONS && testFailures == 0; operation++) {
+			// few addresses, so the index has long probe chains
+			uint16_t address = rand()%200;
+			byte shortAddress[2];
+			shortAddressOf(address, shortAddress);
+			int kind = rand()%3;
+			if(kind == 0) {
+				DW1000Device* device = manager.emplace(shortAddress);
+				if(reference.count(address) || reference.size() == DEVICES) {
+					CHECK(device == nullptr);
+				} else {
+					CHECK(device != nullptr);
+					if(device) {
+						CHECK_EQUAL(address, device->getShortAddress());
+						reference[address] = manager.getHandle(device);
+					}
+				}
+			} else if(kind == 1 && !reference.empty()) {
+				std::map<uint16_t, DeviceHandle>::iterator it = reference.begin();
+				std::advance(it, rand()%reference.size());
+				if(rand()%2) {
+					manager.removeDevice(it->second);
+				} else {
+					int16_t index = -1;
+					for(uint16_t i = 0; i < manager.getDeviceCount(); i++) {
+						if(manager.getDevice(i) == manager.getDevice(it->second)) {
+							index = i;
+						}
+					}
+					CHECK(index >= 0);
+					manager.removeDevice(index);
+				}
+				stale.push_back(it->second);
+				reference.erase(it);
+				if(stale.size() > 100) {
+					stale.erase(stale.begin());
+				}
+			}
+			CHECK_EQUAL(reference.size(), manager.getDeviceCount());
+			for(std::map<uint16_t, DeviceHandle>::iterator it = reference.begin(); it != reference.end(); ++it) {
+				DW1000Device* device = manager.getDeviceByShortAddress(it->first);
+				CHECK(device != nullptr);
+				CHECK(device == manager.getDevice(it->second));
+				CHECK(manager.getHandle(device) == it->second);
+			}
+			for(size_t i = 0; i < stale.size(); i++) {
+				CHECK(manager.getDevice(stale[i]) == nullptr);
+			}
+			for(uint16_t i = 0; i < manager.getDeviceCount(); i++) {
+				CHECK(reference.count(manager.getDevice(i)->getShortAddress()) == 1);
+			}
+		}
+	}
+
+	std::vector<DW1000Device*> handled;
+
+	void onInactive(DW1000Device* device) {
+		handled.push_back(device);
+	}
+
+	bool isDue(DW1000Device* device) {
+		return device->isActive() && device->isInactive();
+	}
+
+	bool isStuck(DW1000Device* device) {
+		uint32_t since = device->getLastActivity();
+		if((int32_t)(device->getLastStateChange()-since) > 0) {
+			since = device->getLastStateChange();
+		}
+		return device->getTagState() == TAG_STATE_RANGING && (uint32_t)(millis()-since) > RANGING_TIMEOUT;
+	}
+
+	void testTimerWheel(uint32_t start) {
+		DeviceManager<DEVICES>& manager = *createDirty();
+		srand(7);
+		testMillis = start;
+		for(long operation = 0; operation < TIMER_OPERATIONS && testFailures == 0; operation++) {
+			int kind = rand()%100;
+			uint16_t count = manager.getDeviceCount();
+			DW1000Device* device = count > 0 ? manager.getDevice(rand()%count) : nullptr;
+			if(kind < 5) {
+				byte shortAddress[2];
+				shortAddressOf(rand()%1024, shortAddress);
+				manager.emplace(shortAddress);
+			} else if(kind < 7 && device) {
+				manager.removeDevice(manager.getHandle(device));
+			} else if(kind < 30 && device) {
+				device->noteActivity();
+				manager.updateDeadline(device);
+			} else if(kind < 40 && device) {
+				device->setTagState(TAG_STATE_RANGING);
+				manager.updateDeadline(device);
+			} else if(kind < 45 && device) {
+				device->setTagState(TAG_STATE_IDLE);
+			} else if(kind < 50 && device) {
+				// long silent devices come back with a deadline that is due already
+				manager.reactivateDevice(device->getByteShortAddress());
+			} else if(kind < 90) {
+				// mostly short steps, now and then a gap of more than a turn of the wheel
+				testMillis += rand()%50 == 0 ? rand()%20000 : rand()%100;
+			} else {
+				// what a scan over all devices finds due, against what the wheel finds
+				std::vector<DW1000Device*> due;
+				std::vector<DW1000Device*> ranging;
+				for(uint16_t i = 0; i < count; i++) {
+					DW1000Device* d = manager.getDevice(i);
+					if(isDue(d)) {
+						due.push_back(d);
+					}
+					if(d->getTagState() == TAG_STATE_RANGING && !isStuck(d)) {
+						ranging.push_back(d);
+					}
+				}
+				handled.clear();
+				manager.checkForInactiveDevices(onInactive);
+				CHECK_EQUAL(due.size(), handled.size());
+				for(size_t i = 0; i < due.size(); i++) {
+					CHECK(std::find(handled.begin(), handled.end(), due[i]) != handled.end());
+				}
+				for(uint16_t i = 0; i < manager.getDeviceCount(); i++) {
+					CHECK(!isDue(manager.getDevice(i)));
+					CHECK(!isStuck(manager.getDevice(i)));
+				}
+				// and nothing before it is due
+				for(size_t i = 0; i < ranging.size(); i++) {
+					CHECK(ranging[i]->getTagState() == TAG_STATE_RANGING);
+				}
+				if(testFailures > 0) {
+					fprintf(stderr, "timer wheel from %u: at operation %ld, %u ms\n", start, operation, testMillis);
+				}
+			}
+		}
+	}
+
+	// updated only after it was due and the wheel moved on, a deadline fires at the next check
+	// and not a turn of the wheel later
+	void testLateDeadline() {
+		DeviceManager<4> manager;
+		byte shortAddress[2] = {0x01, 0x98};
+		testMillis = 0;
+		DW1000Device* device = manager.emplace(shortAddress);
+		device->setTagState(TAG_STATE_RANGING);
+		testMillis = 700;
+		manager.checkForInactiveDevices(onInactive);
+		testMillis = 710;
+		manager.updateDeadline(device);
+		testMillis = 720;
+		manager.checkForInactiveDevices(onInactive);
+		CHECK(device->getTagState() == TAG_STATE_IDLE);
+	}
+
+	void testFull() {
+		DeviceManager<4> manager;
+		DW1000Device* devices[4];
+		byte shortAddress[2];
+		for(uint16_t i = 0; i < 4; i++) {
+			shortAddressOf(0x9801+i, shortAddress);
+			devices[i] = manager.emplace(shortAddress);
+			CHECK(devices[i] != nullptr);
+		}
+		// inactive devices are not made room for either
+		devices[2]->setInactive();
+		shortAddressOf(0x1201, shortAddress);
+		CHECK(manager.emplace(shortAddress) == nullptr);
+		CHECK_EQUAL(4, manager.getDeviceCount());
+		for(uint16_t i = 0; i < 4; i++) {
+			CHECK_EQUAL(0x9801+i, devices[i]->getShortAddress());
+			CHECK(manager.getDeviceByShortAddress(0x9801+i) == devices[i]);
+		}
+	}
+}
+
+int main() {
+	testReferenceMap();
+	testFull();
+	testLateDeadline();
+	testTimerWheel(1000);
+	testTimerWheel(0xFFFF0000UL);
+	return testResult("DeviceManagerTest");
+}
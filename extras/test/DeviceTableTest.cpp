@@ -0,0 +1,179 @@
+/*
+ * Decawave DW1000 library for arduino - host tests.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @file DeviceTableTest.cpp
+ * The DeviceTable against a reference map: random additions, removals and
+ * updates, with every field and the 40 bit timestamps compared after each
+ * step. The exchange timestamps of the devices of a DeviceManager, kept in
+ * the devices or with DEVICE_TABLE in the table of the manager, stay apart
+ * and survive the removal of other devices. Prints the RAM both take for 16,
+ * 64 and 256 devices.
+ */
+
+#include <map>
+#include "DeviceTable.h"
+#include "HostTest.h"
+
+namespace {
+	const uint16_t DEVICES = 64;
+	const long OPERATIONS = 200000;
+	const int64_t TIMESTAMP_MASK = 0xFFFFFFFFFFLL;
+
+	struct Row {
+		byte address[8];
+		TagState state;
+		uint8_t expectedMsgId;
+		uint32_t deadline;
+		int64_t timestamps[TIMESTAMP_COUNT];
+		float range;
+	};
+
+	void shortAddressOf(uint16_t address, byte shortAddress[]) {
+		shortAddress[0] = (byte)address;
+		shortAddress[1] = (byte)(address >> 8);
+	}
+
+	// over all 40 bits, the wrap included
+	int64_t randomTimestamp() {
+		return (((int64_t)rand() << 32) ^ ((int64_t)rand() << 8) ^ rand()) & TIMESTAMP_MASK;
+	}
+
+	bool equalsRow(DeviceTable<DEVICES>& table, uint16_t row, uint16_t address, const Row& expected) {
+		bool equal = table.getShortAddress(row) == address
+			&& memcmp(table.getAddress(row), expected.address, 8) == 0
+			&& table.getTagState(row) == expected.state
+			&& table.getExpectedMsgId(row) == expected.expectedMsgId
+			&& table.getDeadline(row) == expected.deadline
+			&& fabs(table.getRange(row) - expected.range) < 0.006f;
+		for(uint8_t i = 0; i < TIMESTAMP_COUNT; i++) {
+			equal = equal && table.getTimestamp(row, (DeviceTimestamp)i).getTimestamp() == expected.timestamps[i];
+		}
+		return equal;
+	}
+
+	void testReferenceMap() {
+		static DeviceTable<DEVICES> table;
+		std::map<uint16_t, Row> reference;
+		srand(1);
+		for(long operation = 0; operation < OPERATIONS && testFailures == 0; operation++) {
+			uint16_t address = rand()%200;
+			byte shortAddress[2];
+			shortAddressOf(address, shortAddress);
+			int16_t row = table.find(shortAddress);
+			CHECK_EQUAL(reference.count(address) ? 1 : 0, row >= 0 ? 1 : 0);
+			int kind = rand()%3;
+			if(kind == 0) {
+				Row added;
+				for(uint8_t i = 0; i < 8; i++) {
+					added.address[i] = (byte)rand();
+				}
+				int16_t newRow = table.add(shortAddress, added.address);
+				if(row >= 0 || reference.size() == DEVICES) {
+					CHECK_EQUAL(-1, newRow);
+				} else {
+					CHECK(newRow >= 0);
+					added.state = TAG_STATE_IDLE;
+					added.expectedMsgId = 0;
+					added.deadline = 0;
+					memset(added.timestamps, 0, sizeof(added.timestamps));
+					added.range = 0;
+					reference[address] = added;
+				}
+			} else if(kind == 1 && row >= 0) {
+				table.remove(row);
+				reference.erase(address);
+			} else if(row >= 0) {
+				Row& changed = reference[address];
+				changed.state = rand()%2 ? TAG_STATE_RANGING : TAG_STATE_IDLE;
+				changed.expectedMsgId = rand()%8;
+				changed.deadline = ((uint32_t)rand() << 16) ^ rand();
+				changed.range = (rand()%10000) / 100.0f;
+				DeviceTimestamp which = (DeviceTimestamp)(rand()%TIMESTAMP_COUNT);
+				changed.timestamps[which] = randomTimestamp();
+				table.setTagState(row, changed.state);
+				table.setExpectedMsgId(row, changed.expectedMsgId);
+				table.setDeadline(row, changed.deadline);
+				table.setRange(row, changed.range);
+				table.setTimestamp(row, which, DW1000Time(changed.timestamps[which]));
+			}
+			CHECK_EQUAL(reference.size(), table.getCount());
+			// every device in its row, whatever rows the removals moved
+			for(std::map<uint16_t, Row>::iterator it = reference.begin(); it != reference.end(); ++it) {
+				int16_t found = table.find(it->first);
+				CHECK(found >= 0 && equalsRow(table, found, it->first, it->second));
+			}
+		}
+	}
+
+	void testManagerTimestamps() {
+		static DeviceManager<DEVICES> manager;
+		static int64_t expected[DEVICES][TIMESTAMP_COUNT];
+		srand(2);
+		for(uint16_t i = 0; i < DEVICES; i++) {
+			byte shortAddress[2];
+			shortAddressOf(0x1000 + i, shortAddress);
+			DW1000Device* device = manager.emplace(shortAddress);
+			CHECK(device != nullptr);
+			for(uint8_t which = 0; which < TIMESTAMP_COUNT; which++) {
+				expected[i][which] = randomTimestamp();
+				if(which%2) {
+					device->setTimestamp((DeviceTimestamp)which, DW1000Time(expected[i][which]));
+				} else {
+					byte data[DW1000Time::LENGTH_TIMESTAMP];
+					DW1000Time(expected[i][which]).getTimestamp(data);
+					device->setTimestamp((DeviceTimestamp)which, data);
+				}
+			}
+		}
+		// every other device goes, the others keep their timestamps
+		for(uint16_t i = 0; i < DEVICES; i += 2) {
+			manager.removeDevice(manager.getHandle(manager.getDeviceByShortAddress(0x1000 + i)));
+		}
+		CHECK_EQUAL(DEVICES/2, manager.getDeviceCount());
+		for(uint16_t i = 1; i < DEVICES; i += 2) {
+			DW1000Device* device = manager.getDeviceByShortAddress(0x1000 + i);
+			CHECK(device != nullptr);
+			for(uint8_t which = 0; which < TIMESTAMP_COUNT; which++) {
+				CHECK_EQUAL(expected[i][which], device->getTimestamp((DeviceTimestamp)which).getTimestamp());
+				byte data[DW1000Time::LENGTH_TIMESTAMP];
+				device->getTimestamp((DeviceTimestamp)which, data);
+				CHECK_EQUAL(expected[i][which], DW1000Time(data).getTimestamp());
+			}
+		}
+		// a new device in a used slot starts from the timestamps it is given
+		byte shortAddress[2];
+		shortAddressOf(0x2000, shortAddress);
+		DW1000Device* added = manager.emplace(shortAddress);
+		CHECK(added != nullptr);
+		added->setTimestamp(TIMESTAMP_RANGE_RECEIVED, DW1000Time(TIMESTAMP_MASK));
+		CHECK_EQUAL(TIMESTAMP_MASK, added->getTimestamp(TIMESTAMP_RANGE_RECEIVED).getTimestamp());
+		CHECK_EQUAL(expected[1][TIMESTAMP_RANGE_RECEIVED],
+			manager.getDeviceByShortAddress(0x1001)->getTimestamp(TIMESTAMP_RANGE_RECEIVED).getTimestamp());
+	}
+
+	void printMemory(uint16_t devices, size_t managerSize, size_t tableSize) {
+		printf("%3u devices: DeviceManager %6zu bytes, %3zu per device, DeviceTable %6zu bytes, %3zu per device\n",
+			devices, managerSize, managerSize / devices, tableSize, tableSize / devices);
+	}
+}
+
+int main() {
+	testReferenceMap();
+	testManagerTimestamps();
+	printMemory(16, sizeof(DeviceManager<16>), sizeof(DeviceTable<16>));
+	printMemory(64, sizeof(DeviceManager<64>), sizeof(DeviceTable<64>));
+	printMemory(256, sizeof(DeviceManager<256>), sizeof(DeviceTable<256>));
+	return testResult("DeviceTableTest");
+}
@@ -0,0 +1,67 @@
+/*
+ * Decawave DW1000 library for arduino - host tests.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @file HostTest.h
+ * Checks of the host tests, and the clock, interrupt and registers of
+ * TestArduino.cpp. A failed check prints where it is and the test goes on,
+ * main() returns testResult().
+ */
+
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <stdio.h>
+#include "Arduino.h"
+
+// millis() and micros(), they only move when a test sets them
+extern uint32_t testMillis;
+extern uint32_t testMicros;
+
+// the handler given to attachInterrupt(), 0 if none
+extern void (*testInterrupt)(void);
+
+// the registers behind SPI, by register and sub address, as far as they fit.
+// Writes to SYS_STATUS clear the bits written as 1, as on the chip.
+#define TEST_REGISTERS     0x40
+#define TEST_REGISTER_SIZE 64
+extern byte testRegisters[TEST_REGISTERS][TEST_REGISTER_SIZE];
+// SPI transactions that read and that wrote each register
+extern uint32_t testRegisterReads[TEST_REGISTERS];
+extern uint32_t testRegisterWrites[TEST_REGISTERS];
+void resetTestRegisterCounts();
+
+extern int testFailures;
+
+#define CHECK(condition) \
+	do { \
+		if(!(condition)) { \
+			fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+			testFailures++; \
+		} \
+	} while(0)
+
+#define CHECK_EQUAL(expected, actual) \
+	do { \
+		long long e_ = (long long)(expected), a_ = (long long)(actual); \
+		if(e_ != a_) { \
+			fprintf(stderr, "%s:%d: CHECK_EQUAL(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, #expected, #actual, e_, a_); \
+			testFailures++; \
+		} \
+	} while(0)
+
+// prints the outcome, the exit code of the test
+int testResult(const char* name);
+
+#endif // HOST_TEST_H
@@ -0,0 +1,186 @@
+/*
+ * Decawave DW1000 library for arduino - host tests.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @file InterruptTest.cpp
+ * The interrupt handler of DW1000 with callbacks, without the event queue:
+ * it reads and clears the event status, calls the handlers of what was set,
+ * reads it again and handles events of the mask that came meanwhile, as the
+ * edge triggered interrupt does not come again for them, and restarts a
+ * permanent receive only when the receiver stopped.
+ */
+
+#include "DW1000.h"
+#include "HostTest.h"
+
+namespace {
+	const uint8_t PIN_IRQ = 2;
+	const uint8_t PIN_RST = 9;
+	const uint8_t PIN_SS  = 10;
+
+	int sent, received, receiveFailed, receiveTimeout, timestampAvailable;
+
+	void onSent() {
+		sent++;
+	}
+
+	void onReceived() {
+		received++;
+	}
+
+	void onReceiveFailed() {
+		receiveFailed++;
+	}
+
+	void onReceiveTimeout() {
+		receiveTimeout++;
+	}
+
+	void onReceiveTimestampAvailable() {
+		timestampAvailable++;
+	}
+
+	uint32_t status() {
+		byte* bytes = testRegisters[SYS_STATUS];
+		return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+	}
+
+	void setStatus(uint32_t bits) {
+		for(uint8_t i = 0; i < 4; i++) {
+			testRegisters[SYS_STATUS][i] |= (byte)(bits >> (8*i));
+		}
+	}
+
+	// an event the receive handler finds, as if it came in while the handler ran
+	void onReceivedWhileTransmitDone() {
+		received++;
+		setStatus(1UL << TXFRS_BIT);
+	}
+
+	// the same with an event not in the interrupt mask
+	void onReceivedWhilePreambleSent() {
+		received++;
+		setStatus(1UL << TXPRS_BIT);
+	}
+
+	void setUp() {
+		DW1000.begin(PIN_IRQ, PIN_RST);
+		DW1000.select(PIN_SS);
+		DW1000.newConfiguration();
+		DW1000.setDefaults();
+		DW1000.commitConfiguration();
+		DW1000.attachSentHandler(onSent);
+		DW1000.attachReceivedHandler(onReceived);
+		DW1000.attachReceiveFailedHandler(onReceiveFailed);
+		DW1000.attachReceiveTimeoutHandler(onReceiveTimeout);
+		DW1000.attachReceiveTimestampAvailableHandler(onReceiveTimestampAvailable);
+		DW1000.newReceive();
+		DW1000.setDefaults();
+		DW1000.receivePermanently(true);
+		DW1000.startReceive();
+	}
+
+	// raises the interrupt with the given events, counting from zero
+	void interrupt(uint32_t bits) {
+		sent = received = receiveFailed = receiveTimeout = timestampAvailable = 0;
+		memset(testRegisters[SYS_STATUS], 0, LEN_SYS_STATUS);
+		memset(testRegisters[SYS_CTRL], 0, LEN_SYS_CTRL);
+		setStatus(bits);
+		resetTestRegisterCounts();
+		DW1000.resetSPIStatistics();
+		testInterrupt();
+	}
+
+	bool receiverEnabled() {
+		return (testRegisters[SYS_CTRL][RXENAB_BIT/8] & (1 << (RXENAB_BIT%8))) != 0;
+	}
+
+	void testReceived() {
+		interrupt((1UL << RXDFR_BIT) | (1UL << RXFCG_BIT) | (1UL << LDEDONE_BIT));
+		CHECK_EQUAL(1, received);
+		CHECK_EQUAL(1, timestampAvailable);
+		CHECK_EQUAL(0, sent + receiveFailed + receiveTimeout);
+		CHECK_EQUAL(0, status());
+		// status read, status cleared, receiver enabled, status read again
+		CHECK_EQUAL(2, testRegisterReads[SYS_STATUS]);
+		CHECK_EQUAL(1, testRegisterWrites[SYS_STATUS]);
+		CHECK_EQUAL(1, testRegisterWrites[SYS_CTRL]);
+		CHECK(receiverEnabled());
+		CHECK_EQUAL(4, DW1000.getSPITransactionCount());
+	}
+
+	void testSent() {
+		interrupt(1UL << TXFRS_BIT);
+		CHECK_EQUAL(1, sent);
+		CHECK_EQUAL(0, received + receiveFailed + receiveTimeout + timestampAvailable);
+		CHECK_EQUAL(0, status());
+		// the receiver goes on as it was
+		CHECK_EQUAL(0, testRegisterWrites[SYS_CTRL]);
+		CHECK_EQUAL(3, DW1000.getSPITransactionCount());
+	}
+
+	void testReceiveFailed() {
+		// the receiver re-enables itself (setDefaults())
+		interrupt(1UL << RXPHE_BIT);
+		CHECK_EQUAL(1, receiveFailed);
+		CHECK_EQUAL(0, sent + received + receiveTimeout);
+		CHECK_EQUAL(0, testRegisterWrites[SYS_CTRL]);
+		CHECK_EQUAL(3, DW1000.getSPITransactionCount());
+	}
+
+	void testReceiveTimeout() {
+		interrupt(1UL << RXRFTO_BIT);
+		CHECK_EQUAL(1, receiveTimeout);
+		CHECK_EQUAL(0, sent + received + receiveFailed);
+		CHECK_EQUAL(1, testRegisterWrites[SYS_CTRL]);
+		CHECK(receiverEnabled());
+	}
+
+	// an event of the mask set while the handler runs is handled in the same interrupt
+	void testNewerEvent() {
+		DW1000.attachReceivedHandler(onReceivedWhileTransmitDone);
+		interrupt((1UL << RXDFR_BIT) | (1UL << RXFCG_BIT));
+		DW1000.attachReceivedHandler(onReceived);
+		CHECK_EQUAL(1, received);
+		CHECK_EQUAL(1, sent);
+		CHECK_EQUAL(0, status());
+		CHECK_EQUAL(3, testRegisterReads[SYS_STATUS]);
+		CHECK_EQUAL(2, testRegisterWrites[SYS_STATUS]);
+	}
+
+	// only what was read is cleared, an event outside of the mask is left for later
+	void testNewerUnmaskedEvent() {
+		DW1000.attachReceivedHandler(onReceivedWhilePreambleSent);
+		interrupt((1UL << RXDFR_BIT) | (1UL << RXFCG_BIT));
+		DW1000.attachReceivedHandler(onReceived);
+		CHECK_EQUAL(1, received);
+		CHECK_EQUAL(1UL << TXPRS_BIT, status());
+		CHECK_EQUAL(2, testRegisterReads[SYS_STATUS]);
+	}
+}
+
+int main() {
+	setUp();
+	CHECK(testInterrupt != 0);
+	if(testInterrupt == 0) {
+		return testResult("InterruptTest");
+	}
+	testReceived();
+	testSent();
+	testReceiveFailed();
+	testReceiveTimeout();
+	testNewerEvent();
+	testNewerUnmaskedEvent();
+	return testResult("InterruptTest");
+}
@@ -0,0 +1,151 @@
+/*
+ * Decawave DW1000 library for arduino - host tests.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @file RangeTrackerTest.cpp
+ * Accuracy of the DW1000RangeTracker on synthetic trajectories. Ranges are
+ * taken with 10 cm noise and 5 % non line of sight outliers (0.5 to 3 m too
+ * long), at 10 and at 2 ranges per second. The rms error of the tracked range
+ * and rate has to stay within bounds, and below the one of the raw ranges and
+ * of an exponential moving average (the former filter). Outliers caught and
+ * good ranges rejected are counted apart, the latter within bounds too.
+ */
+
+#include "DW1000RangeTracker.h"
+#include "HostTest.h"
+
+namespace {
+	// length of each run in ms
+	const uint32_t DURATION = 600000;
+	// the tracks settle within this many ms, errors are taken after it
+	const uint32_t SETTLE = 2000;
+
+	// small deterministic pseudo random generator (xorshift)
+	uint32_t randomState = 2463534242UL;
+
+	uint32_t random32() {
+		randomState ^= randomState << 13;
+		randomState ^= randomState >> 17;
+		randomState ^= randomState << 5;
+		return randomState;
+	}
+
+	// about normal, mean 0, standard deviation in mm
+	int32_t noise(int32_t deviation) {
+		int32_t sum = 0;
+		for(uint8_t i = 0; i < 12; i++) {
+			sum += random32() & 0xFFFF;
+		}
+		return (int64_t)(sum-6*65536L)*deviation/65536;
+	}
+
+	// true range in mm and rate in mm/s at t ms
+	void standing(uint32_t t, int32_t& range, int32_t& rate) {
+		(void)t;
+		range = 5000;
+		rate = 0;
+	}
+
+	void walking(uint32_t t, int32_t& range, int32_t& rate) {
+		// away at 1.4 m/s for 15 s, then back
+		t %= 30000;
+		rate = t < 15000 ? 1400 : -1400;
+		range = t < 15000 ? 2000+1400L*t/1000 : 2000+1400L*(30000-t)/1000;
+	}
+
+	void swinging(uint32_t t, int32_t& range, int32_t& rate) {
+		// 3 m back and forth every 8 s
+		float phase = 2*PI*t/8000.0f;
+		range = 5000+3000*sin(phase);
+		rate = 3000*2*PI/8.0f*cos(phase);
+	}
+
+	struct Errors {
+		float raw;
+		float average;
+		float tracker;
+		float rate;
+		uint32_t outliers;
+		uint32_t rejected;      // outliers caught
+		uint32_t rejectedGood;  // good ranges taken for outliers
+	};
+
+	// rms errors in mm and mm/s
+	Errors run(void (*trajectory)(uint32_t, int32_t&, int32_t&), uint16_t interval) {
+		DW1000RangeTracker tracker;
+		Errors errors = {0, 0, 0, 0, 0, 0, 0};
+		float average = 0;
+		uint32_t count = 0;
+		uint32_t settled = 0;
+		for(uint32_t t = 0; t < DURATION; t += interval) {
+			int32_t range, rate;
+			trajectory(t, range, rate);
+			int32_t measured = range+noise(100);
+			bool outlier = random32()%100 < 5;
+			if(outlier) {
+				measured += 500+random32()%2500;
+				errors.outliers++;
+			}
+			if(!tracker.update(measured, t)) {
+				if(outlier) {
+					errors.rejected++;
+				} else {
+					errors.rejectedGood++;
+				}
+			}
+			// like the former filter with 15 values
+			average = count == 0 ? measured : average+(measured-average)*2/16;
+			count++;
+			if(t < SETTLE) {
+				continue;
+			}
+			errors.raw += sq((float)(measured-range));
+			errors.average += sq(average-range);
+			errors.tracker += sq((float)(tracker.getRange()-range));
+			errors.rate += sq((float)(tracker.getRate()-rate));
+			settled++;
+		}
+		errors.raw = sqrt(errors.raw/settled);
+		errors.average = sqrt(errors.average/settled);
+		errors.tracker = sqrt(errors.tracker/settled);
+		errors.rate = sqrt(errors.rate/settled);
+		return errors;
+	}
+
+	// bounds about 25 % above the errors of the tracker as it is
+	void check(const char* name, void (*trajectory)(uint32_t, int32_t&, int32_t&), uint16_t interval,
+	           float maxRange, float maxRate, uint32_t maxRejectedGood) {
+		Errors errors = run(trajectory, interval);
+		printf("%-8s %2u Hz: raw %4.0f mm, average %4.0f mm, tracker %4.0f mm, rate %4.0f mm/s, %u of %u outliers and %u good ranges rejected\n",
+		       name, 1000/interval, errors.raw, errors.average, errors.tracker, errors.rate, errors.rejected, errors.outliers, errors.rejectedGood);
+		CHECK(errors.tracker < maxRange);
+		CHECK(errors.rate < maxRate);
+		CHECK(errors.tracker < errors.raw);
+		CHECK(errors.tracker < errors.average);
+		// most outliers are caught, good ranges only where the device turns faster than the
+		// track follows
+		CHECK(errors.rejected > errors.outliers/2);
+		CHECK(errors.rejectedGood <= maxRejectedGood);
+	}
+}
+
+int main() {
+	check("standing", standing, 100, 60, 100, 5);
+	check("standing", standing, 500, 110, 150, 5);
+	check("walking", walking, 100, 130, 560, 90);
+	check("walking", walking, 500, 440, 960, 60);
+	check("swinging", swinging, 100, 100, 490, 30);
+	check("swinging", swinging, 500, 440, 830, 22);
+	return testResult("RangeTrackerTest");
+}
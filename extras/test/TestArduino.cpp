@@ -0,0 +1,219 @@
+/*
+ * Decawave DW1000 library for arduino - host tests.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @file TestArduino.cpp
+ * The Arduino core of the simulator shim for the host tests: the clock only
+ * moves when a test sets it, SPI reads and writes the registers of HostTest.h,
+ * which start as zeros, the interrupt handler is kept for the test, other pins
+ * do nothing and the serial output is dropped unless TEST_SERIAL is set.
+ */
+
+#include "Arduino.h"
+#include "SPI.h"
+#include "HostTest.h"
+#include "DW1000Constants.h"
+
+uint32_t testMillis = 0;
+uint32_t testMicros = 0;
+int testFailures = 0;
+void (*testInterrupt)(void) = 0;
+byte testRegisters[TEST_REGISTERS][TEST_REGISTER_SIZE];
+uint32_t testRegisterReads[TEST_REGISTERS];
+uint32_t testRegisterWrites[TEST_REGISTERS];
+
+namespace {
+	uint32_t randomState = 1;
+
+	// the SPI transaction going on, header bytes first
+	uint8_t spiHeader[3];
+	uint8_t spiHeaderLen;
+	uint16_t spiPosition;
+
+	uint8_t spiHeaderSize() {
+		if(spiHeaderLen == 0 || !(spiHeader[0] & 0x40)) {
+			return 1;
+		}
+		if(spiHeaderLen == 1 || !(spiHeader[1] & 0x80)) {
+			return 2;
+		}
+		return 3;
+	}
+
+	uint8_t spiByte(uint8_t data) {
+		if(spiHeaderLen < spiHeaderSize()) {
+			spiHeader[spiHeaderLen++] = data;
+			if(spiHeaderLen == spiHeaderSize()) {
+				uint8_t reg = spiHeader[0] & 0x3F;
+				if(spiHeader[0] & 0x80) {
+					testRegisterWrites[reg]++;
+				} else {
+					testRegisterReads[reg]++;
+				}
+			}
+			return 0;
+		}
+		uint8_t reg = spiHeader[0] & 0x3F;
+		uint16_t offset = 0;
+		if(spiHeaderLen > 1) {
+			offset = spiHeader[1] & 0x7F;
+		}
+		if(spiHeaderLen > 2) {
+			offset |= (uint16_t)spiHeader[2] << 7;
+		}
+		offset += spiPosition++;
+		if(offset >= TEST_REGISTER_SIZE) {
+			return 0;
+		}
+		if(!(spiHeader[0] & 0x80)) {
+			return testRegisters[reg][offset];
+		}
+		if(reg == SYS_STATUS) {
+			testRegisters[reg][offset] &= ~data;
+		} else {
+			testRegisters[reg][offset] = data;
+		}
+		return 0;
+	}
+}
+
+void resetTestRegisterCounts() {
+	memset(testRegisterReads, 0, sizeof(testRegisterReads));
+	memset(testRegisterWrites, 0, sizeof(testRegisterWrites));
+}
+
+int testResult(const char* name) {
+	if(testFailures > 0) {
+		printf("%s: %d checks failed\n", name, testFailures);
+		return 1;
+	}
+	printf("%s: ok\n", name);
+	return 0;
+}
+
+/* time */
+
+unsigned long micros() {
+	return testMicros;
+}
+
+unsigned long millis() {
+	return testMillis;
+}
+
+void delay(unsigned long ms) {
+	(void)ms;
+}
+
+void delayMicroseconds(unsigned int us) {
+	(void)us;
+}
+
+/* pins and interrupts */
+
+void pinMode(uint8_t pin, uint8_t mode) {
+	(void)pin;
+	(void)mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+	(void)pin;
+	(void)val;
+}
+
+int digitalRead(uint8_t pin) {
+	(void)pin;
+	return LOW;
+}
+
+int analogRead(uint8_t pin) {
+	(void)pin;
+	return 0;
+}
+
+void attachInterrupt(uint8_t interrupt, void (*handler)(void), int mode) {
+	(void)interrupt;
+	(void)mode;
+	testInterrupt = handler;
+}
+
+void detachInterrupt(uint8_t interrupt) {
+	(void)interrupt;
+	testInterrupt = 0;
+}
+
+void noInterrupts() {
+}
+
+void interrupts() {
+}
+
+/* random */
+
+void randomSeed(unsigned long seed) {
+	if(seed != 0) {
+		randomState = (uint32_t)seed;
+	}
+}
+
+long random(long howbig) {
+	if(howbig <= 0) {
+		return 0;
+	}
+	randomState = (uint32_t)(((uint64_t)randomState*16807UL) % 2147483647UL);
+	return (long)(randomState % (uint32_t)howbig);
+}
+
+long random(long howsmall, long howbig) {
+	if(howsmall >= howbig) {
+		return howsmall;
+	}
+	return howsmall+random(howbig-howsmall);
+}
+
+/* serial, to stderr if TEST_SERIAL is set, the library is chatty */
+
+HardwareSerial Serial;
+
+size_t HardwareSerial::write(uint8_t c) {
+	static bool enabled = getenv("TEST_SERIAL") != 0;
+	if(enabled) {
+		fputc(c, stderr);
+	}
+	return 1;
+}
+
+/* SPI */
+
+SPIClass SPI;
+
+void SPIClass::beginTransaction(SPISettings settings) {
+	(void)settings;
+	spiHeaderLen = 0;
+	spiPosition = 0;
+}
+
+void SPIClass::endTransaction() {
+}
+
+uint8_t SPIClass::transfer(uint8_t data) {
+	return spiByte(data);
+}
+
+void SPIClass::transfer(void* buf, size_t count) {
+	uint8_t* bytes = (uint8_t*)buf;
+	for(size_t i = 0; i < count; i++) {
+		bytes[i] = spiByte(bytes[i]);
+	}
+}
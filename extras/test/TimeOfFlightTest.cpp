@@ -0,0 +1,178 @@
+/*
+ * Decawave DW1000 library for arduino - host tests.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @file TimeOfFlightTest.cpp
+ * DW1000Time::computeTimeOfFlight() and getAsMillimeters() against __int128
+ * references: random intervals over all 40 bits, timestamps near the wrap,
+ * exchanges between unequal clocks and rounding ties, which go away from 0.
+ */
+
+#include "DW1000Time.h"
+#include "HostTest.h"
+
+namespace {
+	const long CASES = 200000;
+	const int64_t TIMESTAMP_MASK = DW1000Time::TIME_MAX;
+
+	// small deterministic pseudo random generator (xorshift)
+	uint64_t randomState = 88172645463325252ULL;
+
+	uint64_t random64() {
+		randomState ^= randomState << 13;
+		randomState ^= randomState >> 7;
+		randomState ^= randomState << 17;
+		return randomState;
+	}
+
+	// 40 bit, of any magnitude
+	uint64_t randomInterval() {
+		return (random64() & TIMESTAMP_MASK) >> (random64() % 40);
+	}
+
+	int64_t divideRounded(__int128 numerator, __int128 divisor) {
+		__int128 magnitude = numerator < 0 ? -numerator : numerator;
+		__int128 quotient  = (2*magnitude + divisor) / (2*divisor);
+		return (int64_t)(numerator < 0 ? -quotient : quotient);
+	}
+
+	int64_t referenceTimeOfFlight(uint64_t round1, uint64_t reply1, uint64_t round2, uint64_t reply2) {
+		round1 &= TIMESTAMP_MASK;
+		reply1 &= TIMESTAMP_MASK;
+		round2 &= TIMESTAMP_MASK;
+		reply2 &= TIMESTAMP_MASK;
+		__int128 divisor = (__int128)round1+round2+reply1+reply2;
+		if(divisor == 0) {
+			return 0;
+		}
+		return divideRounded((__int128)round1*round2 - (__int128)reply1*reply2, divisor);
+	}
+
+	bool checkTimeOfFlight(uint64_t round1, uint64_t reply1, uint64_t round2, uint64_t reply2) {
+		int64_t expected = referenceTimeOfFlight(round1, reply1, round2, reply2);
+		int64_t actual   = DW1000Time::computeTimeOfFlight(round1, reply1, round2, reply2);
+		if(expected != actual) {
+			fprintf(stderr, "tof(%llu, %llu, %llu, %llu) = %lld, expected %lld\n",
+			        (unsigned long long)round1, (unsigned long long)reply1, (unsigned long long)round2,
+			        (unsigned long long)reply2, (long long)actual, (long long)expected);
+			return false;
+		}
+		return true;
+	}
+
+	void testRandomIntervals() {
+		for(long i = 0; i < CASES; i++) {
+			CHECK(checkTimeOfFlight(randomInterval(), randomInterval(), randomInterval(), randomInterval()));
+		}
+		// unwrapped differences count modulo 2^40
+		for(long i = 0; i < CASES; i++) {
+			uint64_t round1 = randomInterval(), reply1 = randomInterval();
+			uint64_t round2 = randomInterval(), reply2 = randomInterval();
+			CHECK_EQUAL(DW1000Time::computeTimeOfFlight(round1, reply1, round2, reply2),
+			            DW1000Time::computeTimeOfFlight(round1 - DW1000Time::TIME_OVERFLOW, reply1 + (random64() << 40),
+			                                            round2, reply2 | ((uint64_t)-1 << 40)));
+		}
+		CHECK_EQUAL(0, DW1000Time::computeTimeOfFlight(0, 0, 0, 0));
+		CHECK(checkTimeOfFlight(TIMESTAMP_MASK, TIMESTAMP_MASK, TIMESTAMP_MASK, TIMESTAMP_MASK));
+		CHECK(checkTimeOfFlight(TIMESTAMP_MASK, 0, TIMESTAMP_MASK, 0));
+		CHECK(checkTimeOfFlight(0, TIMESTAMP_MASK, 0, TIMESTAMP_MASK));
+	}
+
+	// a whole exchange from the six timestamps, with the tag at offset and the anchor at
+	// offset+drift in its own clock, both close to the wrap
+	void testExchangeNearWrap() {
+		for(long i = 0; i < CASES; i++) {
+			int64_t tof    = random64() % 50000;
+			int64_t reply1 = 1 + random64() % 1000000000;
+			int64_t reply2 = 1 + random64() % 1000000000;
+			// the anchor clock runs up to 40 ppm off
+			long double rate = 1 + ((long double)(random64() % 80001) - 40000) * 1e-9L;
+			int64_t tagStart    = TIMESTAMP_MASK - random64() % 2000000000;
+			int64_t anchorStart = TIMESTAMP_MASK - random64() % 2000000000;
+			// in true time from the poll
+			int64_t pollAckSentTime = tof + reply1;
+			int64_t rangeSentTime   = pollAckSentTime + tof + reply2;
+			uint64_t pollSent        = tagStart;
+			uint64_t pollReceived    = anchorStart;
+			uint64_t pollAckSent     = anchorStart + (int64_t)(reply1*rate);
+			uint64_t pollAckReceived = tagStart + pollAckSentTime + tof;
+			uint64_t rangeSent       = tagStart + rangeSentTime;
+			uint64_t rangeReceived   = anchorStart + (int64_t)(rangeSentTime*rate);
+			DW1000Time timestamps[6] = {
+				DW1000Time((int64_t)(pollSent & TIMESTAMP_MASK)), DW1000Time((int64_t)(pollReceived & TIMESTAMP_MASK)),
+				DW1000Time((int64_t)(pollAckSent & TIMESTAMP_MASK)), DW1000Time((int64_t)(pollAckReceived & TIMESTAMP_MASK)),
+				DW1000Time((int64_t)(rangeSent & TIMESTAMP_MASK)), DW1000Time((int64_t)(rangeReceived & TIMESTAMP_MASK))
+			};
+			int64_t actual = DW1000Time::computeTimeOfFlight(timestamps[0], timestamps[1], timestamps[2],
+			                                                 timestamps[3], timestamps[4], timestamps[5]);
+			int64_t expected = referenceTimeOfFlight(pollAckReceived - pollSent, pollAckSent - pollReceived,
+			                                         rangeReceived - pollAckSent, rangeSent - pollAckReceived);
+			CHECK_EQUAL(expected, actual);
+			// double sided ranging leaves a few ticks of the clock offset and of the rounding
+			// of the timestamps
+			long double error = actual - tof;
+			CHECK(error < 3 + tof*40e-6L && error > -3 - tof*40e-6L);
+		}
+	}
+
+	// (round1*round2 - reply1*reply2) / sum halfway between two ticks, times an odd factor
+	// it still is
+	void testRoundingTies() {
+		long ties = 0;
+		while(ties < CASES/10) {
+			uint64_t values[4];
+			for(uint8_t i = 0; i < 4; i++) {
+				values[i] = random64() % 1000;
+			}
+			__int128 numerator = (__int128)values[0]*values[2] - (__int128)values[1]*values[3];
+			__int128 divisor   = (__int128)values[0]+values[1]+values[2]+values[3];
+			__int128 magnitude = numerator < 0 ? -numerator : numerator;
+			if(divisor == 0 || (2*magnitude) % divisor != 0 || (2*magnitude/divisor) % 2 == 0) {
+				continue;
+			}
+			uint64_t factor = 2*(random64() % 500000) + 1;
+			int64_t half = (int64_t)((2*magnitude/divisor)*factor/2);
+			int64_t expected = numerator < 0 ? -half-1 : half+1;
+			CHECK_EQUAL(expected, DW1000Time::computeTimeOfFlight(values[0]*factor, values[1]*factor,
+			                                                      values[2]*factor, values[3]*factor));
+			ties++;
+		}
+		// the smallest, 1/2 and -1/2
+		CHECK_EQUAL(1, DW1000Time::computeTimeOfFlight(1, 0, 1, 0));
+		CHECK_EQUAL(-1, DW1000Time::computeTimeOfFlight(0, 1, 0, 1));
+	}
+
+	void testMillimeters() {
+		for(long i = 0; i < CASES; i++) {
+			int64_t timestamp = (int64_t)(random64() >> (1 + random64() % 63));
+			if(random64() % 2) {
+				timestamp = -timestamp;
+			}
+			int64_t ticks = timestamp % DW1000Time::TIME_OVERFLOW;
+			int64_t expected = divideRounded((__int128)ticks*DW1000Time::DISTANCE_OF_RADIO_MM_NUM,
+			                                 DW1000Time::DISTANCE_OF_RADIO_MM_DEN);
+			CHECK_EQUAL(expected, DW1000Time(timestamp).getAsMillimeters());
+		}
+		CHECK_EQUAL(0, DW1000Time((int64_t)0).getAsMillimeters());
+		CHECK_EQUAL(5158649049264LL, DW1000Time(TIMESTAMP_MASK).getAsMillimeters());
+	}
+}
+
+int main() {
+	testRandomIntervals();
+	testExchangeNearWrap();
+	testRoundingTies();
+	testMillimeters();
+	return testResult("TimeOfFlightTest");
+}
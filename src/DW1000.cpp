@@ -68,6 +68,13 @@ boolean    DW1000Class::_frameCheck          = true;
 boolean    DW1000Class::_permanentReceive    = false;
 uint8_t    DW1000Class::_deviceMode          = IDLE_MODE; // TODO replace by enum
 
+// event queue
+boolean                DW1000Class::_useEventQueue     = false;
+DW1000Class::Event     DW1000Class::_events[DW1000_EVENT_QUEUE_SIZE];
+volatile uint8_t       DW1000Class::_eventHead         = 0;
+volatile uint8_t       DW1000Class::_eventTail         = 0;
+volatile uint16_t      DW1000Class::_eventOverflows    = 0;
+
 boolean    DW1000Class::_debounceClockEnabled = false;
 
 // modes of operation
@@ -92,6 +99,7 @@ constexpr byte DW1000Class::BIAS_500_16[];
 constexpr byte DW1000Class::BIAS_500_64[];
 constexpr byte DW1000Class::BIAS_900_16[];
 constexpr byte DW1000Class::BIAS_900_64[];
+constexpr byte DW1000Class::SHADOW_LENGTH[];
 /*
 const byte DW1000Class::BIAS_500_16[] = {198, 187, 179, 163, 143, 127, 109, 84, 59, 31, 0, 36, 65, 84, 97, 106, 110, 112};
 const byte DW1000Class::BIAS_500_64[] = {110, 105, 100, 93, 82, 69, 51, 27, 0, 21, 35, 42, 49, 62, 71, 76, 81, 86};
@@ -107,6 +115,15 @@ const byte DW1000Class::BIAS_900_64[] = {147, 133, 117, 99, 75, 50, 29, 0, 24, 4
 #endif
 const SPISettings DW1000Class::_slowSPI = SPISettings(2000000L, MSBFIRST, SPI_MODE0);
 const SPISettings* DW1000Class::_currentSPI = &_fastSPI;
+uint8_t            DW1000Class::_spiHoldTime = DW1000_SPI_HOLD_TIME_US;
+uint32_t           DW1000Class::_spiTransactions = 0;
+uint32_t           DW1000Class::_spiBytes = 0;
+
+// shadow register cache
+byte     DW1000Class::_shadow[LEN_SHADOW];
+uint32_t DW1000Class::_shadowValid   = 0;
+uint32_t DW1000Class::_spiBytesSaved = 0;
+byte     DW1000Class::_xtalTrim      = 0;
 
 /* ###########################################################################
  * #### Init and end #######################################################
@@ -154,6 +171,9 @@ void DW1000Class::select(uint8_t ss) {
 	_vmeas3v3 = buf_otp[0];
 	readBytesOTP(0x009, buf_otp); // the stored 23C reading
 	_tmeas23C = buf_otp[0];
+	// crystal trim, applied on every tune()
+	readBytesOTP(0x01E, buf_otp);
+	_xtalTrim = buf_otp[0];
 }
 
 void DW1000Class::reselect(uint8_t ss) {
@@ -293,6 +313,8 @@ void DW1000Class::spiWakeup(){
         digitalWrite(_ss, LOW);
         delay(2);
         digitalWrite(_ss, HIGH);
+        // configuration is not necessarily retained while sleeping
+        invalidateShadow();
         if (_debounceClockEnabled){
                 DW1000Class::enableDebounceClock();
         }
@@ -309,6 +331,7 @@ void DW1000Class::reset() {
 		delay(2);  // dw1000 data sheet v2.08 §5.6.1 page 20: nominal 50ns, to be safe take more time
 		pinMode(_rst, INPUT);
 		delay(10); // dwm1000 data sheet v1.2 page 5: nominal 3 ms, to be safe take more time
+		invalidateShadow();
 		// force into idle mode (although it should be already after reset)
 		idle();
 	}
@@ -325,6 +348,7 @@ void DW1000Class::softReset() {
 	pmscctrl0[0] = 0x00;
 	pmscctrl0[3] = 0xF0;
 	writeBytes(PMSC, PMSC_CTRL0_SUB, pmscctrl0, LEN_PMSC_CTRL0);
+	invalidateShadow();
 	// force into idle mode
 	idle();
 }
@@ -672,78 +696,269 @@ void DW1000Class::tune() {
 	} else {
 		// TODO proper error/warning handling
 	}
-	// Crystal calibration from OTP (if available)
-	byte buf_otp[4];
-	readBytesOTP(0x01E, buf_otp);
-	if (buf_otp[0] == 0) {
+	// Crystal calibration from OTP (if available, read on select())
+	if (_xtalTrim == 0) {
 		// No trim value available from OTP, use midrange value of 0x10
 		writeValueToBytes(fsxtalt, ((0x10 & 0x1F) | 0x60), LEN_FS_XTALT);
 	} else {
-		writeValueToBytes(fsxtalt, ((buf_otp[0] & 0x1F) | 0x60), LEN_FS_XTALT);
-	}
-	// write configuration back to chip
-	writeBytes(AGC_TUNE, AGC_TUNE1_SUB, agctune1, LEN_AGC_TUNE1);
-	writeBytes(AGC_TUNE, AGC_TUNE2_SUB, agctune2, LEN_AGC_TUNE2);
-	writeBytes(AGC_TUNE, AGC_TUNE3_SUB, agctune3, LEN_AGC_TUNE3);
-	writeBytes(DRX_TUNE, DRX_TUNE0b_SUB, drxtune0b, LEN_DRX_TUNE0b);
-	writeBytes(DRX_TUNE, DRX_TUNE1a_SUB, drxtune1a, LEN_DRX_TUNE1a);
-	writeBytes(DRX_TUNE, DRX_TUNE1b_SUB, drxtune1b, LEN_DRX_TUNE1b);
-	writeBytes(DRX_TUNE, DRX_TUNE2_SUB, drxtune2, LEN_DRX_TUNE2);
-	writeBytes(DRX_TUNE, DRX_TUNE4H_SUB, drxtune4H, LEN_DRX_TUNE4H);
-	writeBytes(LDE_IF, LDE_CFG1_SUB, ldecfg1, LEN_LDE_CFG1);
-	writeBytes(LDE_IF, LDE_CFG2_SUB, ldecfg2, LEN_LDE_CFG2);
-	writeBytes(LDE_IF, LDE_REPC_SUB, lderepc, LEN_LDE_REPC);
-	writeBytes(TX_POWER, NO_SUB, txpower, LEN_TX_POWER);
-	writeBytes(RF_CONF, RF_RXCTRLH_SUB, rfrxctrlh, LEN_RF_RXCTRLH);
-	writeBytes(RF_CONF, RF_TXCTRL_SUB, rftxctrl, LEN_RF_TXCTRL);
-	writeBytes(TX_CAL, TC_PGDELAY_SUB, tcpgdelay, LEN_TC_PGDELAY);
-	writeBytes(FS_CTRL, FS_PLLTUNE_SUB, fsplltune, LEN_FS_PLLTUNE);
-	writeBytes(FS_CTRL, FS_PLLCFG_SUB, fspllcfg, LEN_FS_PLLCFG);
-	writeBytes(FS_CTRL, FS_XTALT_SUB, fsxtalt, LEN_FS_XTALT);
+		writeValueToBytes(fsxtalt, ((_xtalTrim & 0x1F) | 0x60), LEN_FS_XTALT);
+	}
+	// write configuration back to chip (only what changed since the last tune)
+	writeShadowedBytes(SHADOW_AGC_TUNE1, AGC_TUNE, AGC_TUNE1_SUB, agctune1, LEN_AGC_TUNE1);
+	writeShadowedBytes(SHADOW_AGC_TUNE2, AGC_TUNE, AGC_TUNE2_SUB, agctune2, LEN_AGC_TUNE2);
+	writeShadowedBytes(SHADOW_AGC_TUNE3, AGC_TUNE, AGC_TUNE3_SUB, agctune3, LEN_AGC_TUNE3);
+	writeShadowedBytes(SHADOW_DRX_TUNE0b, DRX_TUNE, DRX_TUNE0b_SUB, drxtune0b, LEN_DRX_TUNE0b);
+	writeShadowedBytes(SHADOW_DRX_TUNE1a, DRX_TUNE, DRX_TUNE1a_SUB, drxtune1a, LEN_DRX_TUNE1a);
+	writeShadowedBytes(SHADOW_DRX_TUNE1b, DRX_TUNE, DRX_TUNE1b_SUB, drxtune1b, LEN_DRX_TUNE1b);
+	writeShadowedBytes(SHADOW_DRX_TUNE2, DRX_TUNE, DRX_TUNE2_SUB, drxtune2, LEN_DRX_TUNE2);
+	writeShadowedBytes(SHADOW_DRX_TUNE4H, DRX_TUNE, DRX_TUNE4H_SUB, drxtune4H, LEN_DRX_TUNE4H);
+	writeShadowedBytes(SHADOW_LDE_CFG1, LDE_IF, LDE_CFG1_SUB, ldecfg1, LEN_LDE_CFG1);
+	writeShadowedBytes(SHADOW_LDE_CFG2, LDE_IF, LDE_CFG2_SUB, ldecfg2, LEN_LDE_CFG2);
+	writeShadowedBytes(SHADOW_LDE_REPC, LDE_IF, LDE_REPC_SUB, lderepc, LEN_LDE_REPC);
+	writeShadowedBytes(SHADOW_TX_POWER, TX_POWER, NO_SUB, txpower, LEN_TX_POWER);
+	writeShadowedBytes(SHADOW_RF_RXCTRLH, RF_CONF, RF_RXCTRLH_SUB, rfrxctrlh, LEN_RF_RXCTRLH);
+	writeShadowedBytes(SHADOW_RF_TXCTRL, RF_CONF, RF_TXCTRL_SUB, rftxctrl, LEN_RF_TXCTRL);
+	writeShadowedBytes(SHADOW_TC_PGDELAY, TX_CAL, TC_PGDELAY_SUB, tcpgdelay, LEN_TC_PGDELAY);
+	writeShadowedBytes(SHADOW_FS_PLLTUNE, FS_CTRL, FS_PLLTUNE_SUB, fsplltune, LEN_FS_PLLTUNE);
+	writeShadowedBytes(SHADOW_FS_PLLCFG, FS_CTRL, FS_PLLCFG_SUB, fspllcfg, LEN_FS_PLLCFG);
+	writeShadowedBytes(SHADOW_FS_XTALT, FS_CTRL, FS_XTALT_SUB, fsxtalt, LEN_FS_XTALT);
 }
 
 /* ###########################################################################
  * #### Interrupt handling ###################################################
  * ######################################################################### */
 
+// the lower 32 bits of SYS_STATUS or SYS_MASK
+static uint32_t eventBits(const byte data[]) {
+	return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
 void DW1000Class::handleInterrupt() {
-	// read current status and handle via callbacks
+	if(_useEventQueue) {
+		queueEvents();
+		return;
+	}
+	// read current status, clear exactly that in the same go and handle it via callbacks. The
+	// interrupt is edge triggered, an event set meanwhile keeps the line high without a new edge,
+	// so go on until no event of the mask is left.
 	readSystemEventStatusRegister();
-	if(isClockProblem() /* TODO and others */ && _handleError != 0) {
+	do {
+		writeBytes(SYS_STATUS, NO_SUB, _sysstatus, LEN_SYS_STATUS);
+		handleEvents(eventBits(_sysstatus));
+		readSystemEventStatusRegister();
+	} while(eventBits(_sysstatus) & eventBits(_sysmask));
+}
+
+void DW1000Class::handleEvents(uint32_t status) {
+	Event event;
+	event.status = status;
+	if(isClockProblem(event) /* TODO and others */ && _handleError != 0) {
 		(*_handleError)();
 	}
-	if(isTransmitDone() && _handleSent != 0) {
+	if(isTransmitDone(event) && _handleSent != 0) {
 		(*_handleSent)();
-		clearTransmitStatus();
 	}
-	if(isReceiveTimestampAvailable() && _handleReceiveTimestampAvailable != 0) {
+	if(isReceiveTimestampAvailable(event) && _handleReceiveTimestampAvailable != 0) {
 		(*_handleReceiveTimestampAvailable)();
-		clearReceiveTimestampAvailableStatus();
-	}
-	if(isReceiveFailed() && _handleReceiveFailed != 0) {
-		(*_handleReceiveFailed)();
-		clearReceiveStatus();
-		if(_permanentReceive) {
-			newReceive();
-			startReceive();
+	}
+	boolean receiveEnded = true;
+	if(isReceiveFailed(event)) {
+		if(_handleReceiveFailed != 0) {
+			(*_handleReceiveFailed)();
 		}
-	} else if(isReceiveTimeout() && _handleReceiveTimeout != 0) {
-		(*_handleReceiveTimeout)();
-		clearReceiveStatus();
-		if(_permanentReceive) {
-			newReceive();
-			startReceive();
+		// unless the receiver went on by itself
+		receiveEnded = !getBit(_syscfg, LEN_SYS_CFG, RXAUTR_BIT);
+	} else if(isReceiveTimeout(event)) {
+		if(_handleReceiveTimeout != 0) {
+			(*_handleReceiveTimeout)();
 		}
-	} else if(isReceiveDone() && _handleReceived != 0) {
-		(*_handleReceived)();
-		clearReceiveStatus();
-		if(_permanentReceive) {
-			newReceive();
-			startReceive();
+	} else if(isReceiveDone(event)) {
+		if(_handleReceived != 0) {
+			(*_handleReceived)();
 		}
+	} else {
+		receiveEnded = false;
+	}
+	// after the callbacks, they read the frame
+	if(receiveEnded && _permanentReceive) {
+		restartReceive();
 	}
-	// clear all status that is left unhandled
-	clearAllStatus();
+}
+
+/* ###########################################################################
+ * #### Event queue ##########################################################
+ * ######################################################################### */
+
+static_assert(DW1000_EVENT_QUEUE_SIZE > 0 && DW1000_EVENT_QUEUE_SIZE <= 128 &&
+              (DW1000_EVENT_QUEUE_SIZE & (DW1000_EVENT_QUEUE_SIZE-1)) == 0,
+              "DW1000_EVENT_QUEUE_SIZE must be a power of two up to 128");
+
+static constexpr uint32_t TX_STATUS_BITS = (1UL << TXFRB_BIT) | (1UL << TXPRS_BIT) | (1UL << TXPHS_BIT) | (1UL << TXFRS_BIT);
+
+void DW1000Class::useEventQueue(boolean val) {
+	_useEventQueue = val;
+}
+
+/*
+ * Interrupt handler in case the event queue is used. Only latches what is
+ * gone with the next transmission or reception, everything else is left to
+ * the main loop.
+ */
+void DW1000Class::queueEvents() {
+	byte statusBytes[LEN_SYS_STATUS];
+	readBytes(SYS_STATUS, NO_SUB, statusBytes, LEN_SYS_STATUS);
+	// clear exactly what is handled here. The interrupt is edge triggered, an event set meanwhile
+	// keeps the line high without a new edge, so go on until no event of the mask is left.
+	do {
+		writeBytes(SYS_STATUS, NO_SUB, statusBytes, LEN_SYS_STATUS);
+		queueEvents(eventBits(statusBytes));
+		readBytes(SYS_STATUS, NO_SUB, statusBytes, LEN_SYS_STATUS);
+	} while(eventBits(statusBytes) & eventBits(_sysmask));
+}
+
+void DW1000Class::queueEvents(uint32_t status) {
+	if(status & TX_STATUS_BITS) {
+		queueEvent(status & TX_STATUS_BITS, TX_TIME, 0);
+		status &= ~TX_STATUS_BITS;
+	}
+	Event received;
+	received.status = status;
+	boolean done = isReceiveDone(received);
+	if(isDoubleBuffered() && isReceiveOverrun(received)) {
+		// both buffers were full, the frame in the other buffer is lost
+		if(done) {
+			queueReceiveEvent(status & ~(1UL << RXOVRR_BIT));
+		}
+		queueEvent(1UL << RXOVRR_BIT, 0, 0);
+		resetReceiver();
+	} else if(done || isReceiveFailed(received) || isReceiveTimeout(received)) {
+		// with double buffering the receiver goes on with the other buffer by itself
+		if(_permanentReceive && !isDoubleBuffered() && !(isReceiveFailed(received) && getBit(_syscfg, LEN_SYS_CFG, RXAUTR_BIT))) {
+			// as early as possible, RX_FINFO and RX_TIME are kept until the next frame is done
+			restartReceive();
+		}
+		if(done) {
+			queueReceiveEvent(status);
+		} else {
+			queueEvent(status, 0, 0);
+		}
+	} else if(isClockProblem(received)) {
+		queueEvent(status, 0, 0);
+	}
+}
+
+void DW1000Class::queueReceiveEvent(uint32_t status) {
+	byte rxFrameInfo[2];
+	readBytes(RX_FINFO, NO_SUB, rxFrameInfo, 2);
+	queueEvent(status, RX_TIME, (((uint16_t)rxFrameInfo[1] << 8) | rxFrameInfo[0]) & 0x03FF);
+}
+
+void DW1000Class::queueEvent(uint32_t status, byte timeRegister, uint16_t frameLength) {
+	uint8_t head = _eventHead;
+	if((uint8_t)(head-_eventTail) >= DW1000_EVENT_QUEUE_SIZE) {
+		_eventOverflows++;
+		return;
+	}
+	Event& event = _events[head & (DW1000_EVENT_QUEUE_SIZE-1)];
+	event.status      = status;
+	event.frameLength = frameLength;
+#if RANGING_LATENCY
+	event.time        = micros();
+#endif
+	if(timeRegister != 0) {
+		// RX_STAMP_SUB and TX_STAMP_SUB are both 0
+		readBytes(timeRegister, NO_SUB, event.timestamp, LEN_STAMP);
+	} else {
+		memset(event.timestamp, 0, LEN_STAMP);
+	}
+	// publish only once the event is complete
+	_eventHead = head+1;
+}
+
+boolean DW1000Class::pollEvent(Event& event) {
+	uint8_t tail = _eventTail;
+	if(tail == _eventHead) {
+		return false;
+	}
+	event = _events[tail & (DW1000_EVENT_QUEUE_SIZE-1)];
+	// hand the slot back only once it was copied
+	_eventTail = tail+1;
+	return true;
+}
+
+uint8_t DW1000Class::getPendingEventCount() {
+	return (uint8_t)(_eventHead-_eventTail);
+}
+
+uint16_t DW1000Class::getEventOverflowCount() {
+	return _eventOverflows;
+}
+
+void DW1000Class::resetEventOverflowCount() {
+	_eventOverflows = 0;
+}
+
+void DW1000Class::resetReceiver() {
+	// after an overrun, see user manual 4.3.5: receiver off, reset it, align the buffer pointers,
+	// receiver on again
+	idle();
+	byte pmscctrl0 = 0xE0;
+	writeBytes(PMSC, PMSC_CTRL0_SUB+3, &pmscctrl0, 1);
+	pmscctrl0 = 0xF0;
+	writeBytes(PMSC, PMSC_CTRL0_SUB+3, &pmscctrl0, 1);
+	byte sysstatus;
+	readBytes(SYS_STATUS, 3, &sysstatus, 1);
+	// the host still has the event of the frame in its buffer to handle and release, so
+	// leave the pointers as if there was still a frame pending
+	if(bitRead(sysstatus, HSRBP_BIT-24) == bitRead(sysstatus, ICRBP_BIT-24)) {
+		releaseReceiveBuffer();
+	}
+	memset(_sysctrl, 0, LEN_SYS_CTRL);
+	_deviceMode = RX_MODE;
+	startReceive();
+}
+
+void DW1000Class::restartReceive() {
+	// as newReceive() and startReceive(), but leaves the event status to the interrupt handler. The
+	// receiver is off after a frame or a timeout, so it is only enabled, no TRXOFF first.
+	memset(_sysctrl, 0, LEN_SYS_CTRL);
+	_deviceMode = RX_MODE;
+	startReceive();
+}
+
+boolean DW1000Class::isReceiveTimestampAvailable(const Event& event) {
+	return (event.status & (1UL << LDEDONE_BIT)) != 0;
+}
+
+boolean DW1000Class::isTransmitDone(const Event& event) {
+	return (event.status & (1UL << TXFRS_BIT)) != 0;
+}
+
+boolean DW1000Class::isReceiveDone(const Event& event) {
+	if(_frameCheck) {
+		return (event.status & (1UL << RXFCG_BIT)) != 0;
+	}
+	return (event.status & (1UL << RXDFR_BIT)) != 0;
+}
+
+boolean DW1000Class::isReceiveFailed(const Event& event) {
+	return (event.status & ((1UL << LDEERR_BIT) | (1UL << RXFCE_BIT) | (1UL << RXPHE_BIT) | (1UL << RXRFSL_BIT))) != 0;
+}
+
+boolean DW1000Class::isReceiveTimeout(const Event& event) {
+	return (event.status & ((1UL << RXRFTO_BIT) | (1UL << RXPTO_BIT) | (1UL << RXSFDTO_BIT))) != 0;
+}
+
+boolean DW1000Class::isReceiveOverrun(const Event& event) {
+	return (event.status & (1UL << RXOVRR_BIT)) != 0;
+}
+
+boolean DW1000Class::isClockProblem(const Event& event) {
+	return (event.status & ((1UL << CLKPLL_LL_BIT) | (1UL << RFPLL_LL_BIT))) != 0;
+}
+
+void DW1000Class::getTransmitTimestamp(const Event& event, DW1000Time& time) {
+	time.setTimestamp(event.timestamp);
 }
 
 /* ###########################################################################
@@ -829,7 +1044,7 @@ void DW1000Class::readSystemConfigurationRegister() {
 }
 
 void DW1000Class::writeSystemConfigurationRegister() {
-	writeBytes(SYS_CFG, NO_SUB, _syscfg, LEN_SYS_CFG);
+	writeShadowedBytes(SHADOW_SYS_CFG, SYS_CFG, NO_SUB, _syscfg, LEN_SYS_CFG);
 }
 
 void DW1000Class::readSystemEventStatusRegister() {
@@ -841,7 +1056,7 @@ void DW1000Class::readNetworkIdAndDeviceAddress() {
 }
 
 void DW1000Class::writeNetworkIdAndDeviceAddress() {
-	writeBytes(PANADR, NO_SUB, _networkAndAddress, LEN_PANADR);
+	writeShadowedBytes(SHADOW_PANADR, PANADR, NO_SUB, _networkAndAddress, LEN_PANADR);
 }
 
 void DW1000Class::readSystemEventMaskRegister() {
@@ -849,7 +1064,7 @@ void DW1000Class::readSystemEventMaskRegister() {
 }
 
 void DW1000Class::writeSystemEventMaskRegister() {
-	writeBytes(SYS_MASK, NO_SUB, _sysmask, LEN_SYS_MASK);
+	writeShadowedBytes(SHADOW_SYS_MASK, SYS_MASK, NO_SUB, _sysmask, LEN_SYS_MASK);
 }
 
 void DW1000Class::readChannelControlRegister() {
@@ -857,7 +1072,7 @@ void DW1000Class::readChannelControlRegister() {
 }
 
 void DW1000Class::writeChannelControlRegister() {
-	writeBytes(CHAN_CTRL, NO_SUB, _chanctrl, LEN_CHAN_CTRL);
+	writeShadowedBytes(SHADOW_CHAN_CTRL, CHAN_CTRL, NO_SUB, _chanctrl, LEN_CHAN_CTRL);
 }
 
 void DW1000Class::readTransmitFrameControlRegister() {
@@ -865,7 +1080,7 @@ void DW1000Class::readTransmitFrameControlRegister() {
 }
 
 void DW1000Class::writeTransmitFrameControlRegister() {
-	writeBytes(TX_FCTRL, NO_SUB, _txfctrl, LEN_TX_FCTRL);
+	writeShadowedBytes(SHADOW_TX_FCTRL, TX_FCTRL, NO_SUB, _txfctrl, LEN_TX_FCTRL);
 }
 
 /* ###########################################################################
@@ -966,6 +1181,10 @@ void DW1000Class::setFrameFilterAllowReserved(boolean val) {
 }
 
 
+boolean DW1000Class::isDoubleBuffered() {
+	return !getBit(_syscfg, LEN_SYS_CFG, DIS_DRXB_BIT);
+}
+
 void DW1000Class::setDoubleBuffering(boolean val) {
 	setBit(_syscfg, LEN_SYS_CFG, DIS_DRXB_BIT, !val);
 }
@@ -1062,11 +1281,12 @@ void DW1000Class::startTransmit() {
 
 void DW1000Class::newConfiguration() {
 	idle();
-	readNetworkIdAndDeviceAddress();
-	readSystemConfigurationRegister();
-	readChannelControlRegister();
-	readTransmitFrameControlRegister();
-	readSystemEventMaskRegister();
+	// registers last written by us are known without reading them
+	readShadowedBytes(SHADOW_PANADR, PANADR, NO_SUB, _networkAndAddress, LEN_PANADR);
+	readShadowedBytes(SHADOW_SYS_CFG, SYS_CFG, NO_SUB, _syscfg, LEN_SYS_CFG);
+	readShadowedBytes(SHADOW_CHAN_CTRL, CHAN_CTRL, NO_SUB, _chanctrl, LEN_CHAN_CTRL);
+	readShadowedBytes(SHADOW_TX_FCTRL, TX_FCTRL, NO_SUB, _txfctrl, LEN_TX_FCTRL);
+	readShadowedBytes(SHADOW_SYS_MASK, SYS_MASK, NO_SUB, _sysmask, LEN_SYS_MASK);
 }
 
 void DW1000Class::commitConfiguration() {
@@ -1086,8 +1306,8 @@ void DW1000Class::commitConfiguration() {
 	} // Compatibility with old versions.
 	_antennaDelay.getTimestamp(antennaDelayBytes);
 
-	writeBytes(TX_ANTD, NO_SUB, antennaDelayBytes, LEN_TX_ANTD);
-	writeBytes(LDE_IF, LDE_RXANTD_SUB, antennaDelayBytes, LEN_LDE_RXANTD);
+	writeShadowedBytes(SHADOW_TX_ANTD, TX_ANTD, NO_SUB, antennaDelayBytes, LEN_TX_ANTD);
+	writeShadowedBytes(SHADOW_LDE_RXANTD, LDE_IF, LDE_RXANTD_SUB, antennaDelayBytes, LEN_LDE_RXANTD);
 }
 
 void DW1000Class::waitForResponse(boolean val) {
@@ -1104,6 +1324,16 @@ void DW1000Class::useSmartPower(boolean smartPower) {
 }
 
 DW1000Time DW1000Class::setDelay(const DW1000Time& delay) {
+	if(_deviceMode != TX_MODE && _deviceMode != RX_MODE) {
+		// in idle, ignore
+		return DW1000Time();
+	}
+	DW1000Time now;
+	getSystemTimestamp(now);
+	return setDelayFromTimestamp(now, delay);
+}
+
+DW1000Time DW1000Class::setDelayFromTimestamp(const DW1000Time& base, const DW1000Time& delay) {
 	if(_deviceMode == TX_MODE) {
 		setBit(_sysctrl, LEN_SYS_CTRL, TXDLYS_BIT, true);
 	} else if(_deviceMode == RX_MODE) {
@@ -1113,8 +1343,7 @@ DW1000Time DW1000Class::setDelay(const DW1000Time& delay) {
 		return DW1000Time();
 	}
 	byte       delayBytes[5];
-	DW1000Time futureTime;
-	getSystemTimestamp(futureTime);
+	DW1000Time futureTime = base;
 	futureTime += delay;
 	futureTime.getTimestamp(delayBytes);
 	delayBytes[0] = 0;
@@ -1127,6 +1356,48 @@ DW1000Time DW1000Class::setDelay(const DW1000Time& delay) {
 }
 
 
+uint16_t DW1000Class::getSyncHeaderDuration() {
+	uint16_t symbols;
+	switch(_preambleLength) {
+		case TX_PREAMBLE_LEN_64:   symbols = 64;   break;
+		case TX_PREAMBLE_LEN_128:  symbols = 128;  break;
+		case TX_PREAMBLE_LEN_256:  symbols = 256;  break;
+		case TX_PREAMBLE_LEN_512:  symbols = 512;  break;
+		case TX_PREAMBLE_LEN_1024: symbols = 1024; break;
+		case TX_PREAMBLE_LEN_1536: symbols = 1536; break;
+		case TX_PREAMBLE_LEN_2048: symbols = 2048; break;
+		default:                   symbols = 4096; break;
+	}
+	// SFD length as set by setDataRate()
+	if(_dataRate == TRX_RATE_6800KBPS) {
+		symbols += 8;
+	} else if(_dataRate == TRX_RATE_850KBPS) {
+		symbols += 16;
+	} else {
+		symbols += 64;
+	}
+	// preamble symbol duration, see user manual table 6: 993.59 ns (16 MHz PRF) or 1017.63 ns (64 MHz PRF)
+	if(_pulseFrequency == TX_PULSE_FREQ_64MHZ) {
+		return (uint16_t)(((uint32_t)symbols*101763UL+99999UL)/100000UL);
+	}
+	return (uint16_t)(((uint32_t)symbols*99359UL+99999UL)/100000UL);
+}
+
+uint32_t DW1000Class::getFrameDuration(uint16_t length) {
+	// data bits incl. Reed-Solomon parity (48 bits per block of up to 330 bits)
+	uint32_t bits = (uint32_t)length*8;
+	bits += (bits+329)/330*48;
+	// bit durations in 0.1 ns, the header (21 bits) is sent with 850 kbps unless the data rate is 110 kbps
+	uint32_t headerBit, dataBit;
+	if(_dataRate == TRX_RATE_110KBPS) {
+		headerBit = dataBit = 82051UL;
+	} else {
+		headerBit = 10256UL;
+		dataBit   = _dataRate == TRX_RATE_850KBPS ? 10256UL : 1282UL;
+	}
+	return getSyncHeaderDuration()+(21*headerBit+bits*dataBit+9999UL)/10000UL;
+}
+
 void DW1000Class::setDataRate(byte rate) {
 	rate &= 0x03;
 	_txfctrl[1] &= 0x83;
@@ -1159,7 +1430,7 @@ void DW1000Class::setDataRate(byte rate) {
 	} else {
 		sfdLength = 0x40;
 	}
-	writeBytes(USR_SFD, SFD_LENGTH_SUB, &sfdLength, LEN_SFD_LENGTH);
+	writeShadowedBytes(SHADOW_SFD_LENGTH, USR_SFD, SFD_LENGTH_SUB, &sfdLength, LEN_SFD_LENGTH);
 	_dataRate = rate;
 }
 
@@ -1331,6 +1602,13 @@ uint16_t DW1000Class::getDataLength() {
 	return len;
 }
 
+uint16_t DW1000Class::getDataLength(const RxDiagnostics& diagnostics) {
+	if(_frameCheck && diagnostics.frameLength > 2) {
+		return diagnostics.frameLength-2;
+	}
+	return diagnostics.frameLength;
+}
+
 void DW1000Class::getData(byte data[], uint16_t n) {
 	if(n <= 0) {
 		return;
@@ -1370,10 +1648,20 @@ void DW1000Class::getReceiveTimestamp(DW1000Time& time) {
 	correctTimestamp(time);
 }
 
-// TODO check function, different type violations between byte and int
+void DW1000Class::getReceiveTimestamp(const RxDiagnostics& diagnostics, DW1000Time& time) {
+	time.setTimestamp(diagnostics.timestamp);
+	// correct timestamp (i.e. consider range bias)
+	correctTimestamp(time, getReceivePower(diagnostics));
+}
+
 void DW1000Class::correctTimestamp(DW1000Time& timestamp) {
+	correctTimestamp(timestamp, getReceivePower());
+}
+
+// TODO check function, different type violations between byte and int
+void DW1000Class::correctTimestamp(DW1000Time& timestamp, float rxPower) {
 	// base line dBm, which is -61, 2 dBm steps, total 18 data points (down to -95 dBm)
-	float rxPowerBase     = -(getReceivePower()+61.0f)*0.5f;
+	float rxPowerBase     = -(rxPower+61.0f)*0.5f;
 	int16_t   rxPowerBaseLow  = (int16_t)rxPowerBase; // TODO check type
 	int16_t   rxPowerBaseHigh = rxPowerBaseLow+1; // TODO check type
 	if(rxPowerBaseLow <= 0) {
@@ -1516,59 +1804,97 @@ void DW1000Class::clearTransmitStatus() {
 	writeBytes(SYS_STATUS, NO_SUB, _sysstatus, LEN_SYS_STATUS);
 }
 
+void DW1000Class::captureRxDiagnostics(RxDiagnostics& diagnostics) {
+	byte rxFrameInfo[LEN_RX_FINFO];
+	byte rxFrameQuality[LEN_RX_FQUAL];
+	byte rxTime[FP_AMPL1_SUB+LEN_FP_AMPL1];
+	// one transaction per register, each read as a whole
+	readBytes(RX_FINFO, NO_SUB, rxFrameInfo, LEN_RX_FINFO);
+	readBytes(RX_FQUAL, NO_SUB, rxFrameQuality, LEN_RX_FQUAL);
+	readBytes(RX_TIME, NO_SUB, rxTime, FP_AMPL1_SUB+LEN_FP_AMPL1);
+	memcpy(diagnostics.timestamp, rxTime+RX_STAMP_SUB, LEN_RX_STAMP);
+	diagnostics.frameLength         = ((((uint16_t)rxFrameInfo[1] << 8) | (uint16_t)rxFrameInfo[0]) & 0x03FF);
+	diagnostics.preambleCount       = (((uint16_t)rxFrameInfo[2] >> 4) & 0xFF) | ((uint16_t)rxFrameInfo[3] << 4);
+	diagnostics.noise               = (uint16_t)rxFrameQuality[STD_NOISE_SUB] | ((uint16_t)rxFrameQuality[STD_NOISE_SUB+1] << 8);
+	diagnostics.firstPathAmplitude1 = (uint16_t)rxTime[FP_AMPL1_SUB] | ((uint16_t)rxTime[FP_AMPL1_SUB+1] << 8);
+	diagnostics.firstPathAmplitude2 = (uint16_t)rxFrameQuality[FP_AMPL2_SUB] | ((uint16_t)rxFrameQuality[FP_AMPL2_SUB+1] << 8);
+	diagnostics.firstPathAmplitude3 = (uint16_t)rxFrameQuality[FP_AMPL3_SUB] | ((uint16_t)rxFrameQuality[FP_AMPL3_SUB+1] << 8);
+	diagnostics.channelImpulsePower = (uint16_t)rxFrameQuality[CIR_PWR_SUB] | ((uint16_t)rxFrameQuality[CIR_PWR_SUB+1] << 8);
+}
+
+void DW1000Class::readReceivedFrame(byte data[], uint16_t n, RxDiagnostics& diagnostics) {
+	captureRxDiagnostics(diagnostics);
+	getData(data, n);
+	releaseReceiveBuffer();
+}
+
+void DW1000Class::releaseReceiveBuffer() {
+	if(!isDoubleBuffered()) {
+		return;
+	}
+	// HRBPT only toggles the host side buffer, so just write that byte of SYS_CTRL
+	byte sysctrl = (1 << (HRBPT_BIT-24));
+	writeBytes(SYS_CTRL, 3, &sysctrl, 1);
+}
+
 float DW1000Class::getReceiveQuality() {
-	byte         noiseBytes[LEN_STD_NOISE];
-	byte         fpAmpl2Bytes[LEN_FP_AMPL2];
-	uint16_t     noise, f2;
+	byte          noiseBytes[LEN_STD_NOISE];
+	byte          fpAmpl2Bytes[LEN_FP_AMPL2];
+	RxDiagnostics diagnostics;
 	readBytes(RX_FQUAL, STD_NOISE_SUB, noiseBytes, LEN_STD_NOISE);
 	readBytes(RX_FQUAL, FP_AMPL2_SUB, fpAmpl2Bytes, LEN_FP_AMPL2);
-	noise = (uint16_t)noiseBytes[0] | ((uint16_t)noiseBytes[1] << 8);
-	f2    = (uint16_t)fpAmpl2Bytes[0] | ((uint16_t)fpAmpl2Bytes[1] << 8);
-	return (float)f2/noise;
+	diagnostics.noise               = (uint16_t)noiseBytes[0] | ((uint16_t)noiseBytes[1] << 8);
+	diagnostics.firstPathAmplitude2 = (uint16_t)fpAmpl2Bytes[0] | ((uint16_t)fpAmpl2Bytes[1] << 8);
+	return getReceiveQuality(diagnostics);
+}
+
+float DW1000Class::getReceiveQuality(const RxDiagnostics& diagnostics) {
+	return (float)diagnostics.firstPathAmplitude2/diagnostics.noise;
 }
 
 float DW1000Class::getFirstPathPower() {
-	byte         fpAmpl1Bytes[LEN_FP_AMPL1];
-	byte         fpAmpl2Bytes[LEN_FP_AMPL2];
-	byte         fpAmpl3Bytes[LEN_FP_AMPL3];
-	byte         rxFrameInfo[LEN_RX_FINFO];
-	uint16_t     f1, f2, f3, N;
-	float        A, corrFac;
+	byte          fpAmpl1Bytes[LEN_FP_AMPL1];
+	byte          fpAmpl23Bytes[LEN_FP_AMPL2+LEN_FP_AMPL3];
+	byte          rxFrameInfo[LEN_RX_FINFO];
+	RxDiagnostics diagnostics;
 	readBytes(RX_TIME, FP_AMPL1_SUB, fpAmpl1Bytes, LEN_FP_AMPL1);
-	readBytes(RX_FQUAL, FP_AMPL2_SUB, fpAmpl2Bytes, LEN_FP_AMPL2);
-	readBytes(RX_FQUAL, FP_AMPL3_SUB, fpAmpl3Bytes, LEN_FP_AMPL3);
+	readBytes(RX_FQUAL, FP_AMPL2_SUB, fpAmpl23Bytes, LEN_FP_AMPL2+LEN_FP_AMPL3);
 	readBytes(RX_FINFO, NO_SUB, rxFrameInfo, LEN_RX_FINFO);
-	f1 = (uint16_t)fpAmpl1Bytes[0] | ((uint16_t)fpAmpl1Bytes[1] << 8);
-	f2 = (uint16_t)fpAmpl2Bytes[0] | ((uint16_t)fpAmpl2Bytes[1] << 8);
-	f3 = (uint16_t)fpAmpl3Bytes[0] | ((uint16_t)fpAmpl3Bytes[1] << 8);
-	N  = (((uint16_t)rxFrameInfo[2] >> 4) & 0xFF) | ((uint16_t)rxFrameInfo[3] << 4);
-	if(_pulseFrequency == TX_PULSE_FREQ_16MHZ) {
-		A       = 113.77;
-		corrFac = 2.3334;
-	} else {
-		A       = 121.74;
-		corrFac = 1.1667;
-	}
-	float estFpPwr = 10.0*log10(((float)f1*(float)f1+(float)f2*(float)f2+(float)f3*(float)f3)/((float)N*(float)N))-A;
-	if(estFpPwr <= -88) {
-		return estFpPwr;
-	} else {
-		// approximation of Fig. 22 in user manual for dbm correction
-		estFpPwr += (estFpPwr+88)*corrFac;
-	}
-	return estFpPwr;
+	diagnostics.firstPathAmplitude1 = (uint16_t)fpAmpl1Bytes[0] | ((uint16_t)fpAmpl1Bytes[1] << 8);
+	diagnostics.firstPathAmplitude2 = (uint16_t)fpAmpl23Bytes[0] | ((uint16_t)fpAmpl23Bytes[1] << 8);
+	diagnostics.firstPathAmplitude3 = (uint16_t)fpAmpl23Bytes[2] | ((uint16_t)fpAmpl23Bytes[3] << 8);
+	diagnostics.preambleCount       = (((uint16_t)rxFrameInfo[2] >> 4) & 0xFF) | ((uint16_t)rxFrameInfo[3] << 4);
+	return getFirstPathPower(diagnostics);
+}
+
+float DW1000Class::getFirstPathPower(const RxDiagnostics& diagnostics) {
+	float f1 = (float)diagnostics.firstPathAmplitude1;
+	float f2 = (float)diagnostics.firstPathAmplitude2;
+	float f3 = (float)diagnostics.firstPathAmplitude3;
+	float N  = (float)diagnostics.preambleCount;
+	return correctPower(10.0*log10((f1*f1+f2*f2+f3*f3)/(N*N)));
 }
 
 float DW1000Class::getReceivePower() {
-	byte     cirPwrBytes[LEN_CIR_PWR];
-	byte     rxFrameInfo[LEN_RX_FINFO];
-	uint32_t twoPower17 = 131072;
-	uint16_t C, N;
-	float    A, corrFac;
+	byte          cirPwrBytes[LEN_CIR_PWR];
+	byte          rxFrameInfo[LEN_RX_FINFO];
+	RxDiagnostics diagnostics;
 	readBytes(RX_FQUAL, CIR_PWR_SUB, cirPwrBytes, LEN_CIR_PWR);
 	readBytes(RX_FINFO, NO_SUB, rxFrameInfo, LEN_RX_FINFO);
-	C = (uint16_t)cirPwrBytes[0] | ((uint16_t)cirPwrBytes[1] << 8);
-	N = (((uint16_t)rxFrameInfo[2] >> 4) & 0xFF) | ((uint16_t)rxFrameInfo[3] << 4);
+	diagnostics.channelImpulsePower = (uint16_t)cirPwrBytes[0] | ((uint16_t)cirPwrBytes[1] << 8);
+	diagnostics.preambleCount       = (((uint16_t)rxFrameInfo[2] >> 4) & 0xFF) | ((uint16_t)rxFrameInfo[3] << 4);
+	return getReceivePower(diagnostics);
+}
+
+float DW1000Class::getReceivePower(const RxDiagnostics& diagnostics) {
+	uint32_t twoPower17 = 131072;
+	float    C = (float)diagnostics.channelImpulsePower;
+	float    N = (float)diagnostics.preambleCount;
+	return correctPower(10.0*log10((C*(float)twoPower17)/(N*N)));
+}
+
+float DW1000Class::correctPower(float estimatedPower) {
+	float A, corrFac;
 	if(_pulseFrequency == TX_PULSE_FREQ_16MHZ) {
 		A       = 113.77;
 		corrFac = 2.3334;
@@ -1576,14 +1902,14 @@ float DW1000Class::getReceivePower() {
 		A       = 121.74;
 		corrFac = 1.1667;
 	}
-	float estRxPwr = 10.0*log10(((float)C*(float)twoPower17)/((float)N*(float)N))-A;
-	if(estRxPwr <= -88) {
-		return estRxPwr;
+	estimatedPower -= A;
+	if(estimatedPower <= -88) {
+		return estimatedPower;
 	} else {
 		// approximation of Fig. 22 in user manual for dbm correction
-		estRxPwr += (estRxPwr+88)*corrFac;
+		estimatedPower += (estimatedPower+88)*corrFac;
 	}
-	return estRxPwr;
+	return estimatedPower;
 }
 
 /* ###########################################################################
@@ -1663,7 +1989,6 @@ void DW1000Class::writeValueToBytes(byte data[], int32_t val, uint16_t n) {
 void DW1000Class::readBytes(byte cmd, uint16_t offset, byte data[], uint16_t n) {
 	byte header[3];
 	uint8_t headerLen = 1;
-	uint16_t i = 0;
 	
 	// build SPI header
 	if(offset == NO_SUB) {
@@ -1679,17 +2004,19 @@ void DW1000Class::readBytes(byte cmd, uint16_t offset, byte data[], uint16_t n)
 			headerLen += 2;
 		}
 	}
+	// values are clocked in place of the junk bytes
+	memset(data, JUNK, n);
 	SPI.beginTransaction(*_currentSPI);
 	digitalWrite(_ss, LOW);
-	for(i = 0; i < headerLen; i++) {
-		SPI.transfer(header[i]); // send header
-	}
-	for(i = 0; i < n; i++) {
-		data[i] = SPI.transfer(JUNK); // read values
+	SPI.transfer(header, headerLen); // send header
+	SPI.transfer(data, n); // read values
+	if(_spiHoldTime > 0) {
+		delayMicroseconds(_spiHoldTime);
 	}
-	delayMicroseconds(5);
 	digitalWrite(_ss, HIGH);
 	SPI.endTransaction();
+	_spiTransactions++;
+	_spiBytes += headerLen+n;
 }
 
 // always 4 bytes
@@ -1732,36 +2059,110 @@ void DW1000Class::writeByte(byte cmd, uint16_t offset, byte data) {
  */
 // TODO offset really bigger than byte?
 void DW1000Class::writeBytes(byte cmd, uint16_t offset, byte data[], uint16_t data_size) {
-	byte header[3];
-	uint8_t  headerLen = 1;
-	uint16_t  i = 0;
+	static_assert(DW1000_SPI_WRITE_CHUNK >= 4, "DW1000_SPI_WRITE_CHUNK too small");
+	// block transfers overwrite the buffer with the received bytes, so copy
+	// the data instead of handing out the (often cached) caller array
+	byte     buffer[DW1000_SPI_WRITE_CHUNK];
+	uint16_t bufferLen = 1;
+	uint16_t i = 0;
 	
 	// TODO proper error handling: address out of bounds
 	// build SPI header
 	if(offset == NO_SUB) {
-		header[0] = WRITE | cmd;
+		buffer[0] = WRITE | cmd;
 	} else {
-		header[0] = WRITE_SUB | cmd;
+		buffer[0] = WRITE_SUB | cmd;
 		if(offset < 128) {
-			header[1] = (byte)offset;
-			headerLen++;
+			buffer[1] = (byte)offset;
+			bufferLen++;
 		} else {
-			header[1] = RW_SUB_EXT | (byte)offset;
-			header[2] = (byte)(offset >> 7);
-			headerLen += 2;
+			buffer[1] = RW_SUB_EXT | (byte)offset;
+			buffer[2] = (byte)(offset >> 7);
+			bufferLen += 2;
 		}
 	}
+	_spiBytes += bufferLen+data_size;
 	SPI.beginTransaction(*_currentSPI);
 	digitalWrite(_ss, LOW);
-	for(i = 0; i < headerLen; i++) {
-		SPI.transfer(header[i]); // send header
-	}
-	for(i = 0; i < data_size; i++) {
-		SPI.transfer(data[i]); // write values
+	// header and payload in one go, longer writes in chunks
+	do {
+		uint16_t chunk = data_size-i;
+		if(chunk > DW1000_SPI_WRITE_CHUNK-bufferLen) {
+			chunk = DW1000_SPI_WRITE_CHUNK-bufferLen;
+		}
+		memcpy(buffer+bufferLen, data+i, chunk);
+		SPI.transfer(buffer, bufferLen+chunk); // write values
+		i += chunk;
+		bufferLen = 0;
+	} while(i < data_size);
+	if(_spiHoldTime > 0) {
+		delayMicroseconds(_spiHoldTime);
 	}
-	delayMicroseconds(5);
 	digitalWrite(_ss, HIGH);
 	SPI.endTransaction();
+	_spiTransactions++;
+}
+
+void DW1000Class::setSPIHoldTime(uint8_t us) {
+	_spiHoldTime = us;
+}
+
+uint32_t DW1000Class::getSPITransactionCount() {
+	return _spiTransactions;
+}
+
+uint32_t DW1000Class::getSPIByteCount() {
+	return _spiBytes;
+}
+
+void DW1000Class::resetSPIStatistics() {
+	_spiTransactions = 0;
+	_spiBytes        = 0;
+	_spiBytesSaved   = 0;
+}
+
+uint32_t DW1000Class::getSPIBytesSaved() {
+	return _spiBytesSaved;
+}
+
+/*
+ * Configuration registers are mostly written with the values they already
+ * hold (every commitConfiguration() runs a full tune(), every transmission
+ * writes TX_FCTRL). A copy of each such register as last written is kept,
+ * a write is only done if the value differs from that copy. The copies are
+ * invalidated on every reset and wake-up.
+ */
+void DW1000Class::readShadowedBytes(byte shadow, byte cmd, uint16_t offset, byte data[], uint16_t n) {
+	uint8_t position = 0;
+	for(uint8_t i = 0; i < shadow; i++) {
+		position += SHADOW_LENGTH[i];
+	}
+	if(_shadowValid & (1UL << shadow)) {
+		memcpy(data, _shadow+position, n);
+		_spiBytesSaved += (offset == NO_SUB ? 1 : (offset < 128 ? 2 : 3))+n;
+		return;
+	}
+	readBytes(cmd, offset, data, n);
+	memcpy(_shadow+position, data, n);
+	_shadowValid |= (1UL << shadow);
+}
+
+void DW1000Class::writeShadowedBytes(byte shadow, byte cmd, uint16_t offset, byte data[], uint16_t n) {
+	uint8_t position = 0;
+	for(uint8_t i = 0; i < shadow; i++) {
+		position += SHADOW_LENGTH[i];
+	}
+	if((_shadowValid & (1UL << shadow)) && memcmp(_shadow+position, data, n) == 0) {
+		_spiBytesSaved += (offset == NO_SUB ? 1 : (offset < 128 ? 2 : 3))+n;
+		return;
+	}
+	writeBytes(cmd, offset, data, n);
+	memcpy(_shadow+position, data, n);
+	_shadowValid |= (1UL << shadow);
+}
+
+void DW1000Class::invalidateShadow() {
+	_shadowValid = 0;
 }
 
 
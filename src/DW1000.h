@@ -22,7 +22,6 @@
  * - TXBOFFS in TX_FCTRL for offset buffer transmit
  * - TR in TX_FCTRL for flagging for ranging messages
  * - CANSFCS in SYS_CTRL to cancel frame check suppression
- * - HSRBP in SYS_CTRL to determine in double buffered mode from which buffer to read
  */
 
 #ifndef _DW1000_H_INCLUDED
@@ -33,6 +32,7 @@
 #include <string.h>
 #include <Arduino.h>
 #include <SPI.h>
+#include "DW1000CompileOptions.h"
 #include "DW1000Constants.h"
 #include "DW1000Time.h"
 
@@ -193,6 +193,21 @@ public:
 	*/
 	static void setInterruptPolarity(boolean val);
 	
+	/** 
+	Specifies whether the receiver uses both of its receive buffers. If enabled, the receiver takes the
+	next frame into the second buffer while the last one is still to be read, and a buffer is handed back
+	to the receiver with `releaseReceiveBuffer()` (or `readReceivedFrame()`).
+
+	Meant for use with the event queue and permanent receive (see `useEventQueue()`), the receiver
+	is then not restarted after each frame. If both buffers are full, the frame is lost and the
+	receiver is reset (see `isReceiveOverrun()`).
+
+	Double buffering is disabled by `select()`.
+
+	@param[in] val `true` to enable, `false` to disable double buffering.
+	*/
+	static void setDoubleBuffering(boolean val);
+	
 	/** 
 	Specifies whether to suppress any frame check measures while sending or receiving messages.
 	If suppressed, no 2-byte checksum is appended to the message before sending and this 
@@ -242,6 +257,38 @@ public:
 	
 	/* transmit and receive configuration. */
 	static DW1000Time   setDelay(const DW1000Time& delay);
+	
+	/** 
+	Same as `setDelay()`, but relative to a given chip time instead of the current one, usually
+	the receive timestamp of the frame to reply to. This saves reading the system time and makes
+	the reply time independent of how long it took to get here. The delay has to cover that time
+	though, otherwise the chip only sends once its clock wraps around (after about 17 s), see
+	`getSystemTimestamp()` to check.
+
+	@param[in] base The chip time to start from.
+	@param[in] delay The delay after `base`.
+
+	@return The expected transmit (or receive) timestamp, including the antenna delay.
+	*/
+	static DW1000Time   setDelayFromTimestamp(const DW1000Time& base, const DW1000Time& delay);
+	
+	/** 
+	Time it takes to send the preamble and SFD with the current configuration, i.e. from the start
+	of a transmission to its timestamp. A delayed transmission has to be started at least this much
+	ahead of the time given by `setDelay()` or `setDelayFromTimestamp()`.
+
+	@return The duration in microseconds.
+	*/
+	static uint16_t     getSyncHeaderDuration();
+	/**
+	Time a frame takes on air with the current configuration, from the start of the preamble to the
+	end of the last data bit.
+
+	@param[in] length The frame length in bytes, including the two FCS bytes.
+
+	@return The duration in microseconds.
+	*/
+	static uint32_t     getFrameDuration(uint16_t length);
 	static void         receivePermanently(boolean val);
 	static void         setData(byte data[], uint16_t n);
 	static void         setData(const String& data);
@@ -260,6 +307,53 @@ public:
 	static float getFirstPathPower();
 	static float getReceiveQuality();
 	
+	/* ##### Receive diagnostics ################################################# */
+	/** 
+	Everything the driver derives from a received frame (timestamp, powers, quality and
+	frame length), as read from the RX_TIME, RX_FQUAL and RX_FINFO registers.
+	*/
+	struct RxDiagnostics {
+		byte     timestamp[LEN_RX_STAMP]; // raw, not bias corrected
+		uint16_t frameLength;            // incl. the two FCS bytes
+		uint16_t preambleCount;          // accumulated preamble symbols (RXPACC)
+		uint16_t noise;                  // STD_NOISE
+		uint16_t firstPathAmplitude1;
+		uint16_t firstPathAmplitude2;
+		uint16_t firstPathAmplitude3;
+		uint16_t channelImpulsePower;    // CIR_PWR
+	};
+	
+	/** 
+	Reads all receive diagnostics of the last received frame with three SPI transactions. Use
+	the overloads below taking the snapshot instead of the single value getters, which each
+	read their registers again.
+
+	@param[out] diagnostics The snapshot to be filled.
+	*/
+	static void  captureRxDiagnostics(RxDiagnostics& diagnostics);
+	
+	/** 
+	Reads the first `n` bytes of the last received frame and its receive diagnostics, then hands the
+	receive buffer back to the receiver (see `releaseReceiveBuffer()`).
+
+	@param[out] data The frame data.
+	@param[in] n The number of bytes to read.
+	@param[out] diagnostics The receive diagnostics of the frame.
+	*/
+	static void  readReceivedFrame(byte data[], uint16_t n, RxDiagnostics& diagnostics);
+	
+	/** 
+	Hands the receive buffer holding the last received frame back to the receiver, in double buffered
+	mode (see `setDoubleBuffering()`). Switches to the other buffer, which holds the next frame if
+	one was received meanwhile. Does nothing with a single receive buffer.
+	*/
+	static void  releaseReceiveBuffer();
+	static void  getReceiveTimestamp(const RxDiagnostics& diagnostics, DW1000Time& time);
+	static float getReceivePower(const RxDiagnostics& diagnostics);
+	static float getFirstPathPower(const RxDiagnostics& diagnostics);
+	static float getReceiveQuality(const RxDiagnostics& diagnostics);
+	static uint16_t getDataLength(const RxDiagnostics& diagnostics);
+	
 	/* interrupt management. */
 	static void interruptOnSent(boolean val);
 	static void interruptOnReceived(boolean val);
@@ -297,6 +391,69 @@ public:
 		_handleReceiveTimestampAvailable = handleReceiveTimestampAvailable;
 	}
 	
+	/* ##### Event queue ######################################################### */
+	/** 
+	A device event as latched by the interrupt handler when the event queue is used, see
+	useEventQueue().
+	*/
+	struct Event {
+		uint32_t status;                // SYS_STATUS bits 0 to 31 at interrupt time
+		byte     timestamp[LEN_STAMP];  // TX_STAMP if sent, raw RX_STAMP if received
+		uint16_t frameLength;           // incl. the two FCS bytes, if received
+#if RANGING_LATENCY
+		uint32_t time;                  // micros() at interrupt time
+#endif
+	};
+	
+	/** 
+	Enables (or disables) deferred interrupt handling. Instead of calling the attached handlers, the
+	interrupt handler then only latches the event status, timestamp and frame length into a queue
+	of `DW1000_EVENT_QUEUE_SIZE` events, which are taken out in order with pollEvent(). A frame
+	completing while an earlier one is still queued is thus not lost.
+
+	If a transmission and a reception are both done by the time the interrupt is served, they are
+	queued as two events (the transmission first).
+
+	The frame itself stays in the receive buffer. With permanent receive and a single receive
+	buffer, the receiver is enabled again right away, so read the frame before the next one is
+	done. With double buffering (see `setDoubleBuffering()`), the frame stays until the buffer is
+	released.
+
+	@param[in] val `true` to queue events, `false` (default) to call the attached handlers.
+	*/
+	static void useEventQueue(boolean val);
+	
+	/** 
+	Takes the oldest event out of the queue.
+
+	@param[out] event The event, if any.
+
+	@return `true` if there was an event.
+	*/
+	static boolean pollEvent(Event& event);
+	
+	/** 
+	@return The number of events waiting in the queue.
+	*/
+	static uint8_t getPendingEventCount();
+	
+	/** 
+	Number of events dropped since the last call to resetEventOverflowCount(), because the queue
+	was full. Increase `DW1000_EVENT_QUEUE_SIZE` or poll more often if this is not zero.
+	*/
+	static uint16_t getEventOverflowCount();
+	static void     resetEventOverflowCount();
+	
+	/* event status flags and timestamp of a queued event. */
+	static boolean isReceiveTimestampAvailable(const Event& event);
+	static boolean isTransmitDone(const Event& event);
+	static boolean isReceiveDone(const Event& event);
+	static boolean isReceiveFailed(const Event& event);
+	static boolean isReceiveTimeout(const Event& event);
+	static boolean isClockProblem(const Event& event);
+	static boolean isReceiveOverrun(const Event& event);
+	static void    getTransmitTimestamp(const Event& event, DW1000Time& time);
+	
 	/* device state management. */
 	// idle state
 	static void idle();
@@ -351,6 +508,32 @@ public:
 	// host-initiated reading of temperature and battery voltage
 	static void getTempAndVbat(float& temp, float& vbat);
 	
+	/* ##### SPI transfer settings and statistics ################################ */
+	/** 
+	Sets the time chip select is kept low after the last byte of every SPI transaction. The
+	DW1000 does not need any hold time, so 0 gives the shortest transactions. The default is
+	`DW1000_SPI_HOLD_TIME_US` (see DW1000CompileOptions.h).
+
+	@param[in] us The hold time in microseconds.
+	*/
+	static void setSPIHoldTime(uint8_t us);
+	
+	/** 
+	Number of SPI transactions (chip select low to high) and bytes transferred (header and
+	payload) since start up or the last call to `resetSPIStatistics()`. Each byte takes 8 bus
+	clock cycles.
+	*/
+	static uint32_t getSPITransactionCount();
+	static uint32_t getSPIByteCount();
+	static void     resetSPIStatistics();
+	
+	/** 
+	Number of SPI bytes not transferred since the last call to `resetSPIStatistics()`, because
+	a configuration register already held the value to be written (or a register to be read
+	was known from the last write). See `commitConfiguration()`.
+	*/
+	static uint32_t getSPIBytesSaved();
+	
 	// transmission/reception bit rate
 	static constexpr byte TRX_RATE_110KBPS  = 0x00;
 	static constexpr byte TRX_RATE_850KBPS  = 0x01;
@@ -430,6 +613,13 @@ public:
 	static void (* _handleReceiveTimeout)(void);
 	static void (* _handleReceiveTimestampAvailable)(void);
 	
+	/* event queue, only written by the interrupt handler at the head and by pollEvent() at the tail. */
+	static boolean           _useEventQueue;
+	static Event             _events[DW1000_EVENT_QUEUE_SIZE];
+	static volatile uint8_t  _eventHead;
+	static volatile uint8_t  _eventTail;
+	static volatile uint16_t _eventOverflows;
+	
 	/* register caches. */
 	static byte _syscfg[LEN_SYS_CFG];
 	static byte _sysctrl[LEN_SYS_CTRL];
@@ -445,6 +635,41 @@ public:
 	/* PAN and short address. */
 	static byte _networkAndAddress[LEN_PANADR];
 	
+	/* shadow copies of the configuration registers as last written to the chip, so unchanged
+	 * values are not written again (see writeShadowedBytes()). */
+	enum ShadowRegister : uint8_t {
+		SHADOW_PANADR, SHADOW_SYS_CFG, SHADOW_CHAN_CTRL, SHADOW_TX_FCTRL, SHADOW_SYS_MASK,
+		SHADOW_AGC_TUNE1, SHADOW_AGC_TUNE2, SHADOW_AGC_TUNE3,
+		SHADOW_DRX_TUNE0b, SHADOW_DRX_TUNE1a, SHADOW_DRX_TUNE1b, SHADOW_DRX_TUNE2, SHADOW_DRX_TUNE4H,
+		SHADOW_LDE_CFG1, SHADOW_LDE_CFG2, SHADOW_LDE_REPC, SHADOW_TX_POWER,
+		SHADOW_RF_RXCTRLH, SHADOW_RF_TXCTRL, SHADOW_TC_PGDELAY,
+		SHADOW_FS_PLLTUNE, SHADOW_FS_PLLCFG, SHADOW_FS_XTALT,
+		SHADOW_TX_ANTD, SHADOW_LDE_RXANTD, SHADOW_SFD_LENGTH,
+		SHADOW_REGISTERS
+	};
+	static constexpr byte SHADOW_LENGTH[] = {
+		LEN_PANADR, LEN_SYS_CFG, LEN_CHAN_CTRL, LEN_TX_FCTRL, LEN_SYS_MASK,
+		LEN_AGC_TUNE1, LEN_AGC_TUNE2, LEN_AGC_TUNE3,
+		LEN_DRX_TUNE0b, LEN_DRX_TUNE1a, LEN_DRX_TUNE1b, LEN_DRX_TUNE2, LEN_DRX_TUNE4H,
+		LEN_LDE_CFG1, LEN_LDE_CFG2, LEN_LDE_REPC, LEN_TX_POWER,
+		LEN_RF_RXCTRLH, LEN_RF_TXCTRL, LEN_TC_PGDELAY,
+		LEN_FS_PLLTUNE, LEN_FS_PLLCFG, LEN_FS_XTALT,
+		LEN_TX_ANTD, LEN_LDE_RXANTD, LEN_SFD_LENGTH
+	};
+	static constexpr uint8_t LEN_SHADOW = LEN_PANADR+LEN_SYS_CFG+LEN_CHAN_CTRL+LEN_TX_FCTRL+LEN_SYS_MASK+
+	                                      LEN_AGC_TUNE1+LEN_AGC_TUNE2+LEN_AGC_TUNE3+
+	                                      LEN_DRX_TUNE0b+LEN_DRX_TUNE1a+LEN_DRX_TUNE1b+LEN_DRX_TUNE2+LEN_DRX_TUNE4H+
+	                                      LEN_LDE_CFG1+LEN_LDE_CFG2+LEN_LDE_REPC+LEN_TX_POWER+
+	                                      LEN_RF_RXCTRLH+LEN_RF_TXCTRL+LEN_TC_PGDELAY+
+	                                      LEN_FS_PLLTUNE+LEN_FS_PLLCFG+LEN_FS_XTALT+
+	                                      LEN_TX_ANTD+LEN_LDE_RXANTD+LEN_SFD_LENGTH;
+	static byte     _shadow[LEN_SHADOW];
+	static uint32_t _shadowValid; // one bit per ShadowRegister
+	static uint32_t _spiBytesSaved;
+	
+	/* crystal trim value from OTP, read once on select(). */
+	static byte _xtalTrim;
+	
 	/* internal helper that guide tuning the chip. */
 	static boolean    _smartPower;
 	static byte       _extendedFrameLength;
@@ -469,6 +694,14 @@ public:
 
 	/* Arduino interrupt handler */
 	static void handleInterrupt();
+	static void handleEvents(uint32_t status);
+	static void queueEvents();
+	static void queueEvents(uint32_t status);
+	static void queueEvent(uint32_t status, byte timeRegister, uint16_t frameLength);
+	static void queueReceiveEvent(uint32_t status);
+	static void restartReceive();
+	static void resetReceiver();
+	static boolean isDoubleBuffered();
 	
 	/* Allow MAC frame filtering . */
 	// TODO auto-acknowledge
@@ -482,8 +715,6 @@ public:
 	//Reserved is used for the Blink message
 	static void setFrameFilterAllowReserved(boolean val);
 	
-	// note: not sure if going to be implemented for now
-	static void setDoubleBuffering(boolean val);
 	// TODO is implemented, but needs testing
 	static void useExtendedFrameLength(boolean val);
 	// TODO is implemented, but needs testing
@@ -528,6 +759,10 @@ public:
 	
 	/* timestamp correction. */
 	static void correctTimestamp(DW1000Time& timestamp);
+	static void correctTimestamp(DW1000Time& timestamp, float rxPower);
+	
+	/* power estimation (user manual 4.7.1 and 4.7.2). */
+	static float correctPower(float estimatedPower);
 	
 	/* reading and writing bytes from and to DW1000 module. */
 	static void readBytes(byte cmd, uint16_t offset, byte data[], uint16_t n);
@@ -535,6 +770,11 @@ public:
 	static void writeByte(byte cmd, uint16_t offset, byte data);
 	static void writeBytes(byte cmd, uint16_t offset, byte data[], uint16_t n);
 	
+	/* same as readBytes()/writeBytes(), skipped if the shadow copy is known to be up to date. */
+	static void readShadowedBytes(byte shadow, byte cmd, uint16_t offset, byte data[], uint16_t n);
+	static void writeShadowedBytes(byte shadow, byte cmd, uint16_t offset, byte data[], uint16_t n);
+	static void invalidateShadow();
+	
 	/* writing numeric values to bytes. */
 	static void writeValueToBytes(byte data[], int32_t val, uint16_t n);
 	
@@ -559,6 +799,9 @@ public:
 	static const SPISettings _fastSPI;
 	static const SPISettings _slowSPI;
 	static const SPISettings* _currentSPI;
+	static uint8_t            _spiHoldTime;
+	static uint32_t           _spiTransactions;
+	static uint32_t           _spiBytes;
 	
 	/* range bias tables (500/900 MHz band, 16/64 MHz PRF), -61 to -95 dBm. */
 	static const byte BIAS_500_16_ZERO = 10;
@@ -30,4 +30,49 @@
  */
 #define DW1000TIME_H_PRINTABLE true
 
+/**
+ * Time in microseconds chip select is kept low after the last byte of a SPI transaction
+ * The DW1000 itself only needs a few ns, the library used to wait 5us after every transfer
+ * Can also be changed at runtime, see DW1000Class::setSPIHoldTime()
+ */
+#ifndef DW1000_SPI_HOLD_TIME_US
+#define DW1000_SPI_HOLD_TIME_US 5
+#endif
+
+/**
+ * Size of the stack buffer used for block writes (header + payload)
+ * Longer writes are split into several transfers within the same transaction
+ * Minimum is 4 bytes (3 byte header + 1 byte payload)
+ */
+#ifndef DW1000_SPI_WRITE_CHUNK
+#define DW1000_SPI_WRITE_CHUNK 32
+#endif
+
+/**
+ * Number of device events the interrupt handler can latch until they are polled
+ * Only used with DW1000Class::useEventQueue(), must be a power of two (at most 128)
+ * Each event takes about 12 bytes of ram
+ */
+#ifndef DW1000_EVENT_QUEUE_SIZE
+#define DW1000_EVENT_QUEUE_SIZE 8
+#endif
+
+/**
+ * Measure the latencies of the ranging with micros(), see DW1000RangingClass::getLatency()
+ * Off by default, as it takes (4 per device + 3) * 80 bytes of ram, and 4 more per queued event
+ * for the time of its interrupt. Set it as a build flag to turn it on.
+ */
+#ifndef RANGING_LATENCY
+#define RANGING_LATENCY 0
+#endif
+
+/**
+ * Keep the six exchange timestamps of the devices of a DeviceManager as 40 bit values in a table
+ * of the manager, the layout of DeviceTable, instead of DW1000Time objects in each device.
+ * Saves about 30 bytes per device on an AVR, for anchors serving many tags.
+ */
+#ifndef DEVICE_TABLE
+#define DEVICE_TABLE 0
+#endif
+
 #endif // DW1000COMPILEOPTIONS_H
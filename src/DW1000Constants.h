@@ -75,6 +75,7 @@
 #define WAIT4RESP_BIT 7
 #define RXENAB_BIT 8
 #define RXDLYS_BIT 9
+#define HRBPT_BIT 24
 
 // system event status register
 #define SYS_STATUS 0x0F
@@ -94,6 +95,9 @@
 #define RXRFTO_BIT 17
 #define RXPTO_BIT 21
 #define RXSFDTO_BIT 26
+#define RXOVRR_BIT 20
+#define HSRBP_BIT 30
+#define ICRBP_BIT 31
 #define LDEERR_BIT 18
 #define RFPLL_LL_BIT 24
 #define CLKPLL_LL_BIT 25
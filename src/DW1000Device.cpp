@@ -18,10 +18,33 @@ DW1000Device::DW1000Device(byte deviceAddress[], boolean shortOne)
 }
 
 DW1000Device::DW1000Device(byte deviceAddress[], byte shortAddress[]) {
-    setAddress(deviceAddress);
-    setShortAddress(shortAddress);
-	noteActivity();
-	_expectedMsgId = 0;  // or 0, depending on your protocol
+    init(deviceAddress, shortAddress);
+}
+
+void DW1000Device::init(const byte deviceAddress[], const byte shortAddress[]) {
+    // everything a device learns while ranging starts over, the address may be unknown (all zeros)
+    if (deviceAddress != nullptr) {
+        memcpy(_ownAddress, deviceAddress, 8);
+    } else {
+        memset(_ownAddress, 0, 8);
+    }
+    memcpy(_shortAddress, shortAddress, 2);
+    _active = true;
+    _replyDelayTimeUS = 0;
+    _range = 0;
+    _RXPower = 0;
+    _FPPower = 0;
+    _quality = 0;
+    _expectedMsgId = 0;
+    setTagState(TAG_STATE_IDLE);
+    _pollTime = 0;
+    _sequenceNumber = 0;
+    _rangeTracker.reset();
+    _linkQuality.reset();
+#if RANGING_LATENCY
+    _latency.reset();
+#endif
+    noteActivity();
 }
 
 DW1000Device::~DW1000Device() {noteActivity();}
@@ -103,11 +126,11 @@ void DW1000Device::setReplyDelayTime(uint16_t time) {
     _replyDelayTimeUS = time;
 }
 
-void DW1000Device::setIndex(int8_t index) {
+void DW1000Device::setIndex(int16_t index) {
     _index = index;
 }
 
-int8_t DW1000Device::getIndex() {
+int16_t DW1000Device::getIndex() {
     return _index;
 }
 
@@ -122,7 +145,8 @@ void DW1000Device::noteActivity() {
 }
 
 bool DW1000Device::isInactive() {
-    return (millis() - _activity > INACTIVITY_TIME);
+    // in 32 bits like millis() on the boards, also where unsigned long is longer
+    return ((uint32_t)(millis() - _activity) > INACTIVITY_TIME);
 }
 
 void DW1000Device::setExpectedMsgId(uint8_t msgId) {
@@ -142,6 +166,68 @@ TagState DW1000Device::getTagState() const {
     return _tagState;
 }
 
+void DW1000Device::setPollTime(uint32_t time) {
+    _pollTime = time;
+}
+
+uint32_t DW1000Device::getPollTime() const {
+    return _pollTime;
+}
+
+DW1000Time DW1000Device::getTimestamp(DeviceTimestamp which) const {
+#if DEVICE_TABLE
+    DW1000Time time;
+    if (_timestamps != nullptr) {
+        time.setTimestamp(_timestamps[which]);
+    }
+    return time;
+#else
+    return _timestamps[which];
+#endif
+}
+
+void DW1000Device::getTimestamp(DeviceTimestamp which, byte data[]) const {
+#if DEVICE_TABLE
+    if (_timestamps != nullptr) {
+        memcpy(data, _timestamps[which], DW1000Time::LENGTH_TIMESTAMP);
+    } else {
+        memset(data, 0, DW1000Time::LENGTH_TIMESTAMP);
+    }
+#else
+    _timestamps[which].getTimestamp(data);
+#endif
+}
+
+void DW1000Device::setTimestamp(DeviceTimestamp which, const DW1000Time& time) {
+#if DEVICE_TABLE
+    if (_timestamps != nullptr) {
+        time.getTimestamp(_timestamps[which]);
+    }
+#else
+    _timestamps[which] = time;
+#endif
+}
+
+void DW1000Device::setTimestamp(DeviceTimestamp which, const byte data[]) {
+#if DEVICE_TABLE
+    if (_timestamps != nullptr) {
+        memcpy(_timestamps[which], data, DW1000Time::LENGTH_TIMESTAMP);
+    }
+#else
+    _timestamps[which].setTimestamp(data);
+#endif
+}
+
+#if DEVICE_TABLE
+void DW1000Device::setTimestampRow(byte (*row)[DW1000Time::LENGTH_TIMESTAMP]) {
+    _timestamps = row;
+}
+#endif
+
+uint8_t DW1000Device::nextSequenceNumber() {
+    return _sequenceNumber++;
+}
+
 void DW1000Device::setActive() {
     _active = true;
     noteActivity(); // also refresh timestamp
@@ -159,3 +245,21 @@ unsigned long DW1000Device::getLastActivity() const {
     return _activity;
 }
 
+DW1000RangeTracker& DW1000Device::getRangeTracker() {
+    return _rangeTracker;
+}
+
+DW1000LinkQuality& DW1000Device::getLinkQuality() {
+    return _linkQuality;
+}
+
+#if RANGING_LATENCY
+DW1000Latency& DW1000Device::getLatency() {
+    return _latency;
+}
+#endif
+
+unsigned long DW1000Device::getLastStateChange() const {
+    return _lastStateChange;
+}
+
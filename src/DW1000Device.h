@@ -2,9 +2,14 @@
 #define _DW1000Device_H_INCLUDED
 
 #include "DW1000Time.h"
+#include "DW1000RangeTracker.h"
+#include "DW1000Latency.h"
+#include "DW1000LinkQuality.h"
 
 // Inactivity timeout in ms
 #define INACTIVITY_TIME 2000
+// Time in ms after which a device stuck in TAG_STATE_RANGING is set back to idle
+#define RANGING_TIMEOUT 500
 
 enum TagState
 {
@@ -12,6 +17,18 @@ enum TagState
 	TAG_STATE_RANGING
 };
 
+// The timestamps of an exchange, as kept per device
+enum DeviceTimestamp : uint8_t
+{
+	TIMESTAMP_POLL_SENT,
+	TIMESTAMP_POLL_RECEIVED,
+	TIMESTAMP_POLL_ACK_SENT,
+	TIMESTAMP_POLL_ACK_RECEIVED,
+	TIMESTAMP_RANGE_SENT,
+	TIMESTAMP_RANGE_RECEIVED,
+	TIMESTAMP_COUNT
+};
+
 class DW1000Device
 {
 public:
@@ -19,6 +36,8 @@ public:
 	DW1000Device(byte address[], boolean shortOne = false);
 	DW1000Device(byte address[], byte shortAddress[]);
 	~DW1000Device();
+	// Sets the device up as a new one without constructing it, e.g. in a slot of the DeviceManager
+	void init(const byte address[], const byte shortAddress[]);
 
 	// Setters
 	void setReplyTime(uint16_t replyDelayTimeUs);
@@ -30,17 +49,20 @@ public:
 	void setFPPower(float power);
 	void setQuality(float quality);
 	void setReplyDelayTime(uint16_t time);
-	void setIndex(int8_t index);
+	void setIndex(int16_t index);
 	void setExpectedMsgId(uint8_t msgId);
 	void setTagState(TagState state);
 	void noteActivity();
+	void setPollTime(uint32_t time);
+	// Sequence number of the next frame sent to the device, the broadcasts are numbered apart
+	uint8_t nextSequenceNumber();
 
 	// Getters
 	uint16_t getReplyTime();
 	byte *getByteAddress();
 	byte *getByteShortAddress();
 	uint16_t getShortAddress();
-	int8_t getIndex();
+	int16_t getIndex();
 	float getRange();
 	float getRXPower();
 	float getFPPower();
@@ -50,16 +72,27 @@ public:
 	bool isInactive();
 	uint8_t getExpectedMsgId() const;
 	TagState getTagState() const;
+	uint32_t getPollTime() const;
 
-	// Timestamps
-	DW1000Time timePollSent;
-	DW1000Time timePollReceived;
-	DW1000Time timePollAckSent;
-	DW1000Time timePollAckReceived;
-	DW1000Time timeRangeSent;
-	DW1000Time timeRangeReceived;
+	// Timestamps of the exchange, also as the 5 bytes of a frame
+	DW1000Time getTimestamp(DeviceTimestamp which) const;
+	void getTimestamp(DeviceTimestamp which, byte data[]) const;
+	void setTimestamp(DeviceTimestamp which, const DW1000Time& time);
+	void setTimestamp(DeviceTimestamp which, const byte data[]);
+#if DEVICE_TABLE
+	// Where the timestamps are kept, set by the DeviceManager. A device without keeps none.
+	void setTimestampRow(byte (*row)[DW1000Time::LENGTH_TIMESTAMP]);
+#endif
 
 	unsigned long getLastActivity() const;
+	// Filtered range, rate and variance, when the range filter is used
+	DW1000RangeTracker& getRangeTracker();
+	// Frames received, lost and duplicated, by their sequence numbers
+	DW1000LinkQuality& getLinkQuality();
+#if RANGING_LATENCY
+	DW1000Latency& getLatency();
+#endif
+	unsigned long getLastStateChange() const;
 
 	void setActive();
 	void setInactive();
@@ -73,7 +106,7 @@ private:
 	byte _shortAddress[2];
 	int32_t _activity;
 	uint16_t _replyDelayTimeUS;
-	int8_t _index;
+	int16_t _index;
 
 	int16_t _range;
 	int16_t _RXPower;
@@ -83,6 +116,19 @@ private:
 	uint8_t _expectedMsgId;
 	TagState _tagState;
 	uint32_t _lastStateChange;
+	// micros() of the last POLL sent to this device (tag side)
+	uint32_t _pollTime = 0;
+	uint8_t _sequenceNumber = 0;
+#if DEVICE_TABLE
+	byte (*_timestamps)[DW1000Time::LENGTH_TIMESTAMP] = nullptr;
+#else
+	DW1000Time _timestamps[TIMESTAMP_COUNT];
+#endif
+	DW1000RangeTracker _rangeTracker;
+	DW1000LinkQuality _linkQuality;
+#if RANGING_LATENCY
+	DW1000Latency _latency;
+#endif
 };
 
 #endif
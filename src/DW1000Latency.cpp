@@ -0,0 +1,138 @@
+#include "DW1000Latency.h"
+
+// message numbers of DW1000Ranging.h
+static const uint8_t MESSAGE_POLL = 0;
+static const uint8_t MESSAGE_RANGE_REPORT = 3;
+static const uint8_t MESSAGE_NONE = 0xFF;
+
+static void writeValue(Print& out, uint32_t value, uint8_t length) {
+	for (uint8_t i = 0; i < length; i++) {
+		out.write((uint8_t)value);
+		value >>= 8;
+	}
+}
+
+DW1000Histogram::DW1000Histogram() {
+	reset();
+}
+
+void DW1000Histogram::reset() {
+	memset(_buckets, 0, sizeof(_buckets));
+	_count = 0;
+	_min = UINT32_MAX;
+	_max = 0;
+	_sum = 0;
+}
+
+uint8_t DW1000Histogram::getBucket(uint32_t duration) {
+	if (duration < 2)
+		return duration;
+	if (duration >= getBucketStart(LATENCY_BUCKETS - 1))
+		return LATENCY_BUCKETS - 1;
+	uint8_t power = 1;
+	while ((duration >> (power + 1)) != 0)
+		power++;
+	// the bit below the highest one picks the half
+	return 2 * power + ((duration >> (power - 1)) & 1);
+}
+
+uint32_t DW1000Histogram::getBucketStart(uint8_t bucket) {
+	if (bucket < 2)
+		return bucket;
+	uint8_t power = bucket / 2;
+	return ((uint32_t)1 << power) + (bucket & 1) * ((uint32_t)1 << (power - 1));
+}
+
+void DW1000Histogram::add(uint32_t duration) {
+	uint8_t bucket = getBucket(duration);
+	if (_count == UINT16_MAX || _sum > UINT32_MAX - duration) {
+		_count = 0;
+		for (uint8_t i = 0; i < LATENCY_BUCKETS; i++) {
+			_buckets[i] /= 2;
+			_count += _buckets[i];
+		}
+		_sum /= 2;
+	}
+	_buckets[bucket]++;
+	_count++;
+	_sum += duration;
+	if (duration < _min)
+		_min = duration;
+	if (duration > _max)
+		_max = duration;
+}
+
+uint16_t DW1000Histogram::getCount() const {
+	return _count;
+}
+
+uint32_t DW1000Histogram::getMin() const {
+	return _count > 0 ? _min : 0;
+}
+
+uint32_t DW1000Histogram::getMax() const {
+	return _max;
+}
+
+uint32_t DW1000Histogram::getMean() const {
+	return _count > 0 ? _sum / _count : 0;
+}
+
+uint16_t DW1000Histogram::getBucketCount(uint8_t bucket) const {
+	return bucket < LATENCY_BUCKETS ? _buckets[bucket] : 0;
+}
+
+uint32_t DW1000Histogram::getPercentile(uint8_t percent) const {
+	uint32_t wanted = ((uint32_t)_count * percent + 99) / 100;
+	uint32_t counted = 0;
+	for (uint8_t i = 0; i < LATENCY_BUCKETS; i++) {
+		counted += _buckets[i];
+		if (counted >= wanted && counted > 0) {
+			// the end of the bucket, but not beyond what was seen
+			uint32_t end = i + 1 < LATENCY_BUCKETS ? getBucketStart(i + 1) - 1 : _max;
+			return end < _max ? end : _max;
+		}
+	}
+	return 0;
+}
+
+size_t DW1000Histogram::writeTo(Print& out) const {
+	writeValue(out, _count, 2);
+	writeValue(out, getMin(), 4);
+	writeValue(out, _max, 4);
+	writeValue(out, _sum, 4);
+	for (uint8_t i = 0; i < LATENCY_BUCKETS; i++)
+		writeValue(out, _buckets[i], 2);
+	return 14 + 2 * LATENCY_BUCKETS;
+}
+
+DW1000Latency::DW1000Latency() {
+	reset();
+}
+
+void DW1000Latency::reset() {
+	for (uint8_t i = 0; i < LATENCY_PHASES; i++)
+		_phases[i].reset();
+	_pollTime = 0;
+	_lastTime = 0;
+	_lastMessage = MESSAGE_NONE;
+}
+
+void DW1000Latency::probe(uint8_t message, uint32_t time) {
+	if (message > MESSAGE_RANGE_REPORT)
+		return;
+	if (message == MESSAGE_POLL) {
+		_pollTime = time;
+	} else if (_lastMessage == message - 1) {
+		// a phase counts only if the one before it was seen, a lost frame ends the exchange
+		_phases[message - 1].add(time - _lastTime);
+		if (message == MESSAGE_RANGE_REPORT)
+			_phases[LATENCY_EXCHANGE].add(time - _pollTime);
+	}
+	_lastMessage = message;
+	_lastTime = time;
+}
+
+const DW1000Histogram& DW1000Latency::getHistogram(LatencyPhase phase) const {
+	return _phases[phase < LATENCY_PHASES ? phase : LATENCY_EXCHANGE];
+}
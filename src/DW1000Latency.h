@@ -0,0 +1,80 @@
+#ifndef _DW1000Latency_H_INCLUDED
+#define _DW1000Latency_H_INCLUDED
+
+#include <Arduino.h>
+#include "DW1000CompileOptions.h" // RANGING_LATENCY
+
+// Two buckets per power of two from 1 µs, the last one from 49152 µs on
+#define LATENCY_BUCKETS 32
+
+// Of the DW1000RangingClass
+enum LatencyProbe : uint8_t {
+	LATENCY_TRANSMIT = 0, // from starting a transmission to its interrupt, includes the delay of a reply
+	LATENCY_QUEUE,        // from the interrupt of a received frame to handling it in loop()
+	LATENCY_DISPATCH,     // handling a received frame, including the replies and the callbacks
+	LATENCY_PROBES
+};
+
+// Of the exchange with one device, from the interrupt of the frame before to the one of the frame
+enum LatencyPhase : uint8_t {
+	LATENCY_POLL_ACK = 0, // POLL to POLL_ACK
+	LATENCY_RANGE,        // POLL_ACK to RANGE
+	LATENCY_RANGE_REPORT, // RANGE to RANGE_REPORT
+	LATENCY_EXCHANGE,     // POLL to RANGE_REPORT
+	LATENCY_PHASES
+};
+
+// Histogram of durations in µs with fixed buckets, exact minimum, maximum and mean. Once the count
+// or the sum is full, both and the buckets are halved so the recent durations keep their weight.
+class DW1000Histogram
+{
+public:
+	DW1000Histogram();
+
+	void reset();
+	void add(uint32_t duration);
+
+	uint16_t getCount() const;
+	uint32_t getMin() const;
+	uint32_t getMax() const;
+	uint32_t getMean() const;
+	uint16_t getBucketCount(uint8_t bucket) const;
+	// Up to which duration the given share of the durations (0 to 100 %) is, to a bucket
+	uint32_t getPercentile(uint8_t percent) const;
+
+	static uint8_t getBucket(uint32_t duration);
+	// Shortest duration of a bucket
+	static uint32_t getBucketStart(uint8_t bucket);
+
+	// Little endian: count (2 bytes), minimum, maximum and sum (4 bytes each) and the counts of the
+	// buckets (2 bytes each), 78 bytes
+	size_t writeTo(Print& out) const;
+
+private:
+	uint16_t _buckets[LATENCY_BUCKETS];
+	uint16_t _count;
+	uint32_t _min;
+	uint32_t _max;
+	uint32_t _sum;
+};
+
+// Phases of the exchanges with one device
+class DW1000Latency
+{
+public:
+	DW1000Latency();
+
+	void reset();
+	// At the interrupt of a POLL, POLL_ACK, RANGE or RANGE_REPORT (numbered as in DW1000Ranging.h)
+	// sent to or received from the device
+	void probe(uint8_t message, uint32_t time);
+	const DW1000Histogram& getHistogram(LatencyPhase phase) const;
+
+private:
+	DW1000Histogram _phases[LATENCY_PHASES];
+	uint32_t _pollTime;
+	uint32_t _lastTime;
+	uint8_t  _lastMessage;
+};
+
+#endif
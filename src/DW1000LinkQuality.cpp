@@ -0,0 +1,76 @@
+#include "DW1000LinkQuality.h"
+
+DW1000LinkQuality::DW1000LinkQuality() {
+	reset();
+}
+
+void DW1000LinkQuality::reset() {
+	memset(_windows, 0, sizeof(_windows));
+	_received = 0;
+	_lost = 0;
+	_duplicates = 0;
+}
+
+bool DW1000LinkQuality::receive(uint8_t sequenceNumber, uint32_t time, bool broadcast) {
+	Window& window = _windows[broadcast ? 1 : 0];
+	uint8_t ahead = sequenceNumber - window.last;
+	if (window.span == 0 || ((ahead == 0 || ahead >= 128) && time - window.time > LINK_DUPLICATE_TIME)) {
+		window.bits = 1;
+		window.span = 1;
+		window.last = sequenceNumber;
+		window.time = time;
+		_received++;
+		return true;
+	}
+	if (ahead == 0) {
+		_duplicates++;
+		return false;
+	}
+	if (ahead < 128) {
+		// the numbers skipped are lost, unless they come late
+		_lost += ahead - 1;
+		window.bits = ahead < LINK_WINDOW ? (window.bits << ahead) | 1 : 1;
+		window.span = window.span + ahead < LINK_WINDOW ? window.span + ahead : LINK_WINDOW;
+		window.last = sequenceNumber;
+		window.time = time;
+		_received++;
+		return true;
+	}
+	uint8_t behind = -ahead;
+	if (behind >= window.span || (window.bits & ((uint32_t)1 << behind))) {
+		// seen, or too old to tell
+		_duplicates++;
+		return false;
+	}
+	window.bits |= (uint32_t)1 << behind;
+	_lost--;
+	_received++;
+	return true;
+}
+
+uint32_t DW1000LinkQuality::getReceivedCount() const {
+	return _received;
+}
+
+uint32_t DW1000LinkQuality::getLostCount() const {
+	return _lost;
+}
+
+uint32_t DW1000LinkQuality::getDuplicateCount() const {
+	return _duplicates;
+}
+
+uint8_t DW1000LinkQuality::countHeard(const Window& window) {
+	uint8_t heard = 0;
+	for (uint32_t bits = window.bits; bits != 0; bits &= bits - 1)
+		heard++;
+	return heard;
+}
+
+uint8_t DW1000LinkQuality::getPacketErrorRate() const {
+	uint16_t span = _windows[0].span + _windows[1].span;
+	if (span == 0)
+		return 0;
+	uint16_t lost = span - countHeard(_windows[0]) - countHeard(_windows[1]);
+	return lost * 100 / span;
+}
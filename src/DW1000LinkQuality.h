@@ -0,0 +1,50 @@
+#ifndef _DW1000LinkQuality_H_INCLUDED
+#define _DW1000LinkQuality_H_INCLUDED
+
+#include <Arduino.h>
+
+// Sequence numbers behind the newest one that are remembered, for duplicates and late frames
+#define LINK_WINDOW 32
+// Time in µs after which a frame behind the newest one starts the tracking over (the device was
+// reset or more than 127 frames were lost) instead of being dropped
+#define LINK_DUPLICATE_TIME 50000
+
+// Sequence numbers of the frames heard from one device. A device numbers its frames to each device
+// and its broadcasts apart, so the gaps in each are the frames lost on the link, whether the frames
+// to other devices are heard or dropped by the frame filter. Duplicates are recognised within the
+// window.
+class DW1000LinkQuality
+{
+public:
+	DW1000LinkQuality();
+
+	void reset();
+	// Notes the sequence number of a frame received at time (micros()), false if it is a duplicate
+	bool receive(uint8_t sequenceNumber, uint32_t time, bool broadcast);
+
+	uint32_t getReceivedCount() const;
+	uint32_t getLostCount() const;
+	uint32_t getDuplicateCount() const;
+	// Frames lost of the last LINK_WINDOW sequence numbers of both (fewer at the start), in percent
+	uint8_t getPacketErrorRate() const;
+
+private:
+	struct Window {
+		// bit i is the sequence number i behind last
+		uint32_t bits;
+		uint32_t time;
+		uint8_t last;
+		// sequence numbers covered, 0 before the first frame
+		uint8_t span;
+	};
+
+	// to this device and broadcast
+	Window _windows[2];
+	uint32_t _received;
+	uint32_t _lost;
+	uint32_t _duplicates;
+
+	static uint8_t countHeard(const Window& window);
+};
+
+#endif
@@ -43,14 +43,10 @@ void DW1000Mac::generateBlinkFrame(byte frame[], byte sourceAddress[], byte sour
 	//sequence number
 	*(frame+1) = _seqNumber;
 	//tag 64 bit ID (8 bytes address) -- reverse
-	byte sourceAddressReverse[8];
-	reverseArray(sourceAddressReverse, sourceAddress, 8);
-	memcpy(frame+2, sourceAddressReverse, 8);
+	reverseArray(frame+BlinkFrameView::SOURCE, sourceAddress, 8);
 	
 	//tag 2bytes address:
-	byte sourceShortAddressReverse[2];
-	reverseArray(sourceShortAddressReverse, sourceShortAddress, 2);
-	memcpy(frame+10, sourceShortAddressReverse, 2);
+	reverseArray(frame+BlinkFrameView::SOURCE_SHORT, sourceShortAddress, 2);
 	
 	//we increment seqNumber
 	incrementSeqNumber();
@@ -60,89 +56,172 @@ void DW1000Mac::generateBlinkFrame(byte frame[], byte sourceAddress[], byte sour
 //2 bytes for Desination Address and 2 bytes for Source Address
 //total=9 bytes
 void DW1000Mac::generateShortMACFrame(byte frame[], byte sourceShortAddress[], byte destinationShortAddress[]) {
+	generateShortMACFrame(frame, sourceShortAddress, destinationShortAddress, _seqNumber);
+	//we increment seqNumber
+	incrementSeqNumber();
+}
+
+void DW1000Mac::generateShortMACFrame(byte frame[], byte sourceShortAddress[], byte destinationShortAddress[], uint8_t sequenceNumber) {
 	//Frame controle
 	*frame     = FC_1;
 	*(frame+1) = FC_2_SHORT;
 	//sequence number (11.3) modulo 256
-	*(frame+2) = _seqNumber;
+	*(frame+2) = sequenceNumber;
 	//PAN ID
 	*(frame+3) = 0xCA;
 	*(frame+4) = 0xDE;
 	
 	
 	//destination address (2 bytes)
-	byte destinationShortAddressReverse[2];
-	reverseArray(destinationShortAddressReverse, destinationShortAddress, 2);
-	memcpy(frame+5, destinationShortAddressReverse, 2);
+	reverseArray(frame+ShortMacFrameView::DESTINATION, destinationShortAddress, 2);
 	
 	//source address (2 bytes)
-	byte sourceShortAddressReverse[2];
-	reverseArray(sourceShortAddressReverse, sourceShortAddress, 2);
-	memcpy(frame+7, sourceShortAddressReverse, 2);
-	
-	
-	//we increment seqNumber
-	incrementSeqNumber();
+	reverseArray(frame+ShortMacFrameView::SOURCE, sourceShortAddress, 2);
 }
 
 //the long frame for Ranging init
 //8 bytes for Destination Address and 2 bytes for Source Address
 //total=15
 void DW1000Mac::generateLongMACFrame(byte frame[], byte sourceShortAddress[], byte destinationAddress[]) {
+	generateLongMACFrame(frame, sourceShortAddress, destinationAddress, _seqNumber);
+	//we increment seqNumber
+	incrementSeqNumber();
+}
+
+void DW1000Mac::generateLongMACFrame(byte frame[], byte sourceShortAddress[], byte destinationAddress[], uint8_t sequenceNumber) {
 	//Frame controle
 	*frame     = FC_1;
 	*(frame+1) = FC_2;
 	//sequence number
-	*(frame+2) = _seqNumber;
+	*(frame+2) = sequenceNumber;
 	//PAN ID (0xDECA)
 	*(frame+3) = 0xCA;
 	*(frame+4) = 0xDE;
 	
 	//destination address (8 bytes) - we need to reverse the byte array
-	byte destinationAddressReverse[8];
-	reverseArray(destinationAddressReverse, destinationAddress, 8);
-	memcpy(frame+5, destinationAddressReverse, 8);
+	reverseArray(frame+LongMacFrameView::DESTINATION, destinationAddress, 8);
 	
 	//source address (2 bytes)
-	byte sourceShortAddressReverse[2];
-	reverseArray(sourceShortAddressReverse, sourceShortAddress, 2);
-	memcpy(frame+13, sourceShortAddressReverse, 2);
-	
-	//we increment seqNumber
-	incrementSeqNumber();
+	reverseArray(frame+LongMacFrameView::SOURCE, sourceShortAddress, 2);
 }
 
 
 void DW1000Mac::decodeBlinkFrame(byte frame[], byte address[], byte shortAddress[]) {
 	//we save the long address of the sender into the device. -- reverse direction
-	byte reverseAddress[8];
-	memcpy(reverseAddress, frame+2, 8);
-	reverseArray(address, reverseAddress, 8);
-	
-	byte reverseShortAddress[2];
-	memcpy(reverseShortAddress, frame+10, 2);
-	reverseArray(shortAddress, reverseShortAddress, 2);
+	reverseArray(address, frame+BlinkFrameView::SOURCE, 8);
+	reverseArray(shortAddress, frame+BlinkFrameView::SOURCE_SHORT, 2);
 }
 
 void DW1000Mac::decodeShortMACFrame(byte frame[], byte address[]) {
-	byte reverseAddress[2];
-	memcpy(reverseAddress, frame+7, 2);
-	reverseArray(address, reverseAddress, 2);
+	reverseArray(address, frame+ShortMacFrameView::SOURCE, 2);
 	//we grab the destination address for the mac frame
 	//byte destinationAddress[2];
 	//memcpy(destinationAddress, frame+5, 2);
 }
 
 void DW1000Mac::decodeLongMACFrame(byte frame[], byte address[]) {
-	byte reverseAddress[2];
-	memcpy(reverseAddress, frame+13, 2);
-	reverseArray(address, reverseAddress, 2);
+	reverseArray(address, frame+LongMacFrameView::SOURCE, 2);
 	//we grab the destination address for the mac frame
 	//byte destinationAddress[8];
 	//memcpy(destinationAddress, frame+5, 8);
 }
 
 
+//of the addressing modes: none, reserved, short and long
+static const uint8_t addressLengths[4] = {0, 0, 2, 8};
+
+//the source PAN ID is only there if it can't be the destination one
+static bool hasSourcePan(const MacHeader& header) {
+	return header.sourceMode != MAC_ADDRESS_NONE && !(header.panIdCompression && header.destinationMode != MAC_ADDRESS_NONE);
+}
+
+static uint8_t writeAddress(byte frame[], uint64_t address, uint8_t length) {
+	for(uint8_t i = 0; i < length; i++) {
+		frame[i] = (byte)(address >> (8*(length-i-1)));
+	}
+	return length;
+}
+
+uint8_t DW1000Mac::getHeaderLength(const MacHeader& header) {
+	uint8_t length = 3+addressLengths[header.destinationMode & 0x03]+addressLengths[header.sourceMode & 0x03];
+	if(header.destinationMode != MAC_ADDRESS_NONE)
+		length += 2;
+	if(hasSourcePan(header))
+		length += 2;
+	return length;
+}
+
+uint8_t DW1000Mac::encodeHeader(const MacHeader& header, byte frame[]) {
+	uint16_t control = (header.frameType & 0x07) | (header.framePending << 4) | (header.ackRequest << 5) |
+	                   (header.panIdCompression << 6) | ((header.destinationMode & 0x03) << 10) |
+	                   ((header.frameVersion & 0x03) << 12) | ((header.sourceMode & 0x03) << 14);
+	frame[0] = (byte)control;
+	frame[1] = (byte)(control >> 8);
+	frame[2] = header.sequenceNumber;
+	uint8_t offset = 3;
+	if(header.destinationMode != MAC_ADDRESS_NONE) {
+		frame[offset]   = (byte)header.destinationPan;
+		frame[offset+1] = (byte)(header.destinationPan >> 8);
+		offset += 2;
+		offset += writeAddress(frame+offset, header.destination, addressLengths[header.destinationMode & 0x03]);
+	}
+	if(hasSourcePan(header)) {
+		frame[offset]   = (byte)header.sourcePan;
+		frame[offset+1] = (byte)(header.sourcePan >> 8);
+		offset += 2;
+	}
+	return offset+writeAddress(frame+offset, header.source, addressLengths[header.sourceMode & 0x03]);
+}
+
+uint8_t DW1000Mac::decodeHeader(const byte frame[], uint16_t length, MacHeader& header) {
+	if(length < 3)
+		return 0;
+	uint16_t control = frame[0] | ((uint16_t)frame[1] << 8);
+	uint8_t destinationMode = (control >> 10) & 0x03;
+	uint8_t sourceMode      = (control >> 14) & 0x03;
+	//security (bit 3), reserved types and modes and the other PAN ID rules of version 2
+	if((control & 0x0008) || (control & 0x07) > MAC_FRAME_COMMAND || (control & 0x2000) ||
+	   destinationMode == 1 || sourceMode == 1)
+		return 0;
+	header.frameType        = control & 0x07;
+	header.framePending     = control & 0x0010;
+	header.ackRequest       = control & 0x0020;
+	header.panIdCompression = control & 0x0040;
+	header.destinationMode  = destinationMode;
+	header.frameVersion     = (control >> 12) & 0x03;
+	header.sourceMode       = sourceMode;
+	uint8_t headerLength = getHeaderLength(header);
+	if(length < headerLength)
+		return 0;
+	header.sequenceNumber = frame[2];
+	const byte* field = frame+3;
+	header.destinationPan = MAC_BROADCAST;
+	header.destination = 0;
+	if(destinationMode != MAC_ADDRESS_NONE) {
+		header.destinationPan = field[0] | ((uint16_t)field[1] << 8);
+		field += 2;
+		if(destinationMode == MAC_ADDRESS_SHORT) {
+			header.destination = readFrameAddress16(field);
+			field += 2;
+		} else {
+			header.destination = readFrameAddress64(field);
+			field += 8;
+		}
+	}
+	header.sourcePan = header.destinationPan;
+	if(hasSourcePan(header)) {
+		header.sourcePan = field[0] | ((uint16_t)field[1] << 8);
+		field += 2;
+	}
+	if(sourceMode == MAC_ADDRESS_SHORT)
+		header.source = readFrameAddress16(field);
+	else if(sourceMode == MAC_ADDRESS_LONG)
+		header.source = readFrameAddress64(field);
+	else
+		header.source = 0;
+	return headerLength;
+}
+
 void DW1000Mac::incrementSeqNumber() {
 	// normally overflow of uint8 automatically resets to 0 if over 255
 	// but if-clause seems safer way
@@ -152,20 +231,16 @@ void DW1000Mac::incrementSeqNumber() {
 		_seqNumber++;
 }
 
-void DW1000Mac::reverseArray(byte to[], byte from[], int16_t size) {
+void DW1000Mac::reverseArray(byte to[], const byte from[], int16_t size) {
 	for(int16_t i = 0; i < size; i++) {
 		*(to+i) = *(from+size-i-1);
 	}
 }
 
 void DW1000Mac::getReceiverAddress(byte frame[], byte address[]) {
-	byte reverseAddress[2];
-	memcpy(reverseAddress, frame + 5, 2); // destination address is at offset 5
-	reverseArray(address, reverseAddress, 2);
+	reverseArray(address, frame+ShortMacFrameView::DESTINATION, 2);
 }
 
 void DW1000Mac::getSenderAddress(byte frame[], byte address[]) {
-	byte reverseAddress[2];
-	memcpy(reverseAddress, frame + 7, 2); // source address is at offset 7
-	reverseArray(address, reverseAddress, 2);
+	reverseArray(address, frame+ShortMacFrameView::SOURCE, 2);
 }
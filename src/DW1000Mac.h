@@ -40,8 +40,43 @@
 #include <Arduino.h>
 #include "DW1000Device.h" 
 
+// IEEE 802.15.4 frame types and addressing modes of the frame control
+#define MAC_FRAME_BEACON 0
+#define MAC_FRAME_DATA 1
+#define MAC_FRAME_ACK 2
+#define MAC_FRAME_COMMAND 3
+
+#define MAC_ADDRESS_NONE 0
+#define MAC_ADDRESS_SHORT 2
+#define MAC_ADDRESS_LONG 3
+
+#define MAC_BROADCAST 0xFFFF
+#define MAC_PAN_ID ((PAN_ID_2 << 8) | PAN_ID_1)
+// frame control, sequence number, two PAN IDs and two long addresses
+#define MAC_HEADER_MAX_LEN 23
+
 class DW1000Device;
 
+// Header of a beacon, data, ACK or command frame, as the frame control describes it. The PAN IDs are
+// little endian as in the standard, the addresses are numbers as in the views below: the library puts
+// them in the frame most significant byte first, the codec keeps that so it understands the devices
+// out there. The source PAN ID is left out of the frame with panIdCompression, if both addresses are
+// there, and decodeHeader() sets it to the destination PAN ID.
+struct MacHeader {
+	uint8_t  frameType = MAC_FRAME_DATA;
+	bool     framePending = false;
+	bool     ackRequest = false;
+	bool     panIdCompression = false;
+	uint8_t  destinationMode = MAC_ADDRESS_NONE;
+	uint8_t  sourceMode = MAC_ADDRESS_NONE;
+	uint8_t  frameVersion = 0;
+	uint8_t  sequenceNumber = 0;
+	uint16_t destinationPan = MAC_PAN_ID;
+	uint16_t sourcePan = MAC_PAN_ID;
+	uint64_t destination = 0;
+	uint64_t source = 0;
+};
+
 class DW1000Mac {
 public:
 	//Constructor and destructor
@@ -69,11 +104,14 @@ void getSenderAddress(byte frame[], byte address[]);
 	//2 bytes for Desination Address and 2 bytes for Source Address
 	//total=9 bytes
 	void generateShortMACFrame(byte frame[], byte sourceShortAddress[], byte destinationShortAddress[]);
+	//with the sequence number of the link to the destination instead of the next one of this device
+	void generateShortMACFrame(byte frame[], byte sourceShortAddress[], byte destinationShortAddress[], uint8_t sequenceNumber);
 	
 	//the long frame for Ranging init
 	//8 bytes for Destination Address and 2 bytes for Source Address
 	//total of
 	void generateLongMACFrame(byte frame[], byte sourceShortAddress[], byte destinationAddress[]);
+	void generateLongMACFrame(byte frame[], byte sourceShortAddress[], byte destinationAddress[], uint8_t sequenceNumber);
 	
 	//in order to decode the frame and save source Address!
 	void decodeBlinkFrame(byte frame[], byte address[], byte shortAddress[]);
@@ -81,13 +119,112 @@ void getSenderAddress(byte frame[], byte address[]);
 	void decodeLongMACFrame(byte frame[], byte address[]);
 	
 	void incrementSeqNumber();
+	
+	//the header codec, the generate and decode functions above are the fixed cases the ranging uses
+	//length of the header, the offset of the payload
+	static uint8_t getHeaderLength(const MacHeader& header);
+	//writes the header to the frame (up to MAC_HEADER_MAX_LEN bytes), returns its length
+	static uint8_t encodeHeader(const MacHeader& header, byte frame[]);
+	//returns the offset of the payload, 0 if the frame is shorter than its header, secured (no
+	//auxiliary security header is read), of a reserved type, addressing mode or of frame version 2
+	static uint8_t decodeHeader(const byte frame[], uint16_t length, MacHeader& header);
 
 
 private:
 	uint8_t _seqNumber = 0;
-	void reverseArray(byte to[], byte from[], int16_t size);
+	void reverseArray(byte to[], const byte from[], int16_t size);
 	
 };
 
+// The addresses are in the frames in reverse order of the address arrays of the library. As numbers,
+// byte 0 of an array is the low byte, as in DW1000Device::getShortAddress().
+inline uint16_t readFrameAddress16(const byte frame[]) {
+	return ((uint16_t)frame[0] << 8) | frame[1];
+}
+
+// spelled out, so compilers can make it a load and a byte swap
+inline uint64_t readFrameAddress64(const byte frame[]) {
+	return ((uint64_t)frame[0] << 56) | ((uint64_t)frame[1] << 48) | ((uint64_t)frame[2] << 40) | ((uint64_t)frame[3] << 32) |
+	       ((uint64_t)frame[4] << 24) | ((uint64_t)frame[5] << 16) | ((uint64_t)frame[6] << 8) | frame[7];
+}
+
+inline void writeShortAddress(byte shortAddress[], uint16_t address) {
+	shortAddress[0] = (byte)address;
+	shortAddress[1] = (byte)(address >> 8);
+}
+
+// Views of a frame in place, for reading a received one without copying it. matches() checks the
+// frame control and that the frame holds the header and, but for a blink, the function code.
+
+//short frame: frame control, sequence number, PAN ID, destination and source short address
+class ShortMacFrameView {
+public:
+	static constexpr uint8_t SEQUENCE_NUMBER = 2;
+	static constexpr uint8_t PAN_ID = 3;
+	static constexpr uint8_t DESTINATION = 5;
+	static constexpr uint8_t SOURCE = 7;
+	static constexpr uint8_t PAYLOAD = SHORT_MAC_LEN;
+
+	explicit ShortMacFrameView(const byte frame[]) : _frame(frame) {}
+	static bool matches(const byte frame[], uint16_t length) {
+		return length > PAYLOAD && frame[0] == FC_1 && frame[1] == FC_2_SHORT;
+	}
+
+	uint8_t getSequenceNumber() const { return _frame[SEQUENCE_NUMBER]; }
+	uint16_t getPanId() const { return _frame[PAN_ID] | ((uint16_t)_frame[PAN_ID+1] << 8); }
+	uint16_t getDestination() const { return readFrameAddress16(_frame+DESTINATION); }
+	uint16_t getSource() const { return readFrameAddress16(_frame+SOURCE); }
+	bool isBroadcast() const { return _frame[DESTINATION] == 0xFF && _frame[DESTINATION+1] == 0xFF; }
+	const byte* getPayload() const { return _frame+PAYLOAD; }
+
+private:
+	const byte* _frame;
+};
+
+//long frame: as the short one, but to the 8 byte address
+class LongMacFrameView {
+public:
+	static constexpr uint8_t SEQUENCE_NUMBER = 2;
+	static constexpr uint8_t PAN_ID = 3;
+	static constexpr uint8_t DESTINATION = 5;
+	static constexpr uint8_t SOURCE = 13;
+	static constexpr uint8_t PAYLOAD = LONG_MAC_LEN;
+
+	explicit LongMacFrameView(const byte frame[]) : _frame(frame) {}
+	static bool matches(const byte frame[], uint16_t length) {
+		return length > PAYLOAD && frame[0] == FC_1 && frame[1] == FC_2;
+	}
+
+	uint8_t getSequenceNumber() const { return _frame[SEQUENCE_NUMBER]; }
+	uint16_t getPanId() const { return _frame[PAN_ID] | ((uint16_t)_frame[PAN_ID+1] << 8); }
+	uint64_t getDestination() const { return readFrameAddress64(_frame+DESTINATION); }
+	uint16_t getSource() const { return readFrameAddress16(_frame+SOURCE); }
+	const byte* getPayload() const { return _frame+PAYLOAD; }
+
+private:
+	const byte* _frame;
+};
+
+//blink: frame control, sequence number, the 8 byte and the short address of the tag
+class BlinkFrameView {
+public:
+	static constexpr uint8_t SEQUENCE_NUMBER = 1;
+	static constexpr uint8_t SOURCE = 2;
+	static constexpr uint8_t SOURCE_SHORT = 10;
+	static constexpr uint8_t LENGTH = 12;
+
+	explicit BlinkFrameView(const byte frame[]) : _frame(frame) {}
+	static bool matches(const byte frame[], uint16_t length) {
+		return length >= LENGTH && frame[0] == FC_1_BLINK;
+	}
+
+	uint8_t getSequenceNumber() const { return _frame[SEQUENCE_NUMBER]; }
+	uint64_t getSource() const { return readFrameAddress64(_frame+SOURCE); }
+	uint16_t getSourceShort() const { return readFrameAddress16(_frame+SOURCE_SHORT); }
+
+private:
+	const byte* _frame;
+};
+
 
 #endif
@@ -0,0 +1,208 @@
+#include "DW1000Positioning.h"
+
+// inverse of a symmetric 2x2 or 3x3 matrix, false if it is (nearly) singular
+static bool invert(const float m[3][3], uint8_t dimensions, float inverse[3][3]) {
+	if (dimensions == 2) {
+		float det = m[0][0] * m[1][1] - m[0][1] * m[1][0];
+		if (!(det > 1e-5f * m[0][0] * m[1][1]))
+			return false;
+		inverse[0][0] = m[1][1] / det;
+		inverse[0][1] = -m[0][1] / det;
+		inverse[1][0] = -m[1][0] / det;
+		inverse[1][1] = m[0][0] / det;
+		return true;
+	}
+	float c[3][3];
+	c[0][0] = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+	c[0][1] = m[0][2] * m[2][1] - m[0][1] * m[2][2];
+	c[0][2] = m[0][1] * m[1][2] - m[0][2] * m[1][1];
+	c[1][0] = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+	c[1][1] = m[0][0] * m[2][2] - m[0][2] * m[2][0];
+	c[1][2] = m[0][2] * m[1][0] - m[0][0] * m[1][2];
+	c[2][0] = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+	c[2][1] = m[0][1] * m[2][0] - m[0][0] * m[2][1];
+	c[2][2] = m[0][0] * m[1][1] - m[0][1] * m[1][0];
+	float det = m[0][0] * c[0][0] + m[0][1] * c[1][0] + m[0][2] * c[2][0];
+	if (!(det > 1e-5f * m[0][0] * m[1][1] * m[2][2]))
+		return false;
+	for (uint8_t i = 0; i < 3; i++) {
+		for (uint8_t j = 0; j < 3; j++)
+			inverse[i][j] = c[i][j] / det;
+	}
+	return true;
+}
+
+DW1000Positioning::DW1000Positioning() {
+	_anchorCount = 0;
+	_dimensions = 2;
+	_height = 0;
+	memset(&_position, 0, sizeof(_position));
+}
+
+void DW1000Positioning::setDimensions(uint8_t dimensions, float height) {
+	_dimensions = dimensions == 3 ? 3 : 2;
+	_height = height;
+}
+
+int8_t DW1000Positioning::findAnchor(uint16_t shortAddress) const {
+	for (uint8_t i = 0; i < _anchorCount; i++) {
+		if (_anchors[i].shortAddress == shortAddress)
+			return i;
+	}
+	return -1;
+}
+
+bool DW1000Positioning::setAnchor(uint16_t shortAddress, float x, float y, float z) {
+	int8_t i = findAnchor(shortAddress);
+	if (i < 0) {
+		if (_anchorCount == POSITIONING_MAX_ANCHORS)
+			return false;
+		i = _anchorCount++;
+		_anchors[i].shortAddress = shortAddress;
+	}
+	_anchors[i].coordinates[0] = x;
+	_anchors[i].coordinates[1] = y;
+	_anchors[i].coordinates[2] = z;
+	_anchors[i].fresh = false;
+	return true;
+}
+
+void DW1000Positioning::removeAnchor(uint16_t shortAddress) {
+	int8_t i = findAnchor(shortAddress);
+	if (i < 0)
+		return;
+	_anchors[i] = _anchors[--_anchorCount];
+}
+
+uint8_t DW1000Positioning::getAnchorCount() const {
+	return _anchorCount;
+}
+
+DW1000Position* DW1000Positioning::getPosition() {
+	return &_position;
+}
+
+bool DW1000Positioning::addRange(uint16_t shortAddress, float range) {
+	int8_t i = findAnchor(shortAddress);
+	if (i < 0)
+		return false;
+	bool solved = false;
+	// ranged twice, the anchors that did not answer are left out
+	if (_anchors[i].fresh)
+		solved = solveRound();
+	_anchors[i].range = range;
+	_anchors[i].fresh = true;
+	for (uint8_t j = 0; j < _anchorCount; j++) {
+		if (!_anchors[j].fresh)
+			return solved;
+	}
+	return solveRound() || solved;
+}
+
+bool DW1000Positioning::solveRound() {
+	float anchors[POSITIONING_MAX_ANCHORS][3];
+	float ranges[POSITIONING_MAX_ANCHORS];
+	uint8_t count = 0;
+	for (uint8_t i = 0; i < _anchorCount; i++) {
+		if (!_anchors[i].fresh)
+			continue;
+		memcpy(anchors[count], _anchors[i].coordinates, sizeof(anchors[count]));
+		ranges[count++] = _anchors[i].range;
+		_anchors[i].fresh = false;
+	}
+	return solve(anchors, ranges, count, _position);
+}
+
+bool DW1000Positioning::estimate(const float anchors[][3], const float ranges[], uint8_t count, float position[3]) const {
+	// the differences of the squared ranges are linear in the position, relative to anchor 0
+	// to keep the numbers small. In 2D the ranges are reduced to the horizontal part.
+	float squares[POSITIONING_MAX_ANCHORS];
+	for (uint8_t i = 0; i < count; i++) {
+		squares[i] = ranges[i] * ranges[i];
+		if (_dimensions == 2) {
+			float dz = anchors[i][2] - _height;
+			squares[i] -= dz * dz;
+		}
+	}
+	float n[3][3] = {{0}}, g[3] = {0};
+	for (uint8_t i = 1; i < count; i++) {
+		float row[3], b = squares[0] - squares[i];
+		for (uint8_t j = 0; j < _dimensions; j++) {
+			row[j] = 2 * (anchors[i][j] - anchors[0][j]);
+			b += (anchors[i][j] - anchors[0][j]) * (anchors[i][j] - anchors[0][j]);
+		}
+		for (uint8_t j = 0; j < _dimensions; j++) {
+			for (uint8_t k = 0; k < _dimensions; k++)
+				n[j][k] += row[j] * row[k];
+			g[j] += row[j] * b;
+		}
+	}
+	float inverse[3][3];
+	if (!invert(n, _dimensions, inverse))
+		return false;
+	for (uint8_t j = 0; j < _dimensions; j++) {
+		position[j] = anchors[0][j];
+		for (uint8_t k = 0; k < _dimensions; k++)
+			position[j] += inverse[j][k] * g[k];
+	}
+	if (_dimensions == 2)
+		position[2] = _height;
+	return true;
+}
+
+bool DW1000Positioning::solve(const float anchors[][3], const float ranges[], uint8_t count, DW1000Position& result) const {
+	float position[3];
+	if (count < _dimensions + 1 || count > POSITIONING_MAX_ANCHORS || !estimate(anchors, ranges, count, position))
+		return false;
+
+	bool converged = false;
+	for (uint8_t iteration = 0; ; iteration++) {
+		// normal equations of the ranges linearized at the position
+		float n[3][3] = {{0}}, g[3] = {0}, squares = 0;
+		for (uint8_t i = 0; i < count; i++) {
+			float direction[3], distance = 0;
+			for (uint8_t j = 0; j < 3; j++) {
+				direction[j] = position[j] - anchors[i][j];
+				distance += direction[j] * direction[j];
+			}
+			distance = sqrt(distance);
+			float residual = ranges[i] - distance;
+			squares += residual * residual;
+			if (distance < 1e-6f)
+				continue;
+			for (uint8_t j = 0; j < _dimensions; j++)
+				direction[j] /= distance;
+			for (uint8_t j = 0; j < _dimensions; j++) {
+				for (uint8_t k = 0; k < _dimensions; k++)
+					n[j][k] += direction[j] * direction[k];
+				g[j] += direction[j] * residual;
+			}
+		}
+		float inverse[3][3];
+		if (!invert(n, _dimensions, inverse))
+			return false;
+
+		if (converged || iteration == POSITIONING_ITERATIONS) {
+			float trace = 0;
+			for (uint8_t j = 0; j < _dimensions; j++)
+				trace += inverse[j][j];
+			result.x = position[0];
+			result.y = position[1];
+			result.z = position[2];
+			result.residual = sqrt(squares / count);
+			result.gdop = sqrt(trace);
+			result.anchors = count;
+			return true;
+		}
+
+		float step = 0;
+		for (uint8_t j = 0; j < _dimensions; j++) {
+			float delta = 0;
+			for (uint8_t k = 0; k < _dimensions; k++)
+				delta += inverse[j][k] * g[k];
+			position[j] += delta;
+			step += delta * delta;
+		}
+		converged = step < POSITIONING_TOLERANCE * POSITIONING_TOLERANCE;
+	}
+}
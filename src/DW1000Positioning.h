@@ -0,0 +1,69 @@
+#ifndef _DW1000Positioning_H_INCLUDED
+#define _DW1000Positioning_H_INCLUDED
+
+#include <Arduino.h>
+
+// Anchors with known coordinates, set it as a build flag to change it
+#ifndef POSITIONING_MAX_ANCHORS
+  #define POSITIONING_MAX_ANCHORS 8
+#endif
+// Gauss-Newton steps after the linear estimate, and the step in m at which it stops early
+#define POSITIONING_ITERATIONS 8
+#define POSITIONING_TOLERANCE 0.0001f
+
+struct DW1000Position
+{
+	// in m, in the coordinates of the anchors
+	float x;
+	float y;
+	float z;
+	// rms of the differences between the ranges and the distances to the position, in m
+	float residual;
+	// geometric dilution of precision, the position error is about this times the range error
+	float gdop;
+	uint8_t anchors;
+};
+
+// Position of a tag from its ranges to anchors with known coordinates: a linear least squares
+// estimate refined by Gauss-Newton, in 2D (at a known height) or in 3D.
+class DW1000Positioning
+{
+public:
+	DW1000Positioning();
+
+	// 2 for x and y at the given height, or 3 for x, y and z
+	void setDimensions(uint8_t dimensions, float height = 0);
+	bool setAnchor(uint16_t shortAddress, float x, float y, float z);
+	void removeAnchor(uint16_t shortAddress);
+	uint8_t getAnchorCount() const;
+
+	// Range in m to an anchor, true if it completed a round of ranges and a new position was
+	// solved. A round ends when every anchor was ranged or one was ranged twice.
+	bool addRange(uint16_t shortAddress, float range);
+	DW1000Position* getPosition();
+
+	// Position from the ranges to the given anchors ({x, y, z} each), false if there are too
+	// few of them or they are in a line (2D) or a plane (3D)
+	bool solve(const float anchors[][3], const float ranges[], uint8_t count, DW1000Position& position) const;
+
+private:
+	struct Anchor
+	{
+		uint16_t shortAddress;
+		float coordinates[3];
+		float range;
+		bool fresh;
+	};
+
+	Anchor _anchors[POSITIONING_MAX_ANCHORS];
+	uint8_t _anchorCount;
+	uint8_t _dimensions;
+	float _height;
+	DW1000Position _position;
+
+	int8_t findAnchor(uint16_t shortAddress) const;
+	bool solveRound();
+	bool estimate(const float anchors[][3], const float ranges[], uint8_t count, float position[3]) const;
+};
+
+#endif
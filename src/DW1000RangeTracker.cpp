@@ -0,0 +1,146 @@
+#include "DW1000RangeTracker.h"
+
+uint16_t DW1000RangeTracker::_rangeNoise = 100;
+uint16_t DW1000RangeTracker::_acceleration = 1000;
+
+static int32_t saturate(int64_t value) {
+	if (value > INT32_MAX)
+		return INT32_MAX;
+	if (value < -INT32_MAX)
+		return -INT32_MAX;
+	return (int32_t)value;
+}
+
+static int64_t magnitude(int64_t value) {
+	return value < 0 ? -value : value;
+}
+
+DW1000RangeTracker::DW1000RangeTracker() {
+	reset();
+}
+
+void DW1000RangeTracker::setNoise(uint16_t rangeNoise, uint16_t acceleration) {
+	_rangeNoise = rangeNoise > 0 ? rangeNoise : 1;
+	_acceleration = acceleration;
+}
+
+void DW1000RangeTracker::reset() {
+	_range = 0;
+	_rate = 0;
+	_p00 = 0;
+	_p01 = 0;
+	_p11 = 0;
+	_time = 0;
+	_rejected = 0;
+	_tracking = false;
+	_scale = 256;
+}
+
+void DW1000RangeTracker::start(int32_t range, uint32_t time) {
+	_range = range;
+	_rate = 0;
+	_p00 = (int32_t)_rangeNoise * _rangeNoise;
+	_p01 = 0;
+	_p11 = (int32_t)RANGE_TRACKER_INITIAL_RATE * RANGE_TRACKER_INITIAL_RATE;
+	_time = time;
+	_rejected = 0;
+	_tracking = true;
+}
+
+void DW1000RangeTracker::predict(uint32_t elapsed) {
+	// in 1/1024 s, so scaling to seconds is a shift
+	int32_t dt = (int32_t)((elapsed * 128 + 62) / 125);
+	_range = saturate(_range + (((int64_t)_rate * dt) >> 10));
+
+	// white acceleration noise, q11 = (a dt)², q01 = q11 dt / 2, q00 = q11 dt² / 4
+	int64_t q11 = ((int64_t)_acceleration * dt) >> 10;
+	q11 *= q11;
+	q11 = (q11 * _scale) >> 8;
+	int64_t q01 = (q11 * dt) >> 11;
+	int64_t q00 = (q01 * dt) >> 11;
+
+	int64_t p11dt = ((int64_t)_p11 * dt) >> 10;
+	_p00 = saturate(_p00 + ((2 * (int64_t)_p01 * dt) >> 10) + ((p11dt * dt) >> 10) + q00);
+	_p01 = saturate(_p01 + p11dt + q01);
+	_p11 = saturate(_p11 + q11);
+}
+
+bool DW1000RangeTracker::update(int32_t range, uint32_t time) {
+	if (!_tracking || time - _time > RANGE_TRACKER_MAX_GAP) {
+		start(range, time);
+		return true;
+	}
+	predict(time - _time);
+	_time = time;
+
+	int32_t innovation = range - _range;
+	int64_t s = (int64_t)_p00 + (int32_t)_rangeNoise * _rangeNoise;
+	int64_t innovation2 = (int64_t)innovation * innovation;
+	// half of innovation² / s is above 0.455 (median of chi² with one degree of freedom) when
+	// the acceleration noise fits the motion, else its scale goes up or down
+	if (innovation2 > ((s * 466) >> 10)) {
+		if (_scale < RANGE_TRACKER_MAX_SCALE)
+			_scale += _scale / RANGE_TRACKER_SCALE_STEP + 1;
+	} else if (_scale > RANGE_TRACKER_MIN_SCALE) {
+		_scale -= _scale / RANGE_TRACKER_SCALE_STEP;
+	}
+	if (innovation2 > RANGE_TRACKER_GATE * RANGE_TRACKER_GATE * s) {
+		// two misses in a row at a possible speed, the device moved in a way the track does
+		// not follow, e.g. turned around. The miss grows with the time since, so the second is
+		// on the same side and about twice as far (within the gate) as the first, which two
+		// outliers in a row seldom are.
+		if (_rejected > 0) {
+			int32_t elapsed = (int32_t)(time - _rejectedTime);
+			int32_t rate = (int32_t)((int64_t)(range - _rejectedRange) * 1000 / (elapsed + 1));
+			// the track only coasted since the first miss
+			int32_t first = _rejectedRange - (_range - (int32_t)((int64_t)_rate * elapsed / 1000));
+			int64_t shortfall = 2 * magnitude(first) - magnitude(innovation);
+			bool growing = (first < 0) == (innovation < 0)
+				&& (shortfall <= 0 || shortfall * shortfall <= RANGE_TRACKER_GATE * RANGE_TRACKER_GATE * s);
+			if (growing && rate <= RANGE_TRACKER_MAX_RATE && rate >= -RANGE_TRACKER_MAX_RATE) {
+				start(range, time);
+				_rate = rate;
+				return true;
+			}
+		}
+		_rejectedRange = range;
+		_rejectedTime = time;
+		if (++_rejected >= RANGE_TRACKER_MAX_REJECTED)
+			start(range, time);
+		return false;
+	}
+	_rejected = 0;
+	// less weight for a range far from the prediction, as if its noise was larger
+	if (innovation2 > RANGE_TRACKER_SOFT_GATE * RANGE_TRACKER_SOFT_GATE * s)
+		s = innovation2 / (RANGE_TRACKER_SOFT_GATE * RANGE_TRACKER_SOFT_GATE);
+
+	// gain for the range in 2^-30, below 1
+	int64_t k0 = ((int64_t)_p00 << 30) / s;
+	_range = saturate(_range + ((k0 * innovation) >> 30));
+	_rate = saturate(_rate + (int64_t)_p01 * innovation / s);
+	int64_t p11 = _p11 - (int64_t)_p01 * _p01 / s;
+	_p11 = p11 > 0 ? saturate(p11) : 0;
+	_p01 = saturate(_p01 - ((k0 * _p01) >> 30));
+	_p00 = saturate(_p00 - ((k0 * _p00) >> 30));
+	return true;
+}
+
+bool DW1000RangeTracker::isTracking() const {
+	return _tracking;
+}
+
+int32_t DW1000RangeTracker::getRange() const {
+	return _range;
+}
+
+int32_t DW1000RangeTracker::getRate() const {
+	return _rate;
+}
+
+uint32_t DW1000RangeTracker::getVariance() const {
+	return _p00;
+}
+
+uint8_t DW1000RangeTracker::getRejectedCount() const {
+	return _rejected;
+}
@@ -0,0 +1,70 @@
+#ifndef _DW1000RangeTracker_H_INCLUDED
+#define _DW1000RangeTracker_H_INCLUDED
+
+#include <Arduino.h>
+
+// Ranges further from the prediction than this many standard deviations are outliers
+#define RANGE_TRACKER_GATE 3
+// Ranges further than this many get less weight the further they are
+#define RANGE_TRACKER_SOFT_GATE 2
+// Outliers in a row after which the track starts over at the new range
+#define RANGE_TRACKER_MAX_REJECTED 3
+// Gap in ms after which the track starts over
+#define RANGE_TRACKER_MAX_GAP 5000
+// Standard deviation of the range rate of a new track, in mm/s
+#define RANGE_TRACKER_INITIAL_RATE 1000
+// Fastest range rate a new track may start with, in mm/s
+#define RANGE_TRACKER_MAX_RATE 5000
+// Bounds of the scale of the acceleration variance, in 1/256, and its change per range (1/8)
+#define RANGE_TRACKER_MIN_SCALE 16
+#define RANGE_TRACKER_MAX_SCALE 4096
+#define RANGE_TRACKER_SCALE_STEP 8
+
+// Constant velocity Kalman filter for the range to one device, in integers: range in mm,
+// rate in mm/s, time in ms. Ranges are gated by their distance from the prediction, the
+// acceleration noise is scaled to what the innovations show.
+class DW1000RangeTracker
+{
+public:
+	DW1000RangeTracker();
+
+	// Standard deviation of the measured ranges in mm and of the acceleration in mm/s², the
+	// same for all trackers. Each scales the variance of the acceleration by 1/16 to 16 to fit
+	// the motion.
+	static void setNoise(uint16_t rangeNoise, uint16_t acceleration);
+
+	void reset();
+	// Adds a range taken at time (millis()), false if it was rejected as an outlier
+	bool update(int32_t range, uint32_t time);
+
+	bool isTracking() const;
+	int32_t getRange() const;
+	int32_t getRate() const;
+	// of the range, in mm²
+	uint32_t getVariance() const;
+	uint8_t getRejectedCount() const;
+
+private:
+	static uint16_t _rangeNoise;
+	static uint16_t _acceleration;
+
+	int32_t _range;
+	int32_t _rate;
+	// covariance of range and rate
+	int32_t _p00;
+	int32_t _p01;
+	int32_t _p11;
+	uint32_t _time;
+	// last outlier
+	int32_t _rejectedRange;
+	uint32_t _rejectedTime;
+	uint8_t _rejected;
+	bool _tracking;
+	// of the acceleration variance, in 1/256
+	uint16_t _scale;
+
+	void start(int32_t range, uint32_t time);
+	void predict(uint32_t elapsed);
+};
+
+#endif
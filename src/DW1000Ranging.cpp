@@ -5,40 +5,88 @@ DW1000RangingClass DW1000Ranging;
 
 // Initialize static variables
 // Initialize static variables (match header exactly)
-DeviceManager DW1000RangingClass::_deviceManager;
+// 8 byte address as a number, as the frame views give it
+static uint64_t addressValue(const byte address[])
+{
+	uint64_t value = 0;
+	for (int8_t i = 7; i >= 0; i--)
+		value = (value << 8) | address[i];
+	return value;
+}
+
+DeviceManager<MAX_DEVICES> DW1000RangingClass::_deviceManager;
 byte DW1000RangingClass::_currentAddress[8];
 byte DW1000RangingClass::_currentShortAddress[2];
 byte DW1000RangingClass::_lastSentToShortAddress[2];
 DW1000Mac DW1000RangingClass::_globalMac;
 Role DW1000RangingClass::_type;
-volatile bool DW1000RangingClass::_sentAck = false;
-volatile bool DW1000RangingClass::_receivedAck = false;
 bool DW1000RangingClass::_protocolFailed = false;
 int32_t DW1000RangingClass::timer = 0;
 int16_t DW1000RangingClass::counterForBlink = 0;
-byte DW1000RangingClass::data[LEN_DATA];
+byte DW1000RangingClass::data[LEN_DATA_MAX];
+DW1000RangingClass::ReceivedFrame DW1000RangingClass::_frames[RANGING_FRAME_QUEUE_SIZE];
+uint8_t DW1000RangingClass::_frameTail = 0;
+uint8_t DW1000RangingClass::_frameCount = 0;
 uint8_t DW1000RangingClass::_RST;
 uint8_t DW1000RangingClass::_SS;
 uint32_t DW1000RangingClass::_lastActivity;
 uint32_t DW1000RangingClass::_resetPeriod;
 uint16_t DW1000RangingClass::_replyDelayTimeUS;
+uint16_t DW1000RangingClass::_processingBudgetUS;
+uint16_t DW1000RangingClass::_lateReplies = 0;
 uint16_t DW1000RangingClass::_timerDelay;
-uint16_t DW1000RangingClass::_rangeFilterValue;
+uint16_t DW1000RangingClass::_exchangeTimeoutMS;
+uint32_t DW1000RangingClass::_rangingIntervalUS;
+uint8_t DW1000RangingClass::_dutyCycle;
+uint32_t DW1000RangingClass::_airtimeCredit = 0;
+uint32_t DW1000RangingClass::_airtimeUpdate = 0;
+bool DW1000RangingClass::_exchangeActive = false;
+byte DW1000RangingClass::_exchangeAddress[2];
+uint32_t DW1000RangingClass::_exchangeStart;
+uint16_t DW1000RangingClass::_exchangeIndex = 0;
+bool DW1000RangingClass::_broadcastRanging = false;
+bool DW1000RangingClass::_frameFilter = true;
+bool DW1000RangingClass::_packedTimestamps = false;
+bool DW1000RangingClass::_exchangeBroadcast = false;
+bool DW1000RangingClass::_rangeSent = false;
+uint32_t DW1000RangingClass::_ackWindowUS;
+uint32_t DW1000RangingClass::_ackSlotsUS;
+DW1000Time DW1000RangingClass::_lastAckReceived;
+bool DW1000RangingClass::_blinkPending = false;
+bool DW1000RangingClass::_discovering = false;
+uint32_t DW1000RangingClass::_discoveryEnd;
+uint8_t DW1000RangingClass::_failedExchanges = 0;
+bool DW1000RangingClass::_exchangeRanged = false;
+uint32_t DW1000RangingClass::_exchangeDurationUS = 0;
+bool DW1000RangingClass::_backingOff = false;
+uint32_t DW1000RangingClass::_backoffEnd;
 volatile bool DW1000RangingClass::_useRangeFilter = false;
+#if RANGING_LATENCY
+DW1000Histogram DW1000RangingClass::_latency[LATENCY_PROBES];
+uint32_t DW1000RangingClass::_transmitTime = 0;
+#endif
 
 // Here our handlers
 void (*DW1000RangingClass::_handleNewRange)(DW1000Device *) = nullptr;
 void (*DW1000RangingClass::_handleBlinkDevice)(DW1000Device *) = nullptr;
 void (*DW1000RangingClass::_handleNewDevice)(DW1000Device *) = nullptr;
 void (*DW1000RangingClass::_handleInactiveDevice)(DW1000Device *) = nullptr;
+void (*DW1000RangingClass::_handleNewPosition)(DW1000Position *) = nullptr;
+
+DW1000Positioning DW1000RangingClass::_positioning;
 
 void DW1000RangingClass::initCommunication(uint8_t myRST, uint8_t mySS, uint8_t myIRQ)
 {
 	_RST = myRST;
 	_SS = mySS;
 	_resetPeriod = DEFAULT_RESET_PERIOD;
-	_replyDelayTimeUS = DEFAULT_REPLY_DELAY_TIME;
+	_replyDelayTimeUS = 0;
+	// start safe, the budget follows the measured processing time
+	_processingBudgetUS = DEFAULT_REPLY_DELAY_TIME;
 	_timerDelay = DEFAULT_TIMER_DELAY;
+	_exchangeTimeoutMS = DEFAULT_EXCHANGE_TIMEOUT;
+	_rangingIntervalUS = 0;
+	_dutyCycle = 100;
 
 	DW1000.begin(myIRQ, myRST);
 	DW1000.select(mySS);
@@ -49,17 +97,24 @@ void DW1000RangingClass::configureNetwork(uint16_t deviceAddress, uint16_t netwo
 	// general configuration
 	DW1000.newConfiguration();
 	DW1000.setDefaults();
-	DW1000.setDeviceAddress(deviceAddress);
+	// the frames carry the short addresses most significant byte first, the frame filter compares
+	// them to the one of PANADR as little endian
+	DW1000.setDeviceAddress((deviceAddress << 8) | (deviceAddress >> 8));
 	DW1000.setNetworkId(networkId);
 	DW1000.enableMode(mode);
+	// the chip drops the data frames to other devices, the blinks (a reserved type) are for all
+	DW1000.setFrameFilter(_frameFilter);
+	DW1000.setFrameFilterAllowData(true);
+	DW1000.setFrameFilterAllowReserved(true);
+	// take the next frame while the last one is still to be read, see loop()
+	DW1000.setDoubleBuffering(true);
 	DW1000.commitConfiguration();
 }
 
 void DW1000RangingClass::generalStart()
 {
-	// attach callback for (successfully) sent and received messages
-	DW1000.attachSentHandler(handleSent);
-	DW1000.attachReceivedHandler(handleReceived);
+	// sent and received messages are queued by the interrupt handler and handled in loop()
+	DW1000.useEventQueue(true);
 	// anchor starts in receiving mode, awaiting a ranging poll message
 
 	if (DEBUG)
@@ -171,11 +226,108 @@ void DW1000RangingClass::startAsTag(const char address[], const byte mode[], boo
 // setters
 void DW1000RangingClass::setReplyTime(uint16_t replyDelayTimeUs) { _replyDelayTimeUS = replyDelayTimeUs; }
 
+uint16_t DW1000RangingClass::getProcessingBudget() { return _processingBudgetUS; }
+
+uint16_t DW1000RangingClass::getLateReplyCount() { return _lateReplies; }
+
+const DW1000Histogram *DW1000RangingClass::getLatency(LatencyProbe probe)
+{
+#if RANGING_LATENCY
+	if (probe < LATENCY_PROBES)
+		return &_latency[probe];
+#else
+	(void)probe;
+#endif
+	return nullptr;
+}
+
+const DW1000Histogram *DW1000RangingClass::getLatency(DW1000Device *device, LatencyPhase phase)
+{
+#if RANGING_LATENCY
+	if (device && phase < LATENCY_PHASES)
+		return &device->getLatency().getHistogram(phase);
+#else
+	(void)device;
+	(void)phase;
+#endif
+	return nullptr;
+}
+
+void DW1000RangingClass::resetLatency()
+{
+#if RANGING_LATENCY
+	for (uint8_t i = 0; i < LATENCY_PROBES; i++)
+		_latency[i].reset();
+	for (uint16_t i = 0; i < _deviceManager.getDeviceCount(); i++)
+		_deviceManager.getDevice(i)->getLatency().reset();
+#endif
+}
+
+/*
+ * Little endian: 'D', 'L', version 2, LATENCY_BUCKETS and the number of records in 2 bytes. Then per record
+ * what it is (a LatencyProbe, or 0x10 + a LatencyPhase), the short address of the device (0 for
+ * the probes) in 2 bytes and the histogram, see DW1000Histogram::writeTo().
+ */
+size_t DW1000RangingClass::dumpLatency(Print &out)
+{
+#if RANGING_LATENCY
+	static_assert(LATENCY_PROBES + (uint32_t)MAX_DEVICES * LATENCY_PHASES <= 0xFFFF, "MAX_DEVICES too large for dumpLatency()");
+	uint16_t devices = _deviceManager.getDeviceCount();
+	uint16_t records = LATENCY_PROBES + devices * LATENCY_PHASES;
+	byte header[] = {'D', 'L', 2, LATENCY_BUCKETS, (byte)records, (byte)(records >> 8)};
+	size_t written = out.write(header, sizeof(header));
+	for (uint8_t i = 0; i < LATENCY_PROBES; i++)
+	{
+		byte record[] = {i, 0, 0};
+		written += out.write(record, sizeof(record));
+		written += _latency[i].writeTo(out);
+	}
+	for (uint16_t i = 0; i < devices; i++)
+	{
+		DW1000Device *dev = _deviceManager.getDevice(i);
+		uint16_t address = dev->getShortAddress();
+		for (uint8_t j = 0; j < LATENCY_PHASES; j++)
+		{
+			byte record[] = {(byte)(0x10 + j), (byte)address, (byte)(address >> 8)};
+			written += out.write(record, sizeof(record));
+			written += dev->getLatency().getHistogram((LatencyPhase)j).writeTo(out);
+		}
+	}
+	return written;
+#else
+	(void)out;
+	return 0;
+#endif
+}
+
 void DW1000RangingClass::setResetPeriod(uint32_t resetPeriod) { _resetPeriod = resetPeriod; }
 
+void DW1000RangingClass::setTargetRate(uint16_t rangesPerSecond)
+{
+	_rangingIntervalUS = rangesPerSecond > 0 ? 1000000UL / rangesPerSecond : 0;
+}
+
+void DW1000RangingClass::setDutyCycle(uint8_t percent)
+{
+	_dutyCycle = percent < 1 ? 1 : (percent > 100 ? 100 : percent);
+}
+
+void DW1000RangingClass::setExchangeTimeout(uint16_t ms) { _exchangeTimeoutMS = ms; }
+
+void DW1000RangingClass::useBroadcastRanging(bool enabled) { _broadcastRanging = enabled; }
+
+void DW1000RangingClass::usePackedTimestamps(bool enabled) { _packedTimestamps = enabled; }
+
+void DW1000RangingClass::useFrameFilter(bool enabled) { _frameFilter = enabled; }
+
 DW1000Device *DW1000RangingClass::searchDistantDevice(const byte shortAddr[])
 {
-	return _deviceManager.getDeviceByShortAddress(const_cast<byte *>(shortAddr));
+	return _deviceManager.getDeviceByShortAddress(shortAddr);
+}
+
+DW1000Device *DW1000RangingClass::searchDistantDevice(uint16_t shortAddress)
+{
+	return _deviceManager.getDeviceByShortAddress(shortAddress);
 }
 
 DW1000Device *DW1000RangingClass::getDistantDevice(int16_t index)
@@ -188,13 +340,34 @@ DW1000Device *DW1000RangingClass::getDistantDevice(const byte shortAddr[])
 	return _deviceManager.getDeviceByShortAddress(const_cast<byte *>(shortAddr));
 }
 
+DeviceHandle DW1000RangingClass::getDeviceHandle(const DW1000Device *device)
+{
+	return _deviceManager.getHandle(device);
+}
+
+DW1000Device *DW1000RangingClass::getDistantDevice(DeviceHandle handle)
+{
+	return _deviceManager.getDevice(handle);
+}
+
+void DW1000RangingClass::removeDistantDevice(DeviceHandle handle)
+{
+	DW1000Device *dev = _deviceManager.getDevice(handle);
+	if (dev == nullptr)
+		return;
+	// not in the middle of an exchange with it
+	if (_exchangeActive && dev->getTagState() == TAG_STATE_RANGING)
+		abortExchange();
+	_deviceManager.removeDevice(handle);
+}
+
 /* ###########################################################################
  * #### Public methods #######################################################
  * ######################################################################### */
 
 void DW1000RangingClass::checkForReset()
 {
-	if (!_sentAck && !_receivedAck)
+	if (DW1000.getPendingEventCount() == 0)
 	{
 		if (millis() - _lastActivity > _resetPeriod)
 		{
@@ -209,21 +382,20 @@ void DW1000RangingClass::checkForInactiveDevices()
 }
 
 // TODO check return type
-int16_t DW1000RangingClass::detectMessageType(const byte frame[])
+int16_t DW1000RangingClass::detectMessageType(const byte frame[], uint16_t length)
 {
 	if (frame[0] == FC_1_BLINK)
 	{
-		return BLINK;
+		return length >= LEN_BLINK ? BLINK : -1;
 	}
-	else if (frame[0] == FC_1 && frame[1] == FC_2)
+	// the function code follows the header of a data frame, however long it is
+	MacHeader header;
+	uint8_t offset = DW1000Mac::decodeHeader(frame, length, header);
+	if (offset == 0 || offset >= length || header.frameType != MAC_FRAME_DATA)
 	{
-		return frame[LONG_MAC_LEN];
+		return -1;
 	}
-	else if (frame[0] == FC_1 && frame[1] == FC_2_SHORT)
-	{
-		return frame[SHORT_MAC_LEN];
-	}
-	return -1;
+	return frame[offset];
 }
 
 void DW1000RangingClass::loop()
@@ -237,45 +409,143 @@ void DW1000RangingClass::loop()
 			Serial.println("[TICK] timerTick()");
 		timerTick();
 	}
-	if (_sentAck)
+	pollEvents();
+	// frames are handled after being read out of the receive buffers, so the receiver
+	// can take the next ones meanwhile
+	while (_frameCount > 0)
 	{
-		_sentAck = false;
-		int txType = detectMessageType(data);
-		if (DEBUG)
+#if RANGING_LATENCY
+		const ReceivedFrame &frame = _frames[_frameTail];
+		uint32_t start = micros();
+		_latency[LATENCY_QUEUE].add(start - frame.time);
+		handleReceived(frame);
+		_latency[LATENCY_DISPATCH].add(micros() - start);
+		// POLL to RANGE_REPORT all have a short header, but only those to this device count
+		ShortMacFrameView view(frame.data);
+		if (ShortMacFrameView::matches(frame.data, frame.length) &&
+		    (view.isBroadcast() || view.getDestination() == ((_currentShortAddress[1] << 8) | _currentShortAddress[0])))
+			probeLatency(view.getSource(), view.getPayload()[0], frame.time);
+#else
+		handleReceived(_frames[_frameTail]);
+#endif
+		_frameTail = (_frameTail + 1) % RANGING_FRAME_QUEUE_SIZE;
+		_frameCount--;
+		pollEvents();
+	}
+	scheduleExchange();
+}
+
+void DW1000RangingClass::pollEvents()
+{
+	// handle everything the interrupt handler queued, in order of occurrence, as long
+	// as there is room for received frames
+	DW1000Class::Event event;
+	while (_frameCount < RANGING_FRAME_QUEUE_SIZE && DW1000.pollEvent(event))
+	{
+		if (DW1000.isTransmitDone(event))
+		{
+			handleSent(event);
+		}
+		else if (DW1000.isReceiveDone(event))
 		{
-			Serial.print("[ACK SENT] Type: ");
-			Serial.println(txType);
+			ReceivedFrame &frame = _frames[(_frameTail + _frameCount) % RANGING_FRAME_QUEUE_SIZE];
+			// only the bytes actually received, without the FCS
+			uint16_t length = event.frameLength > 2 ? event.frameLength - 2 : 0;
+			if (length > LEN_DATA_MAX)
+				length = LEN_DATA_MAX;
+			DW1000.readReceivedFrame(frame.data, length, frame.diagnostics);
+			frame.length = length;
+#if RANGING_LATENCY
+			frame.time = event.time;
+#endif
+			_frameCount++;
 		}
-		if (auto dev = searchDistantDevice(_lastSentToShortAddress))
+	}
+}
+
+/* ###########################################################################
+ * #### Private methods and Handlers for transmit & Receive reply ############
+ * ######################################################################### */
+
+void DW1000RangingClass::handleSent(const DW1000Class::Event &event)
+{
+	int txType = detectMessageType(data, LEN_DATA);
+	if (DEBUG)
+	{
+		Serial.print("[ACK SENT] Type: ");
+		Serial.println(txType);
+	}
+	if (_lastSentToShortAddress[0] == 0xFF && _lastSentToShortAddress[1] == 0xFF)
+	{
+		// broadcast POLL, the time of the RANGE was set in advance
+		if (txType == POLL)
 		{
-			switch (txType)
+			DW1000Time pollSent;
+			DW1000.getTransmitTimestamp(event, pollSent);
+			for (uint16_t i = 0; i < _deviceManager.getDeviceCount(); i++)
 			{
-			case POLL:
-				DW1000.getTransmitTimestamp(dev->timePollSent);
-				break;
-			case RANGE:
-				DW1000.getTransmitTimestamp(dev->timeRangeSent);
-				break;
-			case POLL_ACK:
-				if (_type == ANCHOR)
-					DW1000.getTransmitTimestamp(dev->timePollAckSent);
-				break;
+				DW1000Device *dev = _deviceManager.getDevice(i);
+				if (dev->getTagState() == TAG_STATE_RANGING)
+					dev->setTimestamp(TIMESTAMP_POLL_SENT, pollSent);
 			}
 		}
-		noteActivity();
 	}
+	else if (auto dev = searchDistantDevice(_lastSentToShortAddress))
+	{
+		DW1000Time sent;
+		DW1000.getTransmitTimestamp(event, sent);
+		switch (txType)
+		{
+		case POLL:
+			dev->setTimestamp(TIMESTAMP_POLL_SENT, sent);
+			break;
+		case RANGE:
+			dev->setTimestamp(TIMESTAMP_RANGE_SENT, sent);
+			break;
+		case POLL_ACK:
+			if (_type == ANCHOR)
+				dev->setTimestamp(TIMESTAMP_POLL_ACK_SENT, sent);
+			break;
+		}
+	}
+#if RANGING_LATENCY
+	_latency[LATENCY_TRANSMIT].add(event.time - _transmitTime);
+	probeLatency((_lastSentToShortAddress[1] << 8) | _lastSentToShortAddress[0], txType, event.time);
+#endif
+	noteActivity();
+}
 
-	if (!_receivedAck)
+#if RANGING_LATENCY
+void DW1000RangingClass::probeLatency(uint16_t shortAddress, int16_t messageType, uint32_t time)
+{
+	if (messageType < POLL || messageType > RANGE_REPORT)
 		return;
-	_receivedAck = false;
+	if (shortAddress == 0xFFFF)
+	{
+		// broadcast POLL or RANGE, to all devices in the exchange
+		for (uint16_t i = 0; i < _deviceManager.getDeviceCount(); i++)
+		{
+			DW1000Device *dev = _deviceManager.getDevice(i);
+			if (dev->getTagState() == TAG_STATE_RANGING)
+				dev->getLatency().probe(messageType, time);
+		}
+	}
+	else if (DW1000Device *dev = searchDistantDevice(shortAddress))
+	{
+		dev->getLatency().probe(messageType, time);
+	}
+}
+#endif
 
-	DW1000.getData(data, LEN_DATA);
+void DW1000RangingClass::handleReceived(const ReceivedFrame &frame)
+{
+	memcpy(data, frame.data, frame.length);
 	if (DEBUG)
 	{
 		Serial.print("[DEBUG] RX raw (");
-		Serial.print(LEN_DATA);
+		Serial.print(frame.length);
 		Serial.println(" bytes):");
-		for (int i = 0; i < LEN_DATA; ++i)
+		for (int i = 0; i < frame.length; ++i)
 		{
 			if (data[i] < 0x10)
 				Serial.print('0');
@@ -284,26 +554,42 @@ void DW1000RangingClass::loop()
 		}
 		Serial.println();
 	}
-	int msgType = detectMessageType(data);
+	// the payload is where the frame control puts it, the bytes after the frame are left from earlier ones
+	MacHeader header;
+	uint8_t offset = 0;
+	int msgType;
+	if (data[0] == FC_1_BLINK)
+	{
+		msgType = frame.length >= LEN_BLINK ? BLINK : -1;
+	}
+	else
+	{
+		offset = DW1000Mac::decodeHeader(data, frame.length, header);
+		msgType = offset > 0 && offset < frame.length && header.frameType == MAC_FRAME_DATA ? data[offset] : -1;
+	}
 	if (msgType < 0)
 	{
 		if (DEBUG)
-			Serial.println("[ERROR] bad frame control");
+			Serial.println("[ERROR] bad frame control or frame too short");
 		return;
 	}
+	const byte *payload = data + offset;
+	// the LEN_ defines count the short header of the frames sent, so as if the header were that one
+	uint16_t length = frame.length - offset + SHORT_MAC_LEN;
 	if (DEBUG)
 	{
 		Serial.print("[RECEIVED] Msg type: ");
 		Serial.println(msgType);
 	}
 
-	byte recvAddr[2];
-	_globalMac.getReceiverAddress(data, recvAddr);
-	uint16_t rxShort = (recvAddr[1] << 8) | recvAddr[0];
+	bool isShort = msgType != BLINK && header.destinationMode == MAC_ADDRESS_SHORT;
+	uint16_t rxShort = isShort ? header.destination : 0;
 	uint16_t myShort = (_currentShortAddress[1] << 8) | _currentShortAddress[0];
-	bool isBroadcast = (rxShort == 0xFFFF) || (data[0] == FC_1_BLINK);
+	bool isBroadcast = msgType == BLINK || (isShort && rxShort == MAC_BROADCAST);
+	// the long ones (RANGING_INIT) are to the 8 byte address of a tag
+	bool forUs = isShort ? rxShort == myShort : header.destinationMode == MAC_ADDRESS_LONG && header.destination == addressValue(_currentAddress);
 
-	if (DEBUG && !isBroadcast)
+	if (DEBUG && isShort && !isBroadcast)
 	{
 		Serial.print("THIS MESSAGE IS FOR: 0x");
 		Serial.println(rxShort, HEX);
@@ -311,7 +597,7 @@ void DW1000RangingClass::loop()
 	// only for non-POLL, non-broadcast, explicitly-targeted frames…
 	if (_type == ANCHOR)
 	{
-		if (!isBroadcast && rxShort != myShort)
+		if (!isBroadcast && !forUs)
 		{
 			// auto-add unknown tags on the fly
 			// if (((rxShort & 0x00FF) == 0x0098 || (rxShort & 0xff00) == 0x9800))
@@ -341,69 +627,82 @@ if(DEBUG){			Serial.print("NOT FOR US: 0x");
 		}
 	}
 
+	// the frames of a known device to this one and its broadcasts count for its link
+	uint16_t source = msgType == BLINK ? BlinkFrameView(data).getSourceShort() : header.source;
+	uint8_t sequenceNumber = msgType == BLINK ? BlinkFrameView(data).getSequenceNumber() : header.sequenceNumber;
+	DW1000Device *known = msgType == BLINK || header.sourceMode == MAC_ADDRESS_SHORT ? searchDistantDevice(source) : nullptr;
+	if (known && (isBroadcast || forUs) && !known->getLinkQuality().receive(sequenceNumber, micros(), isBroadcast))
+	{
+		if (DEBUG)
+			Serial.println("[RECEIVED] duplicate frame, dropped");
+		return;
+	}
+
 	if (msgType == BLINK && _type == ANCHOR)
 	{
-		byte addr[8], shortAddr[2];
-		_globalMac.decodeBlinkFrame(data, addr, shortAddr);
+		DW1000Time blinkReceived;
+		DW1000.getReceiveTimestamp(frame.diagnostics, blinkReceived);
 
 		// Check if device already exists before creating a new one
-		DW1000Device *existingDevice = getDistantDevice(shortAddr);
+		DW1000Device *existingDevice = known;
 		if (!existingDevice)
 		{
-			DW1000Device *newTag = new DW1000Device(addr, shortAddr);
-			if (_deviceManager.addDevice(newTag))
+			byte addr[8], shortAddr[2];
+			_globalMac.decodeBlinkFrame(data, addr, shortAddr);
+			DW1000Device *newTag = _deviceManager.emplace(shortAddr, addr);
+			if (newTag)
 			{
 				if (DEBUG)
 				{
 					Serial.print("[ANCHOR] New tag added: short:");
-					Serial.println((shortAddr[0] << 8) | shortAddr[1], HEX);
+					Serial.println(source, HEX);
 				}
 				if (_handleBlinkDevice)
 					_handleBlinkDevice(newTag);
-				transmitRangingInit(newTag);
+				transmitRangingInit(newTag, blinkReceived);
 				noteActivity();
 			}
-			else
+			else if (DEBUG)
 			{
-				delete newTag;
-				if (DEBUG)
-					Serial.println("[ERROR] Failed to add tag device");
+				Serial.println("[ERROR] Failed to add tag device");
 			}
 		}
-		else if (DEBUG)
+		else
 		{
-			Serial.print("[ANCHOR] Tag already exists: ");
-			Serial.println((shortAddr[0] << 8) | shortAddr[1], HEX);
+			// the tag blinks for anchors it does not know yet, maybe our RANGING_INIT got lost
+			if (DEBUG)
+			{
+				Serial.print("[ANCHOR] Tag already exists: ");
+				Serial.println(source, HEX);
+			}
+			transmitRangingInit(existingDevice, blinkReceived);
+			noteActivity();
 		}
 		return;
 	}
 
 	if (msgType == RANGING_INIT && _type == TAG)
 	{
-		byte addr[2];
-		_globalMac.decodeLongMACFrame(data, addr);
+		if (header.sourceMode != MAC_ADDRESS_SHORT)
+			return;
 
 		// Check if this anchor already exists
-		DW1000Device *existingAnchor = getDistantDevice(addr);
+		DW1000Device *existingAnchor = known;
 		if (!existingAnchor)
 		{
-			DW1000Device *newAnchor = new DW1000Device(addr, true);
-			if (_deviceManager.addDevice(newAnchor, true))
+			byte addr[2];
+			writeShortAddress(addr, source);
+			DW1000Device *newAnchor = _deviceManager.emplace(addr);
+			if (newAnchor)
 			{
 				if (DEBUG)
 				{
 					Serial.print("[TAG] New anchor added: short:");
-					Serial.println((addr[0] << 8) | addr[1], HEX);
-				}
-
-				DW1000Device *storedDev = _deviceManager.getDeviceByShortAddress(addr);
-				if (storedDev)
-				{
-					storedDev->setTagState(TAG_STATE_IDLE);
+					Serial.println(source, HEX);
 				}
 
 				if (_handleNewDevice)
-					_handleNewDevice(storedDev);
+					_handleNewDevice(newAnchor);
 
 				if (DEBUG)
 				{
@@ -412,17 +711,15 @@ if(DEBUG){			Serial.print("NOT FOR US: 0x");
 					Serial.println(" devices.");
 				}
 			}
-			else
+			else if (DEBUG)
 			{
-				delete newAnchor;
-				if (DEBUG)
-					Serial.println("[ERROR] Failed to add anchor device");
+				Serial.println("[ERROR] Failed to add anchor device");
 			}
 		}
 		else if (DEBUG)
 		{
 			Serial.print("[TAG] Anchor already exists: ");
-			Serial.println((addr[0] << 8) | addr[1], HEX);
+			Serial.println(source, HEX);
 			// Make sure the anchor is in idle state so we'll range with it
 			existingAnchor->setTagState(TAG_STATE_IDLE);
 		}
@@ -430,46 +727,40 @@ if(DEBUG){			Serial.print("NOT FOR US: 0x");
 		return;
 	}
 
-	// Validate message format before decoding
-	if (msgType != BLINK && (data[0] != FC_1 || (data[1] != FC_2 && data[1] != FC_2_SHORT)))
+	// the devices are known by their short addresses
+	if (header.sourceMode != MAC_ADDRESS_SHORT)
 	{
 		if (DEBUG)
 			Serial.println("[ERROR] Invalid frame format");
 		return;
 	}
 
-	byte addr[2];
-	_globalMac.decodeShortMACFrame(data, addr);
-
-	DW1000Device *dev = getDistantDevice(addr);
+	DW1000Device *dev = known;
 	if (!dev)
 	{
-		// In case device isn't found, create a temporary one to handle the message
-		// but with a safeguard to prevent memory leaks
+		// In case device isn't found, admit it to handle the message
 		if (DEBUG)
 		{
 			Serial.print("[WARNING] Message from unknown device: ");
-			Serial.println((addr[0] << 8) | addr[1], HEX);
+			Serial.println(source, HEX);
 		}
 
-		// Only create a device if it's a critical message type
-		if (msgType == POLL || msgType == POLL_ACK || msgType == RANGE)
+		// Only create a device if it's a critical message type, sent by the other role: tags hear
+		// the broadcast POLLs of other tags too
+		bool fromTag = msgType == POLL || msgType == RANGE;
+		if ((fromTag && _type == ANCHOR) || (msgType == POLL_ACK && _type == TAG))
 		{
-			DW1000Device *newDevice = new DW1000Device(addr, _type == TAG);
-			bool added = _deviceManager.addDevice(newDevice);
-			if (!added)
+			byte addr[2];
+			writeShortAddress(addr, source);
+			dev = _deviceManager.emplace(addr);
+			if (!dev)
 			{
-				delete newDevice;
 				if (DEBUG)
 					Serial.println("[ERROR] Failed to add device to manager");
 				return;
 			}
-			dev = _deviceManager.getDeviceByShortAddress(addr);
-			if (DEBUG && dev)
-			{
-				Serial.print("[DEBUG] Created device on the fly. Success? ");
-				Serial.println(added);
-			}
+			if (DEBUG)
+				Serial.println("[DEBUG] Created device on the fly");
 		}
 		else
 		{
@@ -488,36 +779,56 @@ if(DEBUG){			Serial.print("NOT FOR US: 0x");
 
 	// Update device activity timestamp
 	dev->noteActivity();
+	_deviceManager.updateDeadline(dev);
 
 	if (_type == TAG)
 	{
-		if (msgType == dev->getExpectedMsgId())
+		if (msgType == dev->getExpectedMsgId() && dev->getTagState() == TAG_STATE_RANGING)
 		{
 			if (msgType == POLL_ACK)
 			{
-				DW1000.getReceiveTimestamp(dev->timePollAckReceived);
+				DW1000Time received;
+				DW1000.getReceiveTimestamp(frame.diagnostics, received);
+				dev->setTimestamp(TIMESTAMP_POLL_ACK_RECEIVED, received);
 				if (DEBUG)
 				{
 					Serial.print("[TAG] Received POLL_ACK from ");
 					Serial.println((dev->getByteShortAddress()[0] << 8) | dev->getByteShortAddress()[1], HEX);
 					Serial.print("[DEBUG] timePollAckReceived: ");
-					dev->timePollAckReceived.printTo(Serial);
+					dev->getTimestamp(TIMESTAMP_POLL_ACK_RECEIVED).printTo(Serial);
 				}
 
 				dev->setExpectedMsgId(RANGE_REPORT);
-				transmitRange(dev);
+				if (!_exchangeBroadcast)
+				{
+					transmitRange(dev);
+				}
+				else if (!_rangeSent)
+				{
+					// one RANGE for all anchors, as soon as the last one answered
+					_lastAckReceived = dev->getTimestamp(TIMESTAMP_POLL_ACK_RECEIVED);
+					if (countRangingDevices(POLL_ACK) == 0)
+						transmitRange(nullptr);
+				}
 			}
 			else if (msgType == RANGE_REPORT)
 			{
 				float range, power;
 				// Check if we have enough data for these fields
-				if (SHORT_MAC_LEN + 9 <= LEN_DATA)
+				if (length >= LEN_RANGE_REPORT)
 				{
-					memcpy(&range, data + 1 + SHORT_MAC_LEN, 4);
-					memcpy(&power, data + 5 + SHORT_MAC_LEN, 4);
+					memcpy(&range, payload + 1, 4);
+					memcpy(&power, payload + 5, 4);
+					// a range the anchor filtered already is not smoothed twice
+					if (_useRangeFilter && !(payload[9] & RANGE_REPORT_FILTERED))
+					{
+						dev->getRangeTracker().update((int32_t)(range * 1000), millis());
+						range = dev->getRangeTracker().getRange() / 1000.0f;
+					}
 					dev->setRange(range);
 					dev->setRXPower(power);
-					dev->setTagState(TAG_STATE_IDLE);
+					_exchangeRanged = true;
+					finishExchange(dev);
 					if (DEBUG)
 					{
 						Serial.print("[TAG] RANGE_REPORT from ");
@@ -529,6 +840,8 @@ if(DEBUG){			Serial.print("NOT FOR US: 0x");
 					}
 					if (_handleNewRange)
 						_handleNewRange(dev);
+					if (_handleNewPosition && _positioning.addRange(dev->getShortAddress(), range))
+						_handleNewPosition(_positioning.getPosition());
 				}
 				else
 				{
@@ -538,8 +851,7 @@ if(DEBUG){			Serial.print("NOT FOR US: 0x");
 			}
 			else if (msgType == RANGE_FAILED)
 			{
-				dev->setExpectedMsgId(POLL_ACK);
-				dev->setTagState(TAG_STATE_IDLE);
+				finishExchange(dev);
 				if (DEBUG)
 				{
 					Serial.print("[TAG] RANGE_FAILED received from ");
@@ -562,7 +874,24 @@ if(DEBUG){			Serial.print("NOT FOR US: 0x");
 	{
 		if (msgType == POLL)
 		{
-			DW1000.getReceiveTimestamp(dev->timePollReceived);
+			// a broadcast POLL lists the anchors to answer, each with its reply slot
+			uint16_t slot = 0;
+			if (isBroadcast)
+			{
+				uint8_t count = payload[1];
+				if (length < SHORT_MAC_LEN + 2 + LEN_POLL_RECORD * count)
+					count = (length - SHORT_MAC_LEN - 2) / LEN_POLL_RECORD;
+				uint8_t i = 0;
+				while (i < count && memcmp(payload + 2 + LEN_POLL_RECORD * i, _currentShortAddress, 2) != 0)
+					i++;
+				if (i == count)
+					return;
+				memcpy(&slot, payload + 4 + LEN_POLL_RECORD * i, 2);
+			}
+			dev->setReplyTime(slot);
+			DW1000Time received;
+			DW1000.getReceiveTimestamp(frame.diagnostics, received);
+			dev->setTimestamp(TIMESTAMP_POLL_RECEIVED, received);
 			dev->setExpectedMsgId(RANGE);
 			transmitPollAck(dev);
 			if (DEBUG)
@@ -575,21 +904,70 @@ if(DEBUG){			Serial.print("NOT FOR US: 0x");
 		}
 		else if (msgType == RANGE)
 		{
-			// Validate message has enough bytes for all timestamps
-			if (SHORT_MAC_LEN + 16 > LEN_DATA)
+			// packed RANGEs carry the intervals only, counted from a POLL sent at 0
+			uint32_t round1, reply2;
+			if (isBroadcast)
+			{
+				// find our record, the times of POLL and RANGE are common
+				uint8_t count = payload[1];
+				bool packed = count & RANGE_COUNT_PACKED;
+				count &= ~RANGE_COUNT_PACKED;
+				uint16_t common = packed ? LEN_RANGE_HEADER_PACKED : LEN_RANGE_HEADER;
+				uint16_t record = packed ? LEN_RANGE_RECORD_PACKED : LEN_RANGE_RECORD;
+				if (length < common + record * count)
+				{
+					if (DEBUG)
+						Serial.println("[ERROR] RANGE message too short");
+					return;
+				}
+				uint8_t i = 0;
+				const byte *records = payload + common - SHORT_MAC_LEN;
+				while (i < count && memcmp(records + record * i, _currentShortAddress, 2) != 0)
+					i++;
+				if (i == count)
+					return;
+				if (packed)
+				{
+					uint32_t total;
+					memcpy(&total, payload + 2, 4);
+					memcpy(&round1, records + record * i + 2, 4);
+					dev->setTimestamp(TIMESTAMP_POLL_SENT, DW1000Time((int64_t)0));
+					dev->setTimestamp(TIMESTAMP_POLL_ACK_RECEIVED, DW1000Time((int64_t)round1));
+					dev->setTimestamp(TIMESTAMP_RANGE_SENT, DW1000Time((int64_t)total));
+				}
+				else
+				{
+					dev->setTimestamp(TIMESTAMP_POLL_SENT, payload + 2);
+					dev->setTimestamp(TIMESTAMP_RANGE_SENT, payload + 7);
+					dev->setTimestamp(TIMESTAMP_POLL_ACK_RECEIVED, records + record * i + 2);
+				}
+			}
+			else if (length >= LEN_RANGE)
+			{
+				dev->setTimestamp(TIMESTAMP_POLL_SENT, payload + 1);
+				dev->setTimestamp(TIMESTAMP_POLL_ACK_RECEIVED, payload + 6);
+				dev->setTimestamp(TIMESTAMP_RANGE_SENT, payload + 11);
+			}
+			else if (length >= LEN_RANGE_PACKED)
+			{
+				memcpy(&round1, payload + 1, 4);
+				memcpy(&reply2, payload + 5, 4);
+				dev->setTimestamp(TIMESTAMP_POLL_SENT, DW1000Time((int64_t)0));
+				dev->setTimestamp(TIMESTAMP_POLL_ACK_RECEIVED, DW1000Time((int64_t)round1));
+				dev->setTimestamp(TIMESTAMP_RANGE_SENT, DW1000Time((int64_t)round1 + reply2));
+			}
+			else
 			{
 				if (DEBUG)
 					Serial.println("[ERROR] RANGE message too short");
 				return;
 			}
 
-			DW1000.getReceiveTimestamp(dev->timeRangeReceived);
+			DW1000Time received;
+			DW1000.getReceiveTimestamp(frame.diagnostics, received);
+			dev->setTimestamp(TIMESTAMP_RANGE_RECEIVED, received);
 			dev->setExpectedMsgId(POLL);
 
-			dev->timePollSent.setTimestamp(data + 1 + SHORT_MAC_LEN);
-			dev->timePollAckReceived.setTimestamp(data + 6 + SHORT_MAC_LEN);
-			dev->timeRangeSent.setTimestamp(data + 11 + SHORT_MAC_LEN);
-
 			DW1000Time tof;
 			computeRangeAsymmetric(dev, &tof);
 			float distance = tof.getAsMeters();
@@ -607,15 +985,17 @@ if(DEBUG){			Serial.print("NOT FOR US: 0x");
 				return;
 			}
 
-			if (_useRangeFilter && dev->getRange() > 0.0f)
+			if (_useRangeFilter)
 			{
-				distance = filterValue(distance, dev->getRange(), _rangeFilterValue);
+				// an outlier leaves the predicted range
+				dev->getRangeTracker().update((int32_t)tof.getAsMillimeters(), millis());
+				distance = dev->getRangeTracker().getRange() / 1000.0f;
 			}
 
 			dev->setRange(distance);
-			dev->setRXPower(DW1000.getReceivePower());
-			dev->setFPPower(DW1000.getFirstPathPower());
-			dev->setQuality(DW1000.getReceiveQuality());
+			dev->setRXPower(DW1000.getReceivePower(frame.diagnostics));
+			dev->setFPPower(DW1000.getFirstPathPower(frame.diagnostics));
+			dev->setQuality(DW1000.getReceiveQuality(frame.diagnostics));
 
 			transmitRangeReport(dev);
 
@@ -634,22 +1014,6 @@ if(DEBUG){			Serial.print("NOT FOR US: 0x");
 	}
 }
 
-/* ###########################################################################
- * #### Private methods and Handlers for transmit & Receive reply ############
- * ######################################################################### */
-
-void DW1000RangingClass::handleSent()
-{
-	// status change on sent success
-	_sentAck = true;
-}
-
-void DW1000RangingClass::handleReceived()
-{
-	// status change on received success
-	_receivedAck = true;
-}
-
 void DW1000RangingClass::noteActivity()
 {
 	// update activity timestamp, so that we do not reach "resetPeriod"
@@ -667,120 +1031,222 @@ void DW1000RangingClass::resetInactive()
 
 void DW1000RangingClass::timerTick()
 {
-	if (_type == TAG)
-	{
-		uint8_t devCount = _deviceManager.getDeviceCount();
+	// the tag looks for anchors all the time until ranging can start, then every 21st tick,
+	// scheduleExchange() sends the BLINK between two exchanges
+	if (_type == TAG && (_deviceManager.getDeviceCount() <= 1 || counterForBlink == 0))
+		_blinkPending = true;
 
-		if (DEBUG)
+	checkForInactiveDevices();
+	counterForBlink++;
+	if (counterForBlink > 20)
+		counterForBlink = 0;
+}
+
+void DW1000RangingClass::scheduleExchange()
+{
+	if (_type != TAG)
+		return;
+
+	uint32_t now = micros();
+	if (_exchangeActive)
+	{
+		// anchors that did not answer in their slot are left out of the broadcast RANGE
+		if (_exchangeBroadcast && !_rangeSent && now - _exchangeStart >= _ackWindowUS && DW1000.getPendingEventCount() == 0)
 		{
-			for (uint8_t i = 0; i < _deviceManager.getDeviceCount(); i++)
-			{
-				DW1000Device *d = _deviceManager.getDevice(i);
-				if (d)
-				{
-					Serial.print("[DEBUG] Dev ");
-					Serial.print(i);
-					Serial.print(" short=");
-					Serial.print(d->getShortAddress(), HEX);
-					Serial.print(" state=");
-					Serial.println(d->getTagState() == TAG_STATE_IDLE ? "IDLE" : "BUSY");
-				}
-			}
+			transmitRange(nullptr);
+			return;
 		}
-
-		if (devCount > 1)
+		// a broadcast exchange gets the timeout after the POLL_ACK slots
+		uint32_t timeout = (uint32_t)_exchangeTimeoutMS * 1000UL + (_exchangeBroadcast ? _ackWindowUS : 0);
+		if (now - _exchangeStart < timeout)
+			return;
+		if (DEBUG)
 		{
-			if (DEBUG)
-			{
-				Serial.print("[TIMER] Device count: ");
-				Serial.println(devCount);
-			}
+			Serial.print("[SCHEDULER] No RANGE_REPORT from ");
+			Serial.println((_exchangeAddress[1] << 8) | _exchangeAddress[0], HEX);
+		}
+		abortExchange();
+		backOff(now);
+	}
+	if (_backingOff)
+	{
+		if ((int32_t)(now - _backoffEnd) < 0)
+			return;
+		_backingOff = false;
+	}
 
-			// Log all known device short addresses
-			if (DEBUG)
-			{
-				for (uint8_t i = 0; i < devCount; i++)
-				{
-					DW1000Device *d = _deviceManager.getDevice(i);
-					if (d)
-					{
-						Serial.print("  [TIMER] Device[");
-						Serial.print(i);
-						Serial.print("] short: ");
-						Serial.print(d->getShortAddress(), HEX);
-						Serial.print(" state: ");
-						Serial.println(d->getTagState() == TAG_STATE_IDLE ? "IDLE" : "RANGING");
-					}
-				}
-			}
+	// leave the anchors time to answer a BLINK with RANGING_INIT in their random slots
+	if (_blinkPending)
+	{
+		if (DEBUG)
+			Serial.println("[SCHEDULER] Sending BLINK");
+		_blinkPending = false;
+		transmitBlink();
+		_discoveryEnd = now + DW1000.getFrameDuration(LEN_BLINK + 2) + RANGING_INIT_DELAY_TIME + RANGING_INIT_SLOTS * getReplySlotSpacing();
+		_discovering = true;
+		return;
+	}
+	if (_discovering)
+	{
+		if ((int32_t)(now - _discoveryEnd) < 0)
+			return;
+		_discovering = false;
+	}
 
-			// Use a counter to cycle through devices for more fair scheduling
-			static uint8_t deviceIndex = 0;
-			bool rangedThisTick = false;
+	// the tag keeps blinking until it knows more than one anchor, see timerTick()
+	uint16_t devCount = _deviceManager.getDeviceCount();
+	if (devCount <= 1)
+		return;
 
-			// Try up to the number of devices to find one to range with
-			for (uint8_t attempt = 0; attempt < devCount; attempt++)
-			{
-				deviceIndex = (deviceIndex + 1) % devCount;
-				DW1000Device *dev = _deviceManager.getDevice(deviceIndex);
+	// transmit time earned since the last call (in 0.01 us, so short loops do not round it
+	// away), up to one second worth of it
+	if (_dutyCycle < 100)
+	{
+		uint32_t elapsed = now - _airtimeUpdate;
+		_airtimeUpdate = now;
+		if (elapsed > 1000000UL)
+			elapsed = 1000000UL;
+		_airtimeCredit += elapsed * _dutyCycle;
+		if (_airtimeCredit > 1000000UL * _dutyCycle)
+			_airtimeCredit = 1000000UL * _dutyCycle;
+	}
 
-				if (DEBUG)
-				{
-					Serial.print("[TIMER] Checking device index ");
-					Serial.print(deviceIndex);
-					Serial.print(": ");
+	if (_broadcastRanging)
+	{
+		if (_rangingIntervalUS > 0 && now - _exchangeStart < _rangingIntervalUS)
+			return;
+		uint8_t count = devCount < BROADCAST_MAX_ANCHORS ? devCount : BROADCAST_MAX_ANCHORS;
+		if (_dutyCycle < 100)
+		{
+			// POLL and RANGE, in 0.01 us
+			uint32_t airtime = 100 * (DW1000.getFrameDuration(SHORT_MAC_LEN + 2 + LEN_POLL_RECORD * count + 2) + DW1000.getFrameDuration(getRangeLength(true, count) + 2));
+			if (_airtimeCredit < airtime)
+				return;
+			_airtimeCredit -= airtime;
+		}
+		// more anchors than fit into a frame take turns
+		for (uint8_t i = 0; i < count; i++)
+		{
+			_exchangeIndex = (_exchangeIndex + 1) % devCount;
+			DW1000Device *dev = _deviceManager.getDevice(_exchangeIndex);
+			dev->setTagState(TAG_STATE_RANGING);
+			dev->setExpectedMsgId(POLL_ACK);
+			dev->setPollTime(now);
+			_deviceManager.updateDeadline(dev);
+		}
+		_exchangeAddress[0] = _exchangeAddress[1] = 0xFF;
+		_exchangeStart = now;
+		_exchangeActive = true;
+		_exchangeBroadcast = true;
+		_exchangeRanged = false;
+		_rangeSent = false;
+		transmitPoll(nullptr);
+		return;
+	}
 
-					if (dev)
-					{
-						Serial.print("short=");
-						Serial.print(dev->getShortAddress(), HEX);
-						Serial.print(", state=");
-						Serial.println(dev->getTagState() == TAG_STATE_IDLE ? "IDLE" : "BUSY");
-					}
-					else
-					{
-						Serial.println("nullptr");
-					}
-				}
+	// round robin, starting after the anchor ranged last
+	for (uint16_t attempt = 1; attempt <= devCount; attempt++)
+	{
+		uint16_t index = (_exchangeIndex + attempt) % devCount;
+		DW1000Device *dev = _deviceManager.getDevice(index);
+		if (dev == nullptr || dev->getTagState() != TAG_STATE_IDLE)
+			continue;
+		if (_rangingIntervalUS > 0 && now - dev->getPollTime() < _rangingIntervalUS)
+			continue;
+		if (_dutyCycle < 100)
+		{
+			// POLL and RANGE, in 0.01 us
+			uint32_t airtime = 100 * (DW1000.getFrameDuration(LEN_POLL + 2) + DW1000.getFrameDuration(getRangeLength(false, 1) + 2));
+			if (_airtimeCredit < airtime)
+				return;
+			_airtimeCredit -= airtime;
+		}
 
-				// Skip null devices or non-idle ones
-				if (dev == nullptr || dev->getTagState() != TAG_STATE_IDLE)
-				{
-					continue;
-				}
+		dev->setTagState(TAG_STATE_RANGING);
+		dev->setExpectedMsgId(POLL_ACK);
+		dev->setPollTime(now);
+		_deviceManager.updateDeadline(dev);
+		copyShortAddress(_exchangeAddress, dev->getByteShortAddress());
+		_exchangeIndex = index;
+		_exchangeStart = now;
+		_exchangeActive = true;
+		_exchangeBroadcast = false;
+		_exchangeRanged = false;
 
-				dev->setTagState(TAG_STATE_RANGING);
-				dev->setExpectedMsgId(POLL_ACK);
-				memcpy(_lastSentToShortAddress, dev->getByteShortAddress(), 2);
+		if (DEBUG)
+		{
+			Serial.print("[SCHEDULER] Sending POLL to device: ");
+			Serial.println(dev->getShortAddress(), HEX);
+		}
+		transmitPoll(dev);
+		return;
+	}
+}
 
-				if (DEBUG)
-				{
-					Serial.print("[TIMER] Sending POLL to device: ");
-					Serial.println(dev->getShortAddress(), HEX);
-				}
+void DW1000RangingClass::finishExchange(DW1000Device *dev)
+{
+	if (dev != nullptr)
+	{
+		dev->setTagState(TAG_STATE_IDLE);
+		dev->setExpectedMsgId(POLL_ACK);
+	}
+	if (_exchangeBroadcast)
+	{
+		// done with the last anchor
+		if (countRangingDevices(POLL_ACK) + countRangingDevices(RANGE_REPORT) == 0)
+		{
+			_exchangeActive = false;
+			backOff(micros());
+		}
+	}
+	else if (dev == nullptr || dev->getShortAddress() == ((_exchangeAddress[1] << 8) | _exchangeAddress[0]))
+	{
+		_exchangeActive = false;
+		backOff(micros());
+	}
+}
 
-				transmitPoll(dev);
-				rangedThisTick = true;
-				break;
-			}
+void DW1000RangingClass::backOff(uint32_t now)
+{
+	if (_exchangeRanged)
+	{
+		_failedExchanges = 0;
+		_exchangeDurationUS = now - _exchangeStart;
+		return;
+	}
+	// a random wait of up to 1, 2, 4 ... exchanges, for as long as they keep failing, one reply
+	// delay stands in for an exchange before the first one succeeded
+	if (_failedExchanges <= RANGING_BACKOFF_MAX_EXPONENT)
+		_failedExchanges++;
+	uint32_t exchange = _exchangeDurationUS > 0 ? _exchangeDurationUS : DEFAULT_REPLY_DELAY_TIME;
+	_backoffEnd = now + random(0, (long)(exchange << (_failedExchanges - 1)));
+	_backingOff = true;
+}
 
-			if (!rangedThisTick && DEBUG)
-			{
-				Serial.println("[TIMER] No idle devices found for ranging");
-			}
-		}
-		else
+void DW1000RangingClass::abortExchange()
+{
+	for (uint16_t i = 0; i < _deviceManager.getDeviceCount(); i++)
+	{
+		DW1000Device *dev = _deviceManager.getDevice(i);
+		if (dev->getTagState() == TAG_STATE_RANGING)
 		{
-			if (DEBUG)
-				Serial.println("[TIMER] No devices, sending BLINK");
-			transmitBlink();
+			dev->setTagState(TAG_STATE_IDLE);
+			dev->setExpectedMsgId(POLL_ACK);
 		}
 	}
+	_exchangeActive = false;
+}
 
-	checkForInactiveDevices();
-	counterForBlink++;
-	if (counterForBlink > 20)
-		counterForBlink = 0;
+uint8_t DW1000RangingClass::countRangingDevices(uint8_t expectedMsgId)
+{
+	uint8_t count = 0;
+	for (uint16_t i = 0; i < _deviceManager.getDeviceCount(); i++)
+	{
+		DW1000Device *dev = _deviceManager.getDevice(i);
+		if (dev->getTagState() == TAG_STATE_RANGING && dev->getExpectedMsgId() == expectedMsgId)
+			count++;
+	}
+	return count;
 }
 
 void DW1000RangingClass::copyShortAddress(byte dst[], const byte src[])
@@ -799,16 +1265,12 @@ void DW1000RangingClass::transmitInit()
 	DW1000.setDefaults();
 }
 
-void DW1000RangingClass::transmit(const byte frame[])
-{
-	DW1000.setData(const_cast<byte *>(frame), LEN_DATA);
-	DW1000.startTransmit();
-}
-
-void DW1000RangingClass::transmit(const byte frame[], const DW1000Time &time)
+void DW1000RangingClass::transmit(const byte frame[], uint16_t length)
 {
-	DW1000.setDelay(time);
-	DW1000.setData(const_cast<byte *>(frame), LEN_DATA);
+	DW1000.setData(const_cast<byte *>(frame), length);
+#if RANGING_LATENCY
+	_transmitTime = micros();
+#endif
 	DW1000.startTransmit();
 }
 
@@ -816,51 +1278,71 @@ void DW1000RangingClass::transmitBlink()
 {
 	transmitInit();
 	_globalMac.generateBlinkFrame(data, _currentAddress, _currentShortAddress);
-	transmit(data);
+	transmit(data, LEN_BLINK);
 }
 
-void DW1000RangingClass::transmitRangingInit(DW1000Device *myDistantDevice)
+void DW1000RangingClass::transmitRangingInit(DW1000Device *myDistantDevice, const DW1000Time &blinkReceived)
 {
 	transmitInit();
 	// we generate the mac frame for a ranging init message
-	_globalMac.generateLongMACFrame(data, _currentShortAddress, myDistantDevice->getByteAddress());
+	_globalMac.generateLongMACFrame(data, _currentShortAddress, myDistantDevice->getByteAddress(), myDistantDevice->nextSequenceNumber());
 	// we define the function code
 	data[LONG_MAC_LEN] = RANGING_INIT;
 
 	copyShortAddress(_lastSentToShortAddress, myDistantDevice->getByteShortAddress());
-	delayMicroseconds(random(0, DEFAULT_TIMER_DELAY * 10));
-	transmit(data);
+	// in a random reply slot, so the anchors answering the same BLINK rarely collide
+	uint32_t offset = RANGING_INIT_DELAY_TIME + (uint32_t)random(0, RANGING_INIT_SLOTS) * getReplySlotSpacing();
+	DW1000Time scheduled = scheduleReply(blinkReceived, offset < UINT16_MAX ? offset : UINT16_MAX);
+	transmit(data, LEN_RANGING_INIT);
+	checkReply(blinkReceived, scheduled);
 	noteActivity();
 }
 
 void DW1000RangingClass::transmitPoll(DW1000Device *myDistantDevice)
 {
 	transmitInit();
+	uint16_t length = LEN_POLL;
 	if (myDistantDevice == nullptr)
 	{
-		_timerDelay = DEFAULT_TIMER_DELAY + (uint16_t)(_deviceManager.getDeviceCount() * 3 * DEFAULT_REPLY_DELAY_TIME / 1000);
-
 		byte shortBroadcast[2] = {0xFF, 0xFF};
 		_globalMac.generateShortMACFrame(data, _currentShortAddress, shortBroadcast);
 		data[SHORT_MAC_LEN] = POLL;
-		data[SHORT_MAC_LEN + 1] = _deviceManager.getDeviceCount();
-
-		for (uint8_t i = 0; i < _deviceManager.getDeviceCount(); i++)
+		// the anchors picked by scheduleExchange()
+		uint8_t count = countRangingDevices(POLL_ACK);
+		data[SHORT_MAC_LEN + 1] = count;
+		length = SHORT_MAC_LEN + 2 + LEN_POLL_RECORD * count;
+
+		// the first slot leaves the anchors as much time as we need ourselves for a reply to a
+		// POLL_ACK, plus the longer reception of the broadcast RANGE (longer than this POLL too),
+		// as the same slots are used for RANGE_REPORT
+		uint32_t slot = (uint32_t)_processingBudgetUS + DW1000.getSyncHeaderDuration() + DEFAULT_REPLY_MARGIN;
+		slot += DW1000.getFrameDuration(getRangeLength(true, count) + 2) - DW1000.getFrameDuration(LEN_POLL_ACK + 2);
+		if (slot < _replyDelayTimeUS)
+			slot = _replyDelayTimeUS;
+		uint8_t n = 0;
+		for (uint16_t i = 0; i < _deviceManager.getDeviceCount() && n < count; i++)
 		{
 			DW1000Device *dev = _deviceManager.getDevice(i);
-			dev->setReplyTime((2 * i + 1) * DEFAULT_REPLY_DELAY_TIME);
-			memcpy(data + SHORT_MAC_LEN + 2 + 4 * i, dev->getByteShortAddress(), 2);
-			uint16_t replyTime = dev->getReplyTime();
-			memcpy(data + SHORT_MAC_LEN + 2 + 2 + 4 * i, &replyTime, 2);
+			if (dev->getTagState() != TAG_STATE_RANGING)
+				continue;
+			uint32_t offset = slot + (uint32_t)n * getReplySlotSpacing();
+			uint16_t replyTime = offset < UINT16_MAX ? offset : UINT16_MAX;
+			dev->setReplyTime(replyTime);
+			memcpy(data + SHORT_MAC_LEN + 2 + LEN_POLL_RECORD * n, dev->getByteShortAddress(), 2);
+			memcpy(data + SHORT_MAC_LEN + 4 + LEN_POLL_RECORD * n, &replyTime, 2);
+			n++;
 		}
+		// wait for the POLL_ACKs until the end of the last slot
+		_ackSlotsUS = slot + (uint32_t)count * getReplySlotSpacing();
+		// from the start of the POLL, the slots count from its timestamp after the sync header
+		_ackWindowUS = DW1000.getSyncHeaderDuration() + _ackSlotsUS;
 		copyShortAddress(_lastSentToShortAddress, shortBroadcast);
 		if (DEBUG)
 			Serial.println("[TX] Broadcasting POLL");
 	}
 	else
 	{
-		_timerDelay = DEFAULT_TIMER_DELAY;
-		_globalMac.generateShortMACFrame(data, _currentShortAddress, myDistantDevice->getByteShortAddress());
+		_globalMac.generateShortMACFrame(data, _currentShortAddress, myDistantDevice->getByteShortAddress(), myDistantDevice->nextSequenceNumber());
 		data[SHORT_MAC_LEN] = POLL;
 		data[SHORT_MAC_LEN + 1] = 1;
 		uint16_t replyTime = myDistantDevice->getReplyTime();
@@ -869,26 +1351,25 @@ void DW1000RangingClass::transmitPoll(DW1000Device *myDistantDevice)
 		if (DEBUG)
 			Serial.print("[TX] POLL to specific device: "), Serial.println((myDistantDevice->getByteShortAddress()[0] << 8) | myDistantDevice->getByteShortAddress()[1], HEX);
 	}
-	transmit(data);
+	transmit(data, length);
 	noteActivity();
 }
 
 void DW1000RangingClass::transmitPollAck(DW1000Device *myDistantDevice)
 {
 	transmitInit();
-	_globalMac.generateShortMACFrame(data, _currentShortAddress, myDistantDevice->getByteShortAddress());
+	_globalMac.generateShortMACFrame(data, _currentShortAddress, myDistantDevice->getByteShortAddress(), myDistantDevice->nextSequenceNumber());
 	data[SHORT_MAC_LEN] = POLL_ACK;
 
 	// Plan the future TX timestamp
-	DW1000Time deltaTime = DW1000Time(_replyDelayTimeUS, DW1000Time::MICROSECONDS);
-	DW1000.setDelay(deltaTime);
+	DW1000Time pollReceived = myDistantDevice->getTimestamp(TIMESTAMP_POLL_RECEIVED);
+	DW1000Time pollAckSent = scheduleReply(pollReceived, myDistantDevice->getReplyTime());
+	myDistantDevice->setTimestamp(TIMESTAMP_POLL_ACK_SENT, pollAckSent);
 
 	copyShortAddress(_lastSentToShortAddress, myDistantDevice->getByteShortAddress());
 
-	DW1000.setData(data, LEN_DATA);
-	DW1000.startTransmit();
-
-	DW1000.getTransmitTimestamp(myDistantDevice->timePollAckSent);
+	transmit(data, LEN_POLL_ACK);
+	checkReply(pollReceived, pollAckSent);
 }
 
 void DW1000RangingClass::transmitRange(DW1000Device *myDistantDevice)
@@ -897,84 +1378,133 @@ void DW1000RangingClass::transmitRange(DW1000Device *myDistantDevice)
 
 	if (myDistantDevice == nullptr)
 	{
-		_timerDelay = DEFAULT_TIMER_DELAY + (uint16_t)(_deviceManager.getDeviceCount() * 3 * DEFAULT_REPLY_DELAY_TIME / 1000);
-
+		_rangeSent = true;
 		byte shortBroadcast[2] = {0xFF, 0xFF};
 		_globalMac.generateShortMACFrame(data, _currentShortAddress, shortBroadcast);
 		data[SHORT_MAC_LEN] = RANGE;
-		data[SHORT_MAC_LEN + 1] = _deviceManager.getDeviceCount();
 
-		DW1000Time deltaTime = DW1000Time(DEFAULT_REPLY_DELAY_TIME, DW1000Time::MICROSECONDS);
-		DW1000Time futureTime = DW1000.setDelay(deltaTime);
-
-		// Count valid devices first
-		uint8_t validDevCount = 0;
-		for (uint8_t i = 0; i < _deviceManager.getDeviceCount(); i++)
+		// after the last POLL_ACK, or the end of the slots if an anchor missed its own, so the RANGE
+		// is not scheduled in a slot already passed. All anchors share the POLL and RANGE times.
+		bool answered = countRangingDevices(POLL_ACK) == 0;
+		DW1000Time pollSent;
+		for (uint16_t i = 0; i < _deviceManager.getDeviceCount(); i++)
 		{
-			if (_deviceManager.getDevice(i) != nullptr)
+			DW1000Device *dev = _deviceManager.getDevice(i);
+			if (dev->getTagState() == TAG_STATE_RANGING)
 			{
-				validDevCount++;
+				pollSent = dev->getTimestamp(TIMESTAMP_POLL_SENT);
+				break;
 			}
 		}
-
-		// Update device count in the message
-		data[SHORT_MAC_LEN + 1] = validDevCount;
-
-		uint8_t devIndex = 0;
-		for (uint8_t i = 0; i < _deviceManager.getDeviceCount(); i++)
+		DW1000Time ackSlotsEnd = pollSent + DW1000Time((int32_t)_ackSlotsUS, DW1000Time::MICROSECONDS);
+		DW1000Time rangeSent = scheduleReply(answered ? _lastAckReceived : ackSlotsEnd);
+		uint8_t count = 0;
+		for (uint16_t i = 0; i < _deviceManager.getDeviceCount(); i++)
 		{
 			DW1000Device *dev = _deviceManager.getDevice(i);
-			if (!dev)
-				continue; // Skip null devices
-
-			// Make sure we don't write beyond data buffer
-			if (SHORT_MAC_LEN + 2 + 17 * devIndex >= LEN_DATA - 17)
+			if (dev->getTagState() != TAG_STATE_RANGING)
+				continue;
+			if (dev->getExpectedMsgId() != RANGE_REPORT)
 			{
-				if (DEBUG)
-					Serial.println("[ERROR] Too many devices for data buffer");
-				break;
+				// missed its slot
+				finishExchange(dev);
+				continue;
 			}
+			dev->setTimestamp(TIMESTAMP_RANGE_SENT, rangeSent);
+			count++;
+		}
+		if (count == 0)
+			return;
 
-			memcpy(data + SHORT_MAC_LEN + 2 + 17 * devIndex, dev->getByteShortAddress(), 2);
-			dev->timeRangeSent = futureTime;
-			dev->timePollSent.getTimestamp(data + SHORT_MAC_LEN + 4 + 17 * devIndex);
-			dev->timePollAckReceived.getTimestamp(data + SHORT_MAC_LEN + 9 + 17 * devIndex);
-			dev->timeRangeSent.getTimestamp(data + SHORT_MAC_LEN + 14 + 17 * devIndex);
-			devIndex++;
+		// the intervals of all anchors are shorter than POLL to RANGE
+		DW1000Time total = (rangeSent - pollSent).wrap();
+		bool packed = _packedTimestamps && total.getTimestamp() <= UINT32_MAX;
+		uint16_t header = packed ? LEN_RANGE_HEADER_PACKED : LEN_RANGE_HEADER;
+		uint16_t record = packed ? LEN_RANGE_RECORD_PACKED : LEN_RANGE_RECORD;
+		uint8_t n = 0;
+		for (uint16_t i = 0; i < _deviceManager.getDeviceCount() && n < count; i++)
+		{
+			DW1000Device *dev = _deviceManager.getDevice(i);
+			if (dev->getTagState() != TAG_STATE_RANGING || dev->getExpectedMsgId() != RANGE_REPORT)
+				continue;
+			memcpy(data + header + record * n, dev->getByteShortAddress(), 2);
+			if (packed)
+			{
+				uint32_t round1 = (dev->getTimestamp(TIMESTAMP_POLL_ACK_RECEIVED) - pollSent).wrap().getTimestamp();
+				memcpy(data + header + record * n + 2, &round1, 4);
+			}
+			else
+			{
+				dev->getTimestamp(TIMESTAMP_POLL_ACK_RECEIVED, data + header + record * n + 2);
+			}
+			n++;
+		}
+		if (packed)
+		{
+			uint32_t interval = total.getTimestamp();
+			data[SHORT_MAC_LEN + 1] = count | RANGE_COUNT_PACKED;
+			memcpy(data + SHORT_MAC_LEN + 2, &interval, 4);
+		}
+		else
+		{
+			data[SHORT_MAC_LEN + 1] = count;
+			pollSent.getTimestamp(data + SHORT_MAC_LEN + 2);
+			rangeSent.getTimestamp(data + SHORT_MAC_LEN + 7);
 		}
 
 		copyShortAddress(_lastSentToShortAddress, shortBroadcast);
-		transmit(data);
+		transmit(data, header + record * count);
+		// waiting for missing POLL_ACKs is not part of the processing time
+		if (!checkReply(answered ? _lastAckReceived : pollSent, rangeSent, answered))
+		{
+			abortExchange();
+			backOff(micros());
+		}
 		noteActivity();
 		if (DEBUG)
 			Serial.println("[TX] Broadcast RANGE sent");
 	}
 	else
 	{
-		_globalMac.generateShortMACFrame(data, _currentShortAddress, myDistantDevice->getByteShortAddress());
+		_globalMac.generateShortMACFrame(data, _currentShortAddress, myDistantDevice->getByteShortAddress(), myDistantDevice->nextSequenceNumber());
 		data[SHORT_MAC_LEN] = RANGE;
 
-		DW1000Time deltaTime = DW1000Time(_replyDelayTimeUS, DW1000Time::MICROSECONDS);
-		DW1000.setDelay(deltaTime);
-		DW1000Time futureTime = DW1000.setDelay(deltaTime);
-
-		myDistantDevice->timeRangeSent = futureTime;
+		DW1000Time pollSent = myDistantDevice->getTimestamp(TIMESTAMP_POLL_SENT);
+		DW1000Time pollAckReceived = myDistantDevice->getTimestamp(TIMESTAMP_POLL_ACK_RECEIVED);
+		DW1000Time rangeSent = scheduleReply(pollAckReceived);
+		myDistantDevice->setTimestamp(TIMESTAMP_RANGE_SENT, rangeSent);
 
-		myDistantDevice->timePollSent.getTimestamp(data + 1 + SHORT_MAC_LEN);
-		myDistantDevice->timePollAckReceived.getTimestamp(data + 6 + SHORT_MAC_LEN);
-		myDistantDevice->timeRangeSent.getTimestamp(data + 11 + SHORT_MAC_LEN);
+		// the full timestamps if an interval does not fit into 32 bits, ~67ms
+		DW1000Time round1 = (pollAckReceived - pollSent).wrap();
+		DW1000Time reply2 = (rangeSent - pollAckReceived).wrap();
+		uint16_t length = LEN_RANGE;
+		if (_packedTimestamps && round1.getTimestamp() <= UINT32_MAX && reply2.getTimestamp() <= UINT32_MAX)
+		{
+			uint32_t interval = round1.getTimestamp();
+			memcpy(data + 1 + SHORT_MAC_LEN, &interval, 4);
+			interval = reply2.getTimestamp();
+			memcpy(data + 5 + SHORT_MAC_LEN, &interval, 4);
+			length = LEN_RANGE_PACKED;
+		}
+		else
+		{
+			pollSent.getTimestamp(data + 1 + SHORT_MAC_LEN);
+			pollAckReceived.getTimestamp(data + 6 + SHORT_MAC_LEN);
+			rangeSent.getTimestamp(data + 11 + SHORT_MAC_LEN);
+		}
 
 		copyShortAddress(_lastSentToShortAddress, myDistantDevice->getByteShortAddress());
 
-		DW1000.setData(data, LEN_DATA);
-		DW1000.startTransmit();
+		transmit(data, length);
+		if (!checkReply(pollAckReceived, rangeSent))
+			finishExchange(myDistantDevice);
 	}
 }
 
 void DW1000RangingClass::transmitRangeReport(DW1000Device *myDistantDevice)
 {
 	transmitInit();
-	_globalMac.generateShortMACFrame(data, _currentShortAddress, myDistantDevice->getByteShortAddress());
+	_globalMac.generateShortMACFrame(data, _currentShortAddress, myDistantDevice->getByteShortAddress(), myDistantDevice->nextSequenceNumber());
 	data[SHORT_MAC_LEN] = RANGE_REPORT;
 	// write final ranging result
 	float curRange = myDistantDevice->getRange();
@@ -982,18 +1512,82 @@ void DW1000RangingClass::transmitRangeReport(DW1000Device *myDistantDevice)
 	// We add the Range and then the RXPower
 	memcpy(data + 1 + SHORT_MAC_LEN, &curRange, 4);
 	memcpy(data + 5 + SHORT_MAC_LEN, &curRXPower, 4);
+	data[9 + SHORT_MAC_LEN] = _useRangeFilter ? RANGE_REPORT_FILTERED : 0;
 	copyShortAddress(_lastSentToShortAddress, myDistantDevice->getByteShortAddress());
-	transmit(data, DW1000Time(_replyDelayTimeUS, DW1000Time::MICROSECONDS));
+	DW1000Time scheduled = scheduleReply(myDistantDevice->getTimestamp(TIMESTAMP_RANGE_RECEIVED), myDistantDevice->getReplyTime());
+	transmit(data, LEN_RANGE_REPORT);
+	checkReply(myDistantDevice->getTimestamp(TIMESTAMP_RANGE_RECEIVED), scheduled);
+}
+
+DW1000Time DW1000RangingClass::scheduleReply(const DW1000Time &received, uint16_t slotUS)
+{
+	// relative to the frame replied to, so the reply time does not depend on when we get here,
+	// or exactly in the slot given by a broadcast POLL
+	uint32_t delay = (uint32_t)_processingBudgetUS + DW1000.getSyncHeaderDuration() + DEFAULT_REPLY_MARGIN;
+	if (delay < _replyDelayTimeUS)
+		delay = _replyDelayTimeUS;
+	if (slotUS > 0)
+		delay = slotUS;
+	return DW1000.setDelayFromTimestamp(received, DW1000Time((int32_t)delay, DW1000Time::MICROSECONDS));
+}
+
+bool DW1000RangingClass::checkReply(const DW1000Time &received, const DW1000Time &scheduled, bool measure)
+{
+	DW1000Time now;
+	DW1000.getSystemTimestamp(now);
+	// processing time from the reception to the reply being started, follow increases
+	// at once and decreases slowly
+	DW1000Time elapsed = (now - received).wrap();
+	if (measure)
+	{
+		float elapsedUS = elapsed.getAsMicroSeconds();
+		uint16_t budget = elapsedUS < UINT16_MAX ? (uint16_t)elapsedUS : UINT16_MAX;
+		if (budget > _processingBudgetUS)
+			_processingBudgetUS = budget;
+		else
+			_processingBudgetUS -= (_processingBudgetUS - budget) / 16;
+	}
+
+	// the preamble has to start before the scheduled time, otherwise the chip would
+	// only send once its clock wrapped around
+	DW1000Time latest = (scheduled - received).wrap() - DW1000Time((int32_t)DW1000.getSyncHeaderDuration(), DW1000Time::MICROSECONDS);
+	if (elapsed.getTimestamp() < latest.getTimestamp())
+		return true;
+	_lateReplies++;
+	if (DEBUG)
+	{
+		Serial.print("[WARNING] reply too late by ");
+		Serial.print((elapsed - latest).getAsMicroSeconds());
+		Serial.println(" us, dropped");
+	}
+	DW1000.idle();
+	receiver();
+	return false;
+}
+
+uint16_t DW1000RangingClass::getReplySlotSpacing()
+{
+	// the longest reply frame and a guard time
+	return DW1000.getFrameDuration(LEN_RANGE_REPORT + 2) + DEFAULT_REPLY_MARGIN;
+}
+
+uint16_t DW1000RangingClass::getRangeLength(bool broadcast, uint8_t count)
+{
+	if (!broadcast)
+		return _packedTimestamps ? LEN_RANGE_PACKED : LEN_RANGE;
+	if (_packedTimestamps)
+		return LEN_RANGE_HEADER_PACKED + LEN_RANGE_RECORD_PACKED * count;
+	return LEN_RANGE_HEADER + LEN_RANGE_RECORD * count;
 }
 
 void DW1000RangingClass::transmitRangeFailed(DW1000Device *myDistantDevice)
 {
 	transmitInit();
-	_globalMac.generateShortMACFrame(data, _currentShortAddress, myDistantDevice->getByteShortAddress());
+	_globalMac.generateShortMACFrame(data, _currentShortAddress, myDistantDevice->getByteShortAddress(), myDistantDevice->nextSequenceNumber());
 	data[SHORT_MAC_LEN] = RANGE_FAILED;
 
 	copyShortAddress(_lastSentToShortAddress, myDistantDevice->getByteShortAddress());
-	transmit(data);
+	transmit(data, LEN_RANGE_FAILED);
 	noteActivity();
 }
 
@@ -1019,24 +1613,30 @@ void DW1000RangingClass::computeRangeAsymmetric(DW1000Device *myDistantDevice, D
 		return;
 	}
 
-	DW1000Time round1 = (myDistantDevice->timePollAckReceived - myDistantDevice->timePollSent).wrap();
-	DW1000Time reply1 = (myDistantDevice->timePollAckSent - myDistantDevice->timePollReceived).wrap();
-	DW1000Time round2 = (myDistantDevice->timeRangeReceived - myDistantDevice->timePollAckSent).wrap();
-	DW1000Time reply2 = (myDistantDevice->timeRangeSent - myDistantDevice->timePollAckReceived).wrap();
+	DW1000Time pollSent = myDistantDevice->getTimestamp(TIMESTAMP_POLL_SENT);
+	DW1000Time pollReceived = myDistantDevice->getTimestamp(TIMESTAMP_POLL_RECEIVED);
+	DW1000Time pollAckSent = myDistantDevice->getTimestamp(TIMESTAMP_POLL_ACK_SENT);
+	DW1000Time pollAckReceived = myDistantDevice->getTimestamp(TIMESTAMP_POLL_ACK_RECEIVED);
+	DW1000Time rangeSent = myDistantDevice->getTimestamp(TIMESTAMP_RANGE_SENT);
+	DW1000Time rangeReceived = myDistantDevice->getTimestamp(TIMESTAMP_RANGE_RECEIVED);
 
 	if (DEBUG)
 	{
+		DW1000Time round1 = (pollAckReceived - pollSent).wrap();
+		DW1000Time reply1 = (pollAckSent - pollReceived).wrap();
+		DW1000Time round2 = (rangeReceived - pollAckSent).wrap();
+		DW1000Time reply2 = (rangeSent - pollAckReceived).wrap();
 		Serial.println("[DEBUG] TOF calculation timestamps:");
 		Serial.print("  PollSent: ");
-		myDistantDevice->timePollSent.printTo(Serial);
+		pollSent.printTo(Serial);
 		Serial.print("  PollAckReceived: ");
-		myDistantDevice->timePollAckReceived.printTo(Serial);
+		pollAckReceived.printTo(Serial);
 		Serial.print("  PollAckSent: ");
-		myDistantDevice->timePollAckSent.printTo(Serial);
+		pollAckSent.printTo(Serial);
 		Serial.print("  RangeReceived: ");
-		myDistantDevice->timeRangeReceived.printTo(Serial);
+		rangeReceived.printTo(Serial);
 		Serial.print("  RangeSent: ");
-		myDistantDevice->timeRangeSent.printTo(Serial);
+		rangeSent.printTo(Serial);
 		Serial.print("  round1: ");
 		Serial.println((long)round1.getTimestamp());
 		Serial.print("  reply1: ");
@@ -1047,7 +1647,8 @@ void DW1000RangingClass::computeRangeAsymmetric(DW1000Device *myDistantDevice, D
 		Serial.println((long)reply2.getTimestamp());
 	}
 
-	DW1000Time computedTOF = (round1 * round2 - reply1 * reply2) / (round1 + round2 + reply1 + reply2);
+	DW1000Time computedTOF = DW1000Time::computeTimeOfFlight(pollSent, pollReceived, pollAckSent, pollAckReceived,
+	                                                         rangeSent, rangeReceived);
 	myTOF->setTimestamp(computedTOF);
 
 	if (DEBUG)
@@ -1079,20 +1680,29 @@ void DW1000RangingClass::useRangeFilter(bool enabled)
 
 void DW1000RangingClass::setRangeFilterValue(uint16_t value)
 {
-	_rangeFilterValue = (value < 2) ? 2 : value;
+	// the number of values averaged has no counterpart in the tracker
+	(void)value;
 }
 
-/* ###########################################################################
- * #### Utils  ###############################################################
- * ######################################################################### */
+bool DW1000RangingClass::setAnchorPosition(uint16_t shortAddress, float x, float y, float z)
+{
+	return _positioning.setAnchor(shortAddress, x, y, z);
+}
 
-float DW1000RangingClass::filterValue(float value, float previousValue, uint16_t numberOfElements)
+void DW1000RangingClass::setPositionDimensions(uint8_t dimensions, float height)
 {
+	_positioning.setDimensions(dimensions, height);
+}
 
-	float k = 2.0f / ((float)numberOfElements + 1.0f);
-	return (value * k) + previousValue * (1.0f - k);
+void DW1000RangingClass::setRangeFilterNoise(uint16_t rangeNoise, uint16_t acceleration)
+{
+	DW1000RangeTracker::setNoise(rangeNoise, acceleration);
 }
 
+/* ###########################################################################
+ * #### Utils  ###############################################################
+ * ######################################################################### */
+
 bool DW1000RangingClass::isLikelyTag(uint16_t shortAddr)
 {
 	return (shortAddr & 0xFF00) == 0x9800;
@@ -27,6 +27,8 @@
 #include "DW1000Device.h"
 #include "DW1000Mac.h"
 #include "DeviceManager.h"
+#include "DW1000Positioning.h"
+#include "DW1000Latency.h"
 
 // Ranging protocol messages
 enum : uint8_t {
@@ -39,14 +41,55 @@ enum : uint8_t {
     RANGING_INIT = 5
 };
 
-#define LEN_DATA 35
+#define LEN_DATA 35 // size of the frames before they had their exact lengths, the buffers are at least this long
+// Payload lengths of the messages, without the two FCS bytes
+#define LEN_BLINK        12
+#define LEN_RANGING_INIT (LONG_MAC_LEN + 1)
+#define LEN_POLL         (SHORT_MAC_LEN + 4)  // count 1 and reply time
+#define LEN_POLL_ACK     (SHORT_MAC_LEN + 1)
+#define LEN_RANGE        (SHORT_MAC_LEN + 16) // POLL sent, POLL_ACK received and RANGE sent time
+#define LEN_RANGE_PACKED (SHORT_MAC_LEN + 9)  // POLL to POLL_ACK and POLL_ACK to RANGE, 32 bits each
+#define LEN_RANGE_REPORT (SHORT_MAC_LEN + 10) // range, RX power and flags
+#define LEN_RANGE_FAILED (SHORT_MAC_LEN + 1)
+// Flags of a RANGE_REPORT
+#define RANGE_REPORT_FILTERED 0x01 // the range went through the range tracker of the anchor
+// Broadcast POLL: count, then per anchor its address and reply slot
+#define LEN_POLL_RECORD 4
+#define LEN_POLL_BROADCAST (SHORT_MAC_LEN + 2 + LEN_POLL_RECORD * BROADCAST_MAX_ANCHORS)
+// Broadcast RANGE: POLL sent and RANGE sent time, then per anchor its address and POLL_ACK received time.
+// Packed: POLL to RANGE, then per anchor its address and POLL to POLL_ACK, 32 bits each.
+#define LEN_RANGE_HEADER        (SHORT_MAC_LEN + 12)
+#define LEN_RANGE_RECORD        7
+#define LEN_RANGE_HEADER_PACKED (SHORT_MAC_LEN + 6)
+#define LEN_RANGE_RECORD_PACKED 6
+#define RANGE_COUNT_PACKED      0x80 // flag in the count of a packed broadcast RANGE
+// Anchors in one broadcast exchange, as many as the RANGE can hold in a standard frame
+#define BROADCAST_MAX_ANCHORS_FRAME ((LEN_UWB_FRAMES - 2 - LEN_RANGE_HEADER) / LEN_RANGE_RECORD)
+#define BROADCAST_MAX_ANCHORS (MAX_DEVICES < BROADCAST_MAX_ANCHORS_FRAME ? MAX_DEVICES : BROADCAST_MAX_ANCHORS_FRAME)
+#define LEN_RANGE_BROADCAST (LEN_RANGE_HEADER + LEN_RANGE_RECORD * BROADCAST_MAX_ANCHORS)
+#define LEN_DATA_MAX (LEN_RANGE_BROADCAST > LEN_DATA ? LEN_RANGE_BROADCAST : LEN_DATA)
+
+// Received frames loop() can hold until they are handled
+#ifndef RANGING_FRAME_QUEUE_SIZE
+  #define RANGING_FRAME_QUEUE_SIZE 2
+#endif
 
 // Default pins
 #define DEFAULT_RST_PIN      9
 #define DEFAULT_SPI_SS_PIN  10
 #define DEFAULT_RESET_PERIOD 1000    // ms
 #define DEFAULT_REPLY_DELAY_TIME 10000 // µs
+#define DEFAULT_REPLY_MARGIN   100   // µs, on top of the measured processing time of a reply
 #define DEFAULT_TIMER_DELAY   60    // ms
+#define DEFAULT_EXCHANGE_TIMEOUT 50  // ms, from POLL to RANGE_REPORT
+#define RANGING_INIT_SLOTS    4     // reply slots the anchors pick from to answer a BLINK
+#define RANGING_BACKOFF_MAX_EXPONENT 4 // failed exchanges back off up to 2^4 exchange times
+
+// Delay from a BLINK to the first RANGING_INIT slot, the same on tags and anchors: an anchor
+// has not measured its processing time before it is discovered
+#ifndef RANGING_INIT_DELAY_TIME
+  #define RANGING_INIT_DELAY_TIME DEFAULT_REPLY_DELAY_TIME // µs
+#endif
 
 // Device roles
 enum Role : uint8_t { TAG = 0, ANCHOR = 1 };
@@ -58,7 +101,7 @@ enum Role : uint8_t { TAG = 0, ANCHOR = 1 };
 class DW1000RangingClass {
 public:
     // Global data buffer
-    static byte data[LEN_DATA];
+    static byte data[LEN_DATA_MAX];
 
     // Initialization & network configuration
     static void initCommunication(uint8_t rst = DEFAULT_RST_PIN,
@@ -73,11 +116,42 @@ public:
 
     // Ranging control
     static void loop();
-    static int16_t detectMessageType(const byte frame[]);
+    // Function code of a frame, -1 if it is not a blink or a data frame holding one
+    static int16_t detectMessageType(const byte frame[], uint16_t length);
 
     // Settings
+    // Replies (POLL_ACK, RANGE, RANGE_REPORT) are scheduled relative to the timestamp of the frame
+    // replied to, as early as the measured processing time allows but not before the reply time
+    // (0 by default).
     static void setReplyTime(uint16_t us);
     static void setResetPeriod(uint32_t ms);
+    // A tag starts the next exchange as soon as the last one ended (RANGE_REPORT, RANGE_FAILED or
+    // timeout), limited by the target rate per anchor (0, the default: no limit) and the share of
+    // time it may transmit (100 % by default).
+    static void setTargetRate(uint16_t rangesPerSecond);
+    static void setDutyCycle(uint8_t percent);
+    static void setExchangeTimeout(uint16_t ms);
+    // One broadcast POLL to all known anchors, answered in reply slots, and one broadcast RANGE
+    // with all timestamps. The anchors send their RANGE_REPORT in the same slots.
+    static void useBroadcastRanging(bool enabled);
+    // Send the intervals of a RANGE as 32 bits each instead of the 40 bit timestamps, both
+    // encodings are understood by the anchors
+    static void usePackedTimestamps(bool enabled);
+    // Let the DW1000 drop the frames to other devices instead of interrupting for them (on by
+    // default), before startAsAnchor() or startAsTag(). It needs the PAN ID of the frames, 0xDECA.
+    static void useFrameFilter(bool enabled);
+
+    // Measured time from receiving a frame to starting the reply, and replies dropped for being late
+    static uint16_t getProcessingBudget();
+    static uint16_t getLateReplyCount();
+
+    // Latencies measured with micros() if RANGING_LATENCY is set, nullptr otherwise. The phases of
+    // an exchange are per device.
+    static const DW1000Histogram* getLatency(LatencyProbe probe);
+    static const DW1000Histogram* getLatency(DW1000Device* device, LatencyPhase phase);
+    static void   resetLatency();
+    // All histograms in binary, see DW1000Ranging.cpp for the format. Returns the bytes written.
+    static size_t dumpLatency(Print& out);
 
     // Address & device lookup
     static const byte*    getCurrentAddress();
@@ -85,9 +159,21 @@ public:
     static DW1000Device*  getDistantDevice(int16_t index);
 	static DW1000Device* getDistantDevice(const byte shortAddr[]);
     static DW1000Device*  searchDistantDevice(const byte shortAddr[]);
+    static DW1000Device*  searchDistantDevice(uint16_t shortAddress);
+    // Handles stay valid while the device is known, a pointer may refer to another device once
+    // the device was removed and its slot reused. getDistantDevice() returns nullptr for a stale
+    // handle.
+    static DeviceHandle   getDeviceHandle(const DW1000Device* device);
+    static DW1000Device*  getDistantDevice(DeviceHandle handle);
+    static void           removeDistantDevice(DeviceHandle handle);
 
+	// Tracks the range to each device with a Kalman filter, see DW1000RangeTracker. A tag leaves
+	// the ranges alone that an anchor reports as filtered already.
 	static void useRangeFilter(bool enabled);
-static void setRangeFilterValue(uint16_t value);
+	DEPRECATED_MSG("the range filter is a Kalman filter now, use setRangeFilterNoise()")
+	static void setRangeFilterValue(uint16_t value);
+	// Standard deviation of the measured ranges in mm and of the acceleration of the devices in mm/s²
+	static void setRangeFilterNoise(uint16_t rangeNoise, uint16_t acceleration);
 
 
 	//Handlers:
@@ -98,6 +184,12 @@ static void setRangeFilterValue(uint16_t value);
 	static void attachNewDevice(void (* handleNewDevice)(DW1000Device*)) { _handleNewDevice = handleNewDevice; };
 	
 	static void attachInactiveDevice(void (* handleInactiveDevice)(DW1000Device*)) { _handleInactiveDevice = handleInactiveDevice; };
+
+	// Position of the tag from the ranges to the anchors with known coordinates, solved after
+	// each round of ranges, see DW1000Positioning
+	static void attachNewPosition(void (* handleNewPosition)(DW1000Position*)) { _handleNewPosition = handleNewPosition; };
+	static bool setAnchorPosition(uint16_t shortAddress, float x, float y, float z);
+	static void setPositionDimensions(uint8_t dimensions, float height = 0);
 	
 
     // Debug
@@ -109,7 +201,7 @@ static bool isLikelyAnchor(uint16_t shortAddress);
 
 private:
     // Manager for storing anchors/tags
-    static DeviceManager _deviceManager;
+    static DeviceManager<MAX_DEVICES> _deviceManager;
 
     // Internal state
     static byte    _currentAddress[8];
@@ -122,11 +214,12 @@ private:
     static void (*_handleBlinkDevice)(DW1000Device*);
     static void (*_handleNewDevice)(DW1000Device*);
     static void (*_handleInactiveDevice)(DW1000Device*);
+    static void (*_handleNewPosition)(DW1000Position*);
+
+    static DW1000Positioning _positioning;
 
     // Protocol state
     static Role     _type;
-    static volatile bool _sentAck;
-    static volatile bool _receivedAck;
     static bool     _protocolFailed;
 
     // Timing
@@ -135,18 +228,67 @@ private:
     static uint32_t _lastActivity;
     static uint32_t _resetPeriod;
     static uint16_t _replyDelayTimeUS;
+    static uint16_t _processingBudgetUS;
+    static uint16_t _lateReplies;
     static uint16_t _timerDelay;
     static int32_t  timer;
+    static uint16_t _exchangeTimeoutMS;
+    static uint32_t _rangingIntervalUS;
+    static uint8_t  _dutyCycle;
+    static uint32_t _airtimeCredit;
+    static uint32_t _airtimeUpdate;
     static int16_t  counterForBlink;
-    static uint16_t _rangeFilterValue;
     static volatile bool _useRangeFilter;
 
-    // Transmit/receive callbacks
-    static void handleSent();
-    static void handleReceived();
+    // Received frames, read out of the receive buffers and waiting to be handled
+    struct ReceivedFrame {
+        byte     data[LEN_DATA_MAX];
+        uint16_t length; // without the two FCS bytes
+#if RANGING_LATENCY
+        uint32_t time;   // micros() of its interrupt
+#endif
+        DW1000Class::RxDiagnostics diagnostics;
+    };
+    static ReceivedFrame _frames[RANGING_FRAME_QUEUE_SIZE];
+    static uint8_t       _frameTail;
+    static uint8_t       _frameCount;
+
+    // Exchange of the tag in progress, see scheduleExchange()
+    static bool     _exchangeActive;
+    static byte     _exchangeAddress[2];
+    static uint32_t _exchangeStart;
+    static uint16_t _exchangeIndex;
+    static bool     _broadcastRanging;
+    static bool     _packedTimestamps;
+    static bool     _frameFilter;
+    static bool     _exchangeBroadcast;
+    static bool     _rangeSent;
+    static uint32_t _ackWindowUS;
+    static uint32_t _ackSlotsUS;    // from the POLL to the end of the last POLL_ACK slot
+    static DW1000Time _lastAckReceived;
+    static bool     _blinkPending;
+    static bool     _discovering;
+    static uint32_t _discoveryEnd;
+    // random wait after failed exchanges, so tags that collided do not again
+    static uint8_t  _failedExchanges;
+    static bool     _exchangeRanged;
+    static uint32_t _exchangeDurationUS;
+    static bool     _backingOff;
+    static uint32_t _backoffEnd;
+
+    // Transmit/receive events, see loop()
+    static void pollEvents();
+    static void handleSent(const DW1000Class::Event& event);
+    static void handleReceived(const ReceivedFrame& frame);
     static void noteActivity();
     static void resetInactive();
 
+#if RANGING_LATENCY
+    static DW1000Histogram _latency[LATENCY_PROBES];
+    static uint32_t _transmitTime;
+    static void probeLatency(uint16_t shortAddress, int16_t messageType, uint32_t time);
+#endif
+
     // Checks & utilities
     static void checkForReset();
     static void checkForInactiveDevices();
@@ -154,21 +296,28 @@ private:
 
     // Sending frames
     static void transmitInit();
-    static void transmit(const byte frame[]);
-    static void transmit(const byte frame[], const DW1000Time& time);
+    static void transmit(const byte frame[], uint16_t length);
     static void transmitBlink();
-    static void transmitRangingInit(DW1000Device*);
+    static void transmitRangingInit(DW1000Device*, const DW1000Time& blinkReceived);
     static void transmitPoll(DW1000Device*);
     static void transmitPollAck(DW1000Device*);
     static void transmitRange(DW1000Device*);
     static void transmitRangeReport(DW1000Device*);
     static void transmitRangeFailed(DW1000Device*);
+    static DW1000Time scheduleReply(const DW1000Time& received, uint16_t slotUS = 0);
+    static bool       checkReply(const DW1000Time& received, const DW1000Time& scheduled, bool measure = true);
+    static uint16_t   getReplySlotSpacing();
+    static uint16_t   getRangeLength(bool broadcast, uint8_t count);
     static void receiver();
 
     // Range computation
     static void computeRangeAsymmetric(DW1000Device*, DW1000Time* tof);
     static void timerTick();
-    static float filterValue(float current, float previous, uint16_t elements);
+    static void scheduleExchange();
+    static void finishExchange(DW1000Device*);
+    static void backOff(uint32_t now);
+    static void abortExchange();
+    static uint8_t countRangingDevices(uint8_t expectedMsgId);
 };
 
 // Global instance
@@ -22,6 +22,58 @@
 
 #include "DW1000Time.h"
 
+// unsigned 128 bit value, only what the time of flight calculation needs
+struct UInt128 {
+	uint64_t hi;
+	uint64_t lo;
+};
+
+// full 64x64 bit product, built from 32x32 bit partial products
+static UInt128 multiply(uint64_t a, uint64_t b) {
+	uint64_t aL = (uint32_t)a, aH = a >> 32;
+	uint64_t bL = (uint32_t)b, bH = b >> 32;
+	uint64_t ll = aL*bL, lh = aL*bH, hl = aH*bL, hh = aH*bH;
+	uint64_t mid = (ll >> 32)+(uint32_t)lh+(uint32_t)hl;
+	UInt128 result;
+	result.lo = (mid << 32) | (uint32_t)ll;
+	result.hi = hh+(lh >> 32)+(hl >> 32)+(mid >> 32);
+	return result;
+}
+
+static bool isLess(const UInt128& a, const UInt128& b) {
+	return a.hi < b.hi || (a.hi == b.hi && a.lo < b.lo);
+}
+
+static UInt128 subtract(const UInt128& a, const UInt128& b) {
+	UInt128 result;
+	result.lo = a.lo-b.lo;
+	result.hi = a.hi-b.hi-(a.lo < b.lo ? 1 : 0);
+	return result;
+}
+
+/**
+ * Divides with rounding to nearest, processing 16 bit digits of the numerator
+ * so every step is a native 64 bit division.
+ * The divisor has to be below 2^48 and the quotient has to fit into 64 bits.
+ */
+static uint64_t divideRounded(const UInt128& numerator, uint64_t divisor) {
+	uint64_t quotient  = 0;
+	uint64_t remainder = 0;
+	for(int8_t shift = 112; shift >= 0; shift -= 16) {
+		uint64_t digit = (shift >= 64 ? numerator.hi >> (shift-64) : numerator.lo >> shift) & 0xFFFF;
+		remainder = (remainder << 16) | digit;
+		quotient <<= 16;
+		if(remainder >= divisor) {
+			quotient |= remainder/divisor;
+			remainder %= divisor;
+		}
+	}
+	if(remainder >= divisor-remainder) {
+		quotient++;
+	}
+	return quotient;
+}
+
 /**
  * Initiates DW1000Time with 0
  */
@@ -89,7 +141,7 @@ void DW1000Time::setTimestamp(int64_t value) {
  * Set timestamp
  * @param data timestamp as byte array
  */
-void DW1000Time::setTimestamp(byte data[]) {
+void DW1000Time::setTimestamp(const byte data[]) {
 	_timestamp = 0;
 	for(uint8_t i = 0; i < LENGTH_TIMESTAMP; i++) {
 		_timestamp |= ((int64_t)data[i] << (i*8));
@@ -174,6 +226,66 @@ float DW1000Time::getAsMeters() const {
 	return (_timestamp%TIME_OVERFLOW)*DISTANCE_OF_RADIO;
 }
 
+/**
+ * Return time as distance in millimeter, d=c*t, calculated without float
+ * and exact (rounded to nearest) for the whole timestamp range
+ * @return distance in millimeters
+ */
+int64_t DW1000Time::getAsMillimeters() const {
+	int64_t  ticks     = _timestamp%TIME_OVERFLOW;
+	uint64_t magnitude = ticks < 0 ? -ticks : ticks;
+	int64_t  distance  = divideRounded(multiply(magnitude, DISTANCE_OF_RADIO_MM_NUM), DISTANCE_OF_RADIO_MM_DEN);
+	return ticks < 0 ? -distance : distance;
+}
+
+/**
+ * Time of flight of an asymmetric double-sided two way ranging:
+ * tof = (round1*round2 - reply1*reply2) / (round1 + round2 + reply1 + reply2)
+ * The products of 40 bit intervals need up to 80 bits, more than int64 holds
+ * for intervals above ~47ms, so they are calculated with 128 bit precision.
+ * Intervals are taken modulo 2^40, so unwrapped differences work as well.
+ * @param round1 poll sent to poll ack received, at the initiator
+ * @param reply1 poll received to poll ack sent, at the responder
+ * @param round2 poll ack sent to range received, at the responder
+ * @param reply2 poll ack received to range sent, at the initiator
+ * @return time of flight in timestamp units rounded to nearest, negative if
+ * the replies took longer than the round trips (invalid measurement)
+ */
+int64_t DW1000Time::computeTimeOfFlight(uint64_t round1, uint64_t reply1, uint64_t round2, uint64_t reply2) {
+	round1 &= TIME_MAX;
+	reply1 &= TIME_MAX;
+	round2 &= TIME_MAX;
+	reply2 &= TIME_MAX;
+	uint64_t divisor = round1+round2+reply1+reply2;
+	if(divisor == 0) {
+		return 0;
+	}
+	UInt128 rounds  = multiply(round1, round2);
+	UInt128 replies = multiply(reply1, reply2);
+	if(isLess(rounds, replies)) {
+		return -(int64_t)divideRounded(subtract(replies, rounds), divisor);
+	}
+	return divideRounded(subtract(rounds, replies), divisor);
+}
+
+/**
+ * Time of flight of a poll, poll ack and range exchange, as computed by the
+ * ranging of DW1000Ranging. Each interval is wrapped once the timestamps overflow.
+ * @param pollSent, pollAckReceived, rangeSent at the initiator
+ * @param pollReceived, pollAckSent, rangeReceived at the responder
+ * @return time of flight in timestamp units, see above
+ */
+int64_t DW1000Time::computeTimeOfFlight(const DW1000Time& pollSent, const DW1000Time& pollReceived,
+                                        const DW1000Time& pollAckSent, const DW1000Time& pollAckReceived,
+                                        const DW1000Time& rangeSent, const DW1000Time& rangeReceived) {
+	DW1000Time round1 = (pollAckReceived-pollSent).wrap();
+	DW1000Time reply1 = (pollAckSent-pollReceived).wrap();
+	DW1000Time round2 = (rangeReceived-pollAckSent).wrap();
+	DW1000Time reply2 = (rangeSent-pollAckReceived).wrap();
+	return computeTimeOfFlight(round1.getTimestamp(), reply1.getTimestamp(),
+	                           round2.getTimestamp(), reply2.getTimestamp());
+}
+
 /**
  * Converts negative values due overflow of one node to correct value
  * @example:
@@ -51,6 +51,9 @@ public:
 	// Speed of radio waves [m/s] * timestamp resolution [~15.65ps] of DW1000
 	static constexpr float DISTANCE_OF_RADIO     = 0.0046917639786159f;
 	static constexpr float DISTANCE_OF_RADIO_INV = 213.139451293f;
+	// same as exact fraction for integer conversion to [mm]: 299792458e3 / 63897.6e6
+	static constexpr uint32_t DISTANCE_OF_RADIO_MM_NUM = 149896229;
+	static constexpr uint32_t DISTANCE_OF_RADIO_MM_DEN = 31948800;
 	
 	// timestamp byte length - 40 bit -> 5 byte
 	static constexpr uint8_t LENGTH_TIMESTAMP = 5;
@@ -78,7 +81,7 @@ public:
 	// setter
 	// dw1000 timestamp, increase of +1 approx approx. 15.65ps real time
 	void setTimestamp(int64_t value);
-	void setTimestamp(byte data[]);
+	void setTimestamp(const byte data[]);
 	void setTimestamp(const DW1000Time& copy);
 	
 	// real time in us
@@ -95,6 +98,14 @@ public:
 	float getAsMicroSeconds() const;
 	//void getAsBytes(byte data[]) const; // TODO check why it is here, is it old version of getTimestamp(byte) ?
 	float getAsMeters() const;
+	int64_t getAsMillimeters() const;
+	
+	// double-sided two way ranging, exact for 40 bit intervals, no float
+	static int64_t computeTimeOfFlight(uint64_t round1, uint64_t reply1, uint64_t round2, uint64_t reply2);
+	// the same from the six timestamps of a poll, poll ack and range exchange
+	static int64_t computeTimeOfFlight(const DW1000Time& pollSent, const DW1000Time& pollReceived,
+	                                   const DW1000Time& pollAckSent, const DW1000Time& pollAckReceived,
+	                                   const DW1000Time& rangeSent, const DW1000Time& rangeReceived);
 	
 	DW1000Time& wrap();
 	
@@ -3,25 +3,487 @@
 
 #include "DW1000Device.h"
 
-#define MAX_DEVICES 4  // You can increase this depending on memory
+// You can increase this depending on memory, up to 16384. It has to be the same for the library
+// and the sketch, so set it as a build flag (e.g. -DMAX_DEVICES=256), not in the sketch.
+#ifndef MAX_DEVICES
+  #define MAX_DEVICES 4
+#endif
+
+// Open addressing index of the devices by short address, at most half full
+constexpr uint16_t deviceIndexSize(uint16_t devices, uint16_t size = 4) {
+    return size >= 2 * devices ? size : deviceIndexSize(devices, size * 2);
+}
+#define DEVICE_INDEX_EMPTY 0xFFFF
+
+// Timer wheel for the deadlines of the devices, 64 buckets of 64 ms, so a deadline up to 4 s
+// ahead is looked at when it is due and not before
+#define DEVICE_WHEEL_SIZE  64
+#define DEVICE_WHEEL_SHIFT 6
 
+// Refers to a device as long as it is managed, unlike a pointer it does not refer to the next
+// device put into the same slot. The default one refers to no device.
+struct DeviceHandle {
+    uint16_t slot = 0;
+    uint16_t generation = 0;
+    bool isValid() const { return generation != 0; }
+    bool operator==(const DeviceHandle& other) const { return slot == other.slot && generation == other.generation; }
+    bool operator!=(const DeviceHandle& other) const { return !(*this == other); }
+};
+
+// Holds up to N devices in preallocated slots, devices are set up in place by emplace() so
+// admitting one never allocates. A device keeps its slot until it is removed, getDevice()
+// iterates over the devices in a dense list.
+template <uint16_t N = MAX_DEVICES>
 class DeviceManager {
+    // the index has twice the slots, in uint16_t
+    static_assert(N > 0 && N <= 16384, "DeviceManager holds 1 to 16384 devices");
+
 public:
     DeviceManager();
 
+    // New device in a free slot, nullptr if the short address is known already or all slots
+    // are used. The EUI may be nullptr if it is not known.
+    DW1000Device* emplace(const byte shortAddress[], const byte address[] = nullptr);
     bool addDevice(DW1000Device* device, bool checkShortAddress = false);
     void removeDevice(int16_t index);
+    void removeDevice(DeviceHandle handle);
 
     DW1000Device* getDevice(int16_t index);
-    DW1000Device* getDeviceByShortAddress(byte shortAddress[]);
+    DW1000Device* getDevice(DeviceHandle handle);
+    DW1000Device* getDeviceByShortAddress(const byte shortAddress[]);
+    DW1000Device* getDeviceByShortAddress(uint16_t shortAddress);
+    DeviceHandle  getHandle(const DW1000Device* device);
 
+    // Marks devices inactive and resets stuck ranging states, only looks at the devices with a
+    // deadline due. handleInactive may remove the device it gets but no other one.
     void checkForInactiveDevices(void (*handleInactive)(DW1000Device*));
+    // To be called when a device may have an earlier deadline than before, i.e. after it became
+    // active again or started ranging. Later deadlines are found without it.
+    void updateDeadline(DW1000Device* device);
     void reactivateDevice(byte shortAddress[]);
-    uint8_t getDeviceCount();
+    uint16_t getDeviceCount();
+    static constexpr uint16_t getCapacity() { return N; }
 
 private:
-    DW1000Device _devices[MAX_DEVICES];
-    uint8_t _deviceCount;
+    static constexpr uint16_t INDEX_SIZE = deviceIndexSize(N);
+
+    DW1000Device _devices[N];
+#if DEVICE_TABLE
+    // the timestamps of the devices, as in a DeviceTable
+    byte _timestamps[N][TIMESTAMP_COUNT][DW1000Time::LENGTH_TIMESTAMP];
+#endif
+    uint16_t _generations[N];  // of the device in each slot, changes when it is removed
+    uint16_t _order[N];        // slots of the devices, dense
+    uint16_t _positions[N];    // position of each used slot in _order
+    uint16_t _free[N];         // unused slots, used as a stack
+    uint16_t _deviceCount;
+    uint16_t _freeCount;
+
+    // slot per hash of the short address, DEVICE_INDEX_EMPTY if unused
+    uint16_t _index[INDEX_SIZE];
+    static uint16_t hash(uint16_t shortAddress);
+    uint16_t findSlot(uint16_t shortAddress);
+    void eraseIndex(uint16_t shortAddress);
+    void release(uint16_t slot);
+
+    // slots with a deadline, in lists per bucket of their deadline
+    uint32_t _deadlines[N];     // millis()
+    uint16_t _timerNext[N];
+    uint16_t _timerPrev[N];
+    bool _timerArmed[N];
+    uint16_t _wheel[DEVICE_WHEEL_SIZE];
+    uint32_t _wheelTime;        // bucket of millis() looked at last
+    static uint32_t rangingTimeout(DW1000Device* device);
+    static bool nextDeadline(DW1000Device* device, uint32_t& deadline);
+    void arm(uint16_t slot, uint32_t deadline);
+    void disarm(uint16_t slot);
+    void expire(uint16_t slot, void (*handleInactive)(DW1000Device*));
 };
 
+template <uint16_t N>
+DeviceManager<N>::DeviceManager()
+{
+    _deviceCount = 0;
+    _freeCount = N;
+    for (uint16_t i = 0; i < N; i++)
+    {
+        _generations[i] = 1;
+        _order[i] = 0;
+        _positions[i] = 0;
+        _free[i] = N - 1 - i;
+        _timerArmed[i] = false;
+#if DEVICE_TABLE
+        _devices[i].setTimestampRow(_timestamps[i]);
+#endif
+    }
+    for (uint16_t i = 0; i < INDEX_SIZE; i++)
+        _index[i] = DEVICE_INDEX_EMPTY;
+    for (uint16_t i = 0; i < DEVICE_WHEEL_SIZE; i++)
+        _wheel[i] = DEVICE_INDEX_EMPTY;
+    _wheelTime = 0;
+}
+
+template <uint16_t N>
+uint16_t DeviceManager<N>::hash(uint16_t shortAddress)
+{
+    // short addresses often differ in one byte only, so mix both into the low bits
+    uint16_t h = shortAddress * 0x9E37;
+    return (h ^ (h >> 8)) & (INDEX_SIZE - 1);
+}
+
+template <uint16_t N>
+uint16_t DeviceManager<N>::findSlot(uint16_t shortAddress)
+{
+    // linear probing, ends at the device or at the empty slot to put it in
+    uint16_t slot = hash(shortAddress);
+    while (_index[slot] != DEVICE_INDEX_EMPTY && _devices[_index[slot]].getShortAddress() != shortAddress)
+        slot = (slot + 1) & (INDEX_SIZE - 1);
+    return slot;
+}
+
+template <uint16_t N>
+void DeviceManager<N>::eraseIndex(uint16_t shortAddress)
+{
+    // shift the following entries of the probe chain back into the hole, unless that would
+    // put them before their hash
+    uint16_t hole = findSlot(shortAddress);
+    _index[hole] = DEVICE_INDEX_EMPTY;
+    for (uint16_t i = (hole + 1) & (INDEX_SIZE - 1); _index[i] != DEVICE_INDEX_EMPTY; i = (i + 1) & (INDEX_SIZE - 1))
+    {
+        uint16_t home = hash(_devices[_index[i]].getShortAddress());
+        if (((i - home) & (INDEX_SIZE - 1)) >= ((i - hole) & (INDEX_SIZE - 1)))
+        {
+            _index[hole] = _index[i];
+            _index[i] = DEVICE_INDEX_EMPTY;
+            hole = i;
+        }
+    }
+}
+
+template <uint16_t N>
+void DeviceManager<N>::release(uint16_t slot)
+{
+    eraseIndex(_devices[slot].getShortAddress());
+    disarm(slot);
+    // the last device takes the place of the removed one in the dense list
+    uint16_t position = _positions[slot];
+    uint16_t last = _order[_deviceCount - 1];
+    _order[position] = last;
+    _positions[last] = position;
+    _deviceCount--;
+    if (++_generations[slot] == 0)
+        _generations[slot] = 1;
+    _free[_freeCount++] = slot;
+}
+
+template <uint16_t N>
+DW1000Device *DeviceManager<N>::emplace(const byte shortAddress[], const byte address[])
+{
+    uint16_t newAddr = (shortAddress[1] << 8) | shortAddress[0];
+    if (_index[findSlot(newAddr)] != DEVICE_INDEX_EMPTY)
+        return nullptr;
+    if (_freeCount == 0)
+    {
+        Serial.println("[ERROR] Over Max Devices");
+        return nullptr;
+    }
+
+    uint16_t slot = _free[--_freeCount];
+    DW1000Device *device = &_devices[slot];
+    device->init(address, shortAddress);
+    device->setIndex(slot);
+    _positions[slot] = _deviceCount;
+    _order[_deviceCount++] = slot;
+    _index[findSlot(newAddr)] = slot;
+    updateDeadline(device);
+
+    Serial.print("[DeviceManager] Added new device: ");
+    Serial.println(newAddr, HEX);
+    return device;
+}
+
+template <uint16_t N>
+bool DeviceManager<N>::addDevice(DW1000Device *device, bool checkShortAddress)
+{
+    if (!device)
+        return false;
+
+    uint16_t newAddr = (device->getByteShortAddress()[1] << 8) | device->getByteShortAddress()[0];
+
+    // Check for duplicates or reactivations
+    uint16_t slot = findSlot(newAddr);
+    if (checkShortAddress)
+    {
+        if (_index[slot] != DEVICE_INDEX_EMPTY)
+        {
+            DW1000Device *existing = &_devices[_index[slot]];
+            if (!existing->isActive())
+            {
+                existing->setActive();
+                existing->noteActivity();
+                updateDeadline(existing);
+                Serial.print("[DeviceManager] Reactivated existing device: ");
+                Serial.println(newAddr, HEX);
+                return true;
+            }
+            Serial.print("[DeviceManager] Device already active: ");
+            Serial.println(newAddr, HEX);
+            return false; // Already active
+        }
+    }
+    else
+    {
+        for (uint16_t i = 0; i < _deviceCount; i++)
+        {
+            if (_devices[_order[i]].isAddressEqual(device))
+            {
+                Serial.println("[DeviceManager] Full address match, already in list.");
+                return false;
+            }
+        }
+        if (_index[slot] != DEVICE_INDEX_EMPTY)
+        {
+            // a different device with the same short address, the index can only find one of them
+            Serial.print("[ERROR] Short address already used: ");
+            Serial.println(newAddr, HEX);
+            return false;
+        }
+    }
+
+    // a copy of the device, in the slot emplace() set up
+    DW1000Device *stored = emplace(device->getByteShortAddress(), device->getByteAddress());
+    if (!stored)
+        return false;
+    int16_t index = stored->getIndex();
+    *stored = *device;
+    stored->setRange(0);
+    stored->setIndex(index);
+#if DEVICE_TABLE
+    // the copy keeps its own row, with the timestamps the device had
+    stored->setTimestampRow(_timestamps[index]);
+    for (uint8_t i = 0; i < TIMESTAMP_COUNT; i++)
+        stored->setTimestamp((DeviceTimestamp)i, device->getTimestamp((DeviceTimestamp)i));
+#endif
+    stored->setActive();
+    updateDeadline(stored);
+    return true;
+}
+
+template <uint16_t N>
+void DeviceManager<N>::removeDevice(int16_t index)
+{
+    if (index < 0 || index >= _deviceCount)
+        return;
+    release(_order[index]);
+}
+
+template <uint16_t N>
+void DeviceManager<N>::removeDevice(DeviceHandle handle)
+{
+    if (getDevice(handle))
+        release(handle.slot);
+}
+
+template <uint16_t N>
+DW1000Device *DeviceManager<N>::getDevice(int16_t index)
+{
+    if (index < 0 || index >= _deviceCount)
+        return nullptr;
+    return &_devices[_order[index]];
+}
+
+template <uint16_t N>
+DW1000Device *DeviceManager<N>::getDevice(DeviceHandle handle)
+{
+    if (handle.slot >= N || handle.generation != _generations[handle.slot])
+        return nullptr;
+    // a free slot has the generation its next device will get
+    if (_positions[handle.slot] >= _deviceCount || _order[_positions[handle.slot]] != handle.slot)
+        return nullptr;
+    return &_devices[handle.slot];
+}
+
+template <uint16_t N>
+DeviceHandle DeviceManager<N>::getHandle(const DW1000Device *device)
+{
+    DeviceHandle handle;
+    if (device < _devices || device >= _devices + N)
+        return handle;
+    handle.slot = device - _devices;
+    handle.generation = _generations[handle.slot];
+    if (!getDevice(handle))
+        handle.generation = 0;
+    return handle;
+}
+
+template <uint16_t N>
+DW1000Device *DeviceManager<N>::getDeviceByShortAddress(const byte shortAddress[])
+{
+    return getDeviceByShortAddress((uint16_t)((shortAddress[1] << 8) | shortAddress[0]));
+}
+
+template <uint16_t N>
+DW1000Device *DeviceManager<N>::getDeviceByShortAddress(uint16_t shortAddress)
+{
+    uint16_t slot = findSlot(shortAddress);
+    if (_index[slot] == DEVICE_INDEX_EMPTY)
+        return nullptr;
+    return &_devices[_index[slot]];
+}
+
+template <uint16_t N>
+uint32_t DeviceManager<N>::rangingTimeout(DW1000Device *device)
+{
+    // stuck if neither a frame came nor the state changed since
+    uint32_t since = device->getLastActivity();
+    if ((int32_t)(device->getLastStateChange() - since) > 0)
+        since = device->getLastStateChange();
+    return since + RANGING_TIMEOUT + 1;
+}
+
+template <uint16_t N>
+bool DeviceManager<N>::nextDeadline(DW1000Device *device, uint32_t &deadline)
+{
+    bool pending = false;
+    if (device->isActive())
+    {
+        deadline = device->getLastActivity() + INACTIVITY_TIME + 1;
+        pending = true;
+    }
+    if (device->getTagState() == TAG_STATE_RANGING)
+    {
+        uint32_t timeout = rangingTimeout(device);
+        if (!pending || (int32_t)(timeout - deadline) < 0)
+            deadline = timeout;
+        pending = true;
+    }
+    return pending;
+}
+
+template <uint16_t N>
+void DeviceManager<N>::arm(uint16_t slot, uint32_t deadline)
+{
+    // a deadline the wheel has passed goes in the bucket the next check starts with
+    uint32_t wheelStart = _wheelTime << DEVICE_WHEEL_SHIFT;
+    if ((int32_t)(deadline - wheelStart) < 0)
+        deadline = wheelStart;
+    uint16_t bucket = (deadline >> DEVICE_WHEEL_SHIFT) & (DEVICE_WHEEL_SIZE - 1);
+    _deadlines[slot] = deadline;
+    _timerPrev[slot] = DEVICE_INDEX_EMPTY;
+    _timerNext[slot] = _wheel[bucket];
+    if (_wheel[bucket] != DEVICE_INDEX_EMPTY)
+        _timerPrev[_wheel[bucket]] = slot;
+    _wheel[bucket] = slot;
+    _timerArmed[slot] = true;
+}
+
+template <uint16_t N>
+void DeviceManager<N>::disarm(uint16_t slot)
+{
+    if (!_timerArmed[slot])
+        return;
+    uint16_t next = _timerNext[slot];
+    uint16_t prev = _timerPrev[slot];
+    if (next != DEVICE_INDEX_EMPTY)
+        _timerPrev[next] = prev;
+    if (prev != DEVICE_INDEX_EMPTY)
+        _timerNext[prev] = next;
+    else
+        _wheel[(_deadlines[slot] >> DEVICE_WHEEL_SHIFT) & (DEVICE_WHEEL_SIZE - 1)] = next;
+    _timerArmed[slot] = false;
+}
+
+template <uint16_t N>
+void DeviceManager<N>::updateDeadline(DW1000Device *device)
+{
+    uint16_t slot = device->getIndex();
+    uint32_t deadline;
+    if (!nextDeadline(device, deadline))
+    {
+        disarm(slot);
+        return;
+    }
+    // a later deadline than the one in the wheel is noticed when that one is due
+    if (_timerArmed[slot] && (int32_t)(deadline - _deadlines[slot]) >= 0)
+        return;
+    disarm(slot);
+    arm(slot, deadline);
+}
+
+template <uint16_t N>
+void DeviceManager<N>::expire(uint16_t slot, void (*handleInactive)(DW1000Device *))
+{
+    DW1000Device *dev = &_devices[slot];
+
+    // Mark inactive if no activity and still active
+    if (dev->isInactive() && dev->isActive())
+    {
+        uint16_t generation = _generations[slot];
+        if (handleInactive)
+        {
+            handleInactive(dev);
+            if (_generations[slot] != generation)
+                return; // removed
+        }
+        Serial.print("[INFO] Marking device inactive: ");
+        Serial.println(dev->getShortAddress(), HEX);
+        dev->setInactive(); // don't remove
+    }
+
+    // Extra: reset stuck RANGING devices
+    if (dev->getTagState() == TAG_STATE_RANGING && (int32_t)(millis() - rangingTimeout(dev)) >= 0)
+    {
+        dev->setTagState(TAG_STATE_IDLE);
+        Serial.print("[TIMEOUT] Forcing IDLE on device: ");
+        Serial.println(dev->getShortAddress(), HEX);
+    }
+    updateDeadline(dev);
+}
+
+template <uint16_t N>
+void DeviceManager<N>::checkForInactiveDevices(void (*handleInactive)(DW1000Device *))
+{
+    uint32_t now = millis();
+    uint32_t bucketNow = now >> DEVICE_WHEEL_SHIFT;
+    // the buckets passed since the last call, at most one turn of the wheel
+    uint32_t bucketTime = _wheelTime;
+    if (bucketNow - bucketTime >= DEVICE_WHEEL_SIZE)
+        bucketTime = bucketNow - DEVICE_WHEEL_SIZE + 1;
+    for (;; bucketTime++)
+    {
+        uint16_t i = _wheel[bucketTime & (DEVICE_WHEEL_SIZE - 1)];
+        while (i != DEVICE_INDEX_EMPTY)
+        {
+            // devices re-armed into this bucket go in front, so they are not met again
+            uint16_t next = _timerNext[i];
+            if ((int32_t)(now - _deadlines[i]) >= 0)
+            {
+                disarm(i);
+                expire(i, handleInactive);
+            }
+            i = next;
+        }
+        if (bucketTime == bucketNow)
+            break;
+    }
+    _wheelTime = bucketNow;
+}
+
+template <uint16_t N>
+uint16_t DeviceManager<N>::getDeviceCount()
+{
+    return _deviceCount;
+}
+
+template <uint16_t N>
+void DeviceManager<N>::reactivateDevice(byte shortAddress[])
+{
+    DW1000Device *dev = getDeviceByShortAddress(shortAddress);
+    if (dev)
+    {
+        dev->setActive();
+        updateDeadline(dev);
+    }
+}
+
 #endif
@@ -0,0 +1,135 @@
+#ifndef DEVICE_TABLE_H
+#define DEVICE_TABLE_H
+
+#include "DeviceManager.h"
+
+// A smaller alternative to DeviceManager for sketches that keep track of many devices, e.g. an
+// anchor serving tens of tags on an AVR. Each field is an array over the rows, so the fields
+// looked at for every frame (short address, state, expected message, deadline) are contiguous,
+// and the timestamps are kept as the 40 bit values the DW1000 has, as DeviceManager does with
+// DEVICE_TABLE. A row belongs to a device until it or the last row is removed, the last row takes
+// the place of a removed one.
+template <uint16_t N = MAX_DEVICES>
+class DeviceTable {
+public:
+    DeviceTable() : _count(0) {}
+
+    // New row, -1 if the short address is known already or the table is full. The EUI may be
+    // nullptr if it is not known.
+    int16_t add(const byte shortAddress[], const byte address[] = nullptr);
+    void remove(uint16_t row);
+    // Row of the device, -1 if unknown
+    int16_t find(uint16_t shortAddress) const;
+    int16_t find(const byte shortAddress[]) const { return find((shortAddress[1] << 8) | shortAddress[0]); }
+
+    uint16_t getCount() const { return _count; }
+    static constexpr uint16_t getCapacity() { return N; }
+
+    uint16_t getShortAddress(uint16_t row) const { return _shortAddresses[row]; }
+    const byte* getAddress(uint16_t row) const { return _addresses[row]; }
+    TagState getTagState(uint16_t row) const { return (TagState)_states[row]; }
+    void setTagState(uint16_t row, TagState state) { _states[row] = state; }
+    uint8_t getExpectedMsgId(uint16_t row) const { return _expectedMsgIds[row]; }
+    void setExpectedMsgId(uint16_t row, uint8_t msgId) { _expectedMsgIds[row] = msgId; }
+    // millis() of the next timeout of the device
+    uint32_t getDeadline(uint16_t row) const { return _deadlines[row]; }
+    void setDeadline(uint16_t row, uint32_t deadline) { _deadlines[row] = deadline; }
+
+    DW1000Time getTimestamp(uint16_t row, DeviceTimestamp which) const;
+    void setTimestamp(uint16_t row, DeviceTimestamp which, const DW1000Time& time);
+
+    // in m and dBm, to the cm or 0.01 dB like DW1000Device
+    float getRange(uint16_t row) const { return _ranges[row] / 100.0f; }
+    void setRange(uint16_t row, float range) { _ranges[row] = round(range * 100); }
+    float getRXPower(uint16_t row) const { return _rxPowers[row] / 100.0f; }
+    void setRXPower(uint16_t row, float power) { _rxPowers[row] = round(power * 100); }
+
+private:
+    uint16_t _count;
+
+    // hot
+    uint16_t _shortAddresses[N];
+    uint8_t _states[N];
+    uint8_t _expectedMsgIds[N];
+    uint32_t _deadlines[N];
+
+    // cold
+    byte _timestamps[N][TIMESTAMP_COUNT][DW1000Time::LENGTH_TIMESTAMP];
+    byte _addresses[N][8];
+    int16_t _ranges[N];
+    int16_t _rxPowers[N];
+
+    void moveRow(uint16_t to, uint16_t from);
+};
+
+template <uint16_t N>
+int16_t DeviceTable<N>::add(const byte shortAddress[], const byte address[])
+{
+    uint16_t shortAddr = (shortAddress[1] << 8) | shortAddress[0];
+    if (_count == N || find(shortAddr) >= 0)
+        return -1;
+    uint16_t row = _count++;
+    _shortAddresses[row] = shortAddr;
+    _states[row] = TAG_STATE_IDLE;
+    _expectedMsgIds[row] = 0;
+    _deadlines[row] = 0;
+    memset(_timestamps[row], 0, sizeof(_timestamps[row]));
+    if (address != nullptr)
+        memcpy(_addresses[row], address, 8);
+    else
+        memset(_addresses[row], 0, 8);
+    _ranges[row] = 0;
+    _rxPowers[row] = 0;
+    return row;
+}
+
+template <uint16_t N>
+void DeviceTable<N>::moveRow(uint16_t to, uint16_t from)
+{
+    _shortAddresses[to] = _shortAddresses[from];
+    _states[to] = _states[from];
+    _expectedMsgIds[to] = _expectedMsgIds[from];
+    _deadlines[to] = _deadlines[from];
+    memcpy(_timestamps[to], _timestamps[from], sizeof(_timestamps[to]));
+    memcpy(_addresses[to], _addresses[from], 8);
+    _ranges[to] = _ranges[from];
+    _rxPowers[to] = _rxPowers[from];
+}
+
+template <uint16_t N>
+void DeviceTable<N>::remove(uint16_t row)
+{
+    if (row >= _count)
+        return;
+    _count--;
+    if (row != _count)
+        moveRow(row, _count);
+}
+
+template <uint16_t N>
+int16_t DeviceTable<N>::find(uint16_t shortAddress) const
+{
+    // a scan over 2 bytes per device, no index to keep the table small
+    for (uint16_t i = 0; i < _count; i++)
+    {
+        if (_shortAddresses[i] == shortAddress)
+            return i;
+    }
+    return -1;
+}
+
+template <uint16_t N>
+DW1000Time DeviceTable<N>::getTimestamp(uint16_t row, DeviceTimestamp which) const
+{
+    DW1000Time time;
+    time.setTimestamp(_timestamps[row][which]);
+    return time;
+}
+
+template <uint16_t N>
+void DeviceTable<N>::setTimestamp(uint16_t row, DeviceTimestamp which, const DW1000Time &time)
+{
+    time.getTimestamp(_timestamps[row][which]);
+}
+
+#endif